@@ -0,0 +1,162 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Saves the same CVars (200k ints, doubles and strings in nested namespaces,
+// plus a few large float vectors) as XML and as JSON, then loads each file,
+// checks the values and prints the load times and parse throughput.
+// Usage: JSONLoadBenchmark [repetitions]
+
+#include <cvars/CVar.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+
+const size_t NUM_CVARS     = 200000;
+const size_t GROUP_SIZE    = 100;
+const size_t NUM_VECTORS   = 4;
+const size_t VECTOR_SIZE   = 250000;
+const char*  XML_FILE_NAME = "JSONLoadBenchmark.xml";
+const char*  JSON_FILE_NAME = "JSONLoadBenchmark.json";
+
+////////////////////////////////////////////////////////////////////////////////
+static std::string CVarName( const char* sKind, size_t ii )
+{
+    char sName[96];
+    snprintf( sName, sizeof( sName ), "bench.group%zu.%s%zu", ii / GROUP_SIZE, sKind, ii );
+    return sName;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static std::string StringValue( size_t ii )
+{
+    return "value" + std::to_string( ii );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Scalar doubles are saved to XML with 6 significant digits.
+static double DoubleValue( size_t ii )
+{
+    return ii % 1000 + 0.25;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct BenchCVars
+{
+    std::vector<int*>                 m_vInts;
+    std::vector<double*>              m_vDoubles;
+    std::vector<std::string*>         m_vStrings;
+    std::vector< std::vector<float>* > m_vVectors;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static void SetValues( BenchCVars& cvars, bool bExpected )
+{
+    for( size_t ii = 0; ii < cvars.m_vInts.size(); ii++ ) {
+        *cvars.m_vInts[ii] = bExpected ? (int)ii : -1;
+        *cvars.m_vDoubles[ii] = bExpected ? DoubleValue( ii ) : -1;
+        *cvars.m_vStrings[ii] = bExpected ? StringValue( ii ) : std::string();
+    }
+    for( size_t ii = 0; ii < cvars.m_vVectors.size(); ii++ ) {
+        std::vector<float>& vVec = *cvars.m_vVectors[ii];
+        vVec.assign( bExpected ? VECTOR_SIZE : 0, 0.0f );
+        for( size_t jj = 0; jj < vVec.size(); jj++ ) {
+            vVec[jj] = ( ii * VECTOR_SIZE + jj ) * 0.5f;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool CheckValues( BenchCVars& cvars, const char* sFileName )
+{
+    for( size_t ii = 0; ii < cvars.m_vInts.size(); ii++ ) {
+        if( *cvars.m_vInts[ii] != (int)ii || *cvars.m_vDoubles[ii] != DoubleValue( ii ) ||
+            *cvars.m_vStrings[ii] != StringValue( ii ) ) {
+            fprintf( stderr, "ERROR: wrong value for CVar %zu after loading %s.\n", ii, sFileName );
+            return false;
+        }
+    }
+    for( size_t ii = 0; ii < cvars.m_vVectors.size(); ii++ ) {
+        const std::vector<float>& vVec = *cvars.m_vVectors[ii];
+        bool bOk = vVec.size() == VECTOR_SIZE;
+        for( size_t jj = 0; bOk && jj < vVec.size(); jj++ ) {
+            bOk = vVec[jj] == ( ii * VECTOR_SIZE + jj ) * 0.5f;
+        }
+        if( !bOk ) {
+            fprintf( stderr, "ERROR: wrong value for vector %zu after loading %s.\n", ii, sFileName );
+            return false;
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Best load time of sFileName in ms, negative if the values are wrong.
+static double TimeLoad( BenchCVars& cvars, const char* sFileName, CVARS_STREAM_TYPE streamType,
+                        int nRepetitions )
+{
+    CVarUtils::SetStreamType( streamType );
+    double dBest = 1e30;
+    for( int nRep = 0; nRep < nRepetitions; nRep++ ) {
+        SetValues( cvars, false );
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        CVarUtils::Load( sFileName );
+        const double dMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start ).count();
+        dBest = std::min( dBest, dMs );
+        if( !CheckValues( cvars, sFileName ) ) {
+            return -1;
+        }
+    }
+    return dBest;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static double FileSizeMB( const char* sFileName )
+{
+    struct stat st;
+    return stat( sFileName, &st ) == 0 ? st.st_size / ( 1024.0 * 1024.0 ) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main( int argc, char** argv )
+{
+    const int nRepetitions = argc > 1 ? atoi( argv[1] ) : 3;
+
+    BenchCVars cvars;
+    for( size_t ii = 0; ii < NUM_CVARS; ii++ ) {
+        cvars.m_vInts.push_back( &CVarUtils::CreateCVar( CVarName( "int", ii ), 0 ) );
+        cvars.m_vDoubles.push_back( &CVarUtils::CreateCVar( CVarName( "double", ii ), 0.0 ) );
+        cvars.m_vStrings.push_back( &CVarUtils::CreateCVar( CVarName( "string", ii ), std::string() ) );
+    }
+    for( size_t ii = 0; ii < NUM_VECTORS; ii++ ) {
+        cvars.m_vVectors.push_back( &CVarUtils::CreateCVar( CVarName( "vector", ii ), std::vector<float>() ) );
+    }
+
+    SetValues( cvars, true );
+    CVarUtils::SetStreamType( CVARS_XML_STREAM );
+    CVarUtils::Save( XML_FILE_NAME );
+    CVarUtils::SetStreamType( CVARS_JSON_STREAM );
+    CVarUtils::Save( JSON_FILE_NAME );
+
+    const double dXML = TimeLoad( cvars, XML_FILE_NAME, CVARS_XML_STREAM, nRepetitions );
+    const double dJSON = TimeLoad( cvars, JSON_FILE_NAME, CVARS_JSON_STREAM, nRepetitions );
+
+    printf( "format  size (MB)  load (ms)  MB/s\n" );
+    printf( "XML     %9.1f  %9.1f  %6.1f\n", FileSizeMB( XML_FILE_NAME ), dXML,
+            FileSizeMB( XML_FILE_NAME ) * 1000 / dXML );
+    printf( "JSON    %9.1f  %9.1f  %6.1f\n", FileSizeMB( JSON_FILE_NAME ), dJSON,
+            FileSizeMB( JSON_FILE_NAME ) * 1000 / dJSON );
+    if( dXML > 0 && dJSON > 0 ) {
+        printf( "JSON loads %.2fx faster than XML\n", dXML / dJSON );
+    }
+    remove( XML_FILE_NAME );
+    remove( JSON_FILE_NAME );
+    return dXML > 0 && dJSON > 0 ? 0 : 1;
+}
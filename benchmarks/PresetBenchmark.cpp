@@ -0,0 +1,157 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Registers three presets (low, medium and high) over 100k int and 10k
+// string CVars, each preset giving a different value to 10% of them, then
+// times switching between the presets: right after another preset, after a
+// CVar the presets agree on was written through its reference (it must be
+// put back), and by loading the preset file instead.  The values are
+// checked after each switch.
+// Usage: PresetBenchmark [switches]
+
+#include <cvars/CVar.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+const size_t NUM_INTS     = 100000;
+const size_t NUM_STRINGS  = 10000;
+const size_t CHANGED_STEP = 10; // every 10th CVar differs between presets
+const char*  PRESETS[]    = { "low", "medium", "high" };
+const size_t NUM_PRESETS  = sizeof( PRESETS ) / sizeof( PRESETS[0] );
+
+////////////////////////////////////////////////////////////////////////////////
+static std::string FileName( size_t nPreset )
+{
+    return std::string( "PresetBenchmark_" ) + PRESETS[nPreset] + ".txt";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static int IntValue( size_t nPreset, size_t ii )
+{
+    return ii % CHANGED_STEP == 0 ? (int)( ii + 1000000 * nPreset ) : (int)ii;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static std::string StringValue( size_t nPreset, size_t ii )
+{
+    char sValue[64];
+    snprintf( sValue, sizeof( sValue ), "%s%zu", ii % CHANGED_STEP == 0 ? PRESETS[nPreset] : "any", ii );
+    return sValue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void GenerateFile( size_t nPreset )
+{
+    std::ofstream sOut( FileName( nPreset ).c_str() );
+    char sLine[128];
+    for( size_t ii = 0; ii < NUM_INTS; ii++ ) {
+        snprintf( sLine, sizeof( sLine ), "gfx.int%zu = %d\n", ii, IntValue( nPreset, ii ) );
+        sOut << sLine;
+    }
+    for( size_t ii = 0; ii < NUM_STRINGS; ii++ ) {
+        sOut << "gfx.string" << ii << " = " << StringValue( nPreset, ii ) << "\n";
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct BenchCVars
+{
+    std::vector<int*>         m_vInts;
+    std::vector<std::string*> m_vStrings;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static bool CheckValues( BenchCVars& cvars, size_t nPreset )
+{
+    for( size_t ii = 0; ii < NUM_INTS; ii++ ) {
+        if( *cvars.m_vInts[ii] != IntValue( nPreset, ii ) ) {
+            fprintf( stderr, "ERROR: gfx.int%zu = %d with preset %s.\n", ii, *cvars.m_vInts[ii],
+                     PRESETS[nPreset] );
+            return false;
+        }
+    }
+    for( size_t ii = 0; ii < NUM_STRINGS; ii++ ) {
+        if( *cvars.m_vStrings[ii] != StringValue( nPreset, ii ) ) {
+            fprintf( stderr, "ERROR: gfx.string%zu = %s with preset %s.\n", ii,
+                     cvars.m_vStrings[ii]->c_str(), PRESETS[nPreset] );
+            return false;
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Mean time in µs of nSwitches switches cycling through the presets,
+// negative if a value is wrong.  nMode is 0 for ApplyPreset after
+// ApplyPreset, 1 for ApplyPreset after a reference write and 2 for Load.
+static double TimeSwitches( BenchCVars& cvars, int nMode, int nSwitches )
+{
+    double dTotal = 0;
+    for( int nSwitch = 0; nSwitch < nSwitches; nSwitch++ ) {
+        const size_t nPreset = ( nSwitch + 1 ) % NUM_PRESETS;
+        if( nMode == 1 ) {
+            *cvars.m_vInts[1] = -1;
+        }
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if( nMode == 2 ) {
+            CVarUtils::Load( FileName( nPreset ) );
+        }
+        else {
+            CVarUtils::ApplyPreset( PRESETS[nPreset] );
+        }
+        dTotal += std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start ).count();
+        if( !CheckValues( cvars, nPreset ) ) {
+            return -1;
+        }
+    }
+    return dTotal / nSwitches;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main( int argc, char** argv )
+{
+    const int nSwitches = argc > 1 ? atoi( argv[1] ) : 30;
+
+    BenchCVars cvars;
+    char sName[64];
+    for( size_t ii = 0; ii < NUM_INTS; ii++ ) {
+        snprintf( sName, sizeof( sName ), "gfx.int%zu", ii );
+        cvars.m_vInts.push_back( &CVarUtils::CreateCVar( sName, 0 ) );
+    }
+    for( size_t ii = 0; ii < NUM_STRINGS; ii++ ) {
+        snprintf( sName, sizeof( sName ), "gfx.string%zu", ii );
+        cvars.m_vStrings.push_back( &CVarUtils::CreateCVar( sName, std::string() ) );
+    }
+
+    CVarUtils::SetStreamType( CVARS_TXT_STREAM );
+    for( size_t nPreset = 0; nPreset < NUM_PRESETS; nPreset++ ) {
+        GenerateFile( nPreset );
+        CVarUtils::RegisterPreset( PRESETS[nPreset], FileName( nPreset ) );
+    }
+    CVarUtils::ApplyPreset( PRESETS[0] );
+
+    const char* sModes[] = { "ApplyPreset after ApplyPreset", "ApplyPreset after a write",
+                             "Load of the preset file" };
+    printf( "%zu CVars, %zu changed per switch\n", NUM_INTS + NUM_STRINGS,
+            ( NUM_INTS + NUM_STRINGS ) / CHANGED_STEP );
+    printf( "switch                          latency (us)\n" );
+    int nErrors = 0;
+    for( int nMode = 0; nMode < 3; nMode++ ) {
+        const double dUs = TimeSwitches( cvars, nMode, nSwitches );
+        nErrors += dUs < 0;
+        printf( "%-30s  %12.1f\n", sModes[nMode], dUs );
+    }
+    for( size_t nPreset = 0; nPreset < NUM_PRESETS; nPreset++ ) {
+        remove( FileName( nPreset ).c_str() );
+    }
+    return nErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Saves 300k CVars (ints, doubles and strings in nested namespaces) as XML
+// and as TXT with Save, and with the previous savers kept below (a trie
+// lookup of the indentation CVars per line for XML, a std::endl per line for
+// both), checks that each file Save wrote loads back and prints the best
+// save times.
+// Usage: SaveBenchmark [repetitions]
+
+#include <cvars/CVar.h>
+#include <cvars/XMLCVarReader.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+const size_t NUM_CVARS  = 100000;
+const size_t GROUP_SIZE = 100;
+const char*  FILE_NAME  = "SaveBenchmark.out";
+
+////////////////////////////////////////////////////////////////////////////////
+static std::string CVarName( const char* sKind, size_t ii )
+{
+    char sName[96];
+    snprintf( sName, sizeof( sName ), "bench.group%zu.%s%zu", ii / GROUP_SIZE, sKind, ii );
+    return sName;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct BenchCVars
+{
+    std::vector<int*>         m_vInts;
+    std::vector<double*>      m_vDoubles;
+    std::vector<std::string*> m_vStrings;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static void SetValues( BenchCVars& cvars, bool bExpected )
+{
+    for( size_t ii = 0; ii < cvars.m_vInts.size(); ii++ ) {
+        *cvars.m_vInts[ii] = bExpected ? (int)ii : -1;
+        *cvars.m_vDoubles[ii] = bExpected ? ii % 1000 + 0.5 : -1;
+        *cvars.m_vStrings[ii] = bExpected ? "value" + std::to_string( ii ) : std::string();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool CheckValues( BenchCVars& cvars )
+{
+    for( size_t ii = 0; ii < cvars.m_vInts.size(); ii++ ) {
+        if( *cvars.m_vInts[ii] != (int)ii || *cvars.m_vDoubles[ii] != ii % 1000 + 0.5 ||
+            *cvars.m_vStrings[ii] != "value" + std::to_string( ii ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The previous XML saver: the indentation CVars looked up by name for every
+// line, the escaping in a temporary string, a flush per line.
+static void SaveXMLBefore( const std::string& sFileName )
+{
+    std::ofstream stream( sFileName.c_str() );
+    const std::vector<void*>& vCVars = CVarUtils::TrieInstance().GetAllCVars();
+    stream << std::string( std::max( 0, CVarUtils::GetCVar<int>( "console.CVarIndent" ) ), ' ' )
+           << "<cvars>" << std::endl;
+    for( size_t ii = 0; ii < vCVars.size(); ii++ ) {
+        CVarUtils::CVar<int>* pCVar = (CVarUtils::CVar<int>*)vCVars[ii];
+        const std::string sVal = pCVar->GetValueAsString();
+        if( sVal.empty() || !pCVar->m_bSerialise ) {
+            continue;
+        }
+        CVarUtils::GetCVarRef<int>( "console.CVarIndent" ) += CVarUtils::GetCVar<int>( "console.CVarIndentIncr" );
+        stream << std::string( std::max( 0, CVarUtils::GetCVar<int>( "console.CVarIndent" ) ), ' ' )
+               << "<" << pCVar->m_sVarName << ">  ";
+        CVarUtils::GetCVarRef<int>( "console.CVarIndent" ) += CVarUtils::GetCVar<int>( "console.CVarIndentIncr" );
+        std::string sEscaped;
+        AppendXMLText( sEscaped, sVal.data(), sVal.size() );
+        stream << sEscaped;
+        CVarUtils::GetCVarRef<int>( "console.CVarIndent" ) -= CVarUtils::GetCVar<int>( "console.CVarIndentIncr" );
+        stream << std::string( std::max( 0, CVarUtils::GetCVar<int>( "console.CVarIndent" ) ), ' ' )
+               << "</" << pCVar->m_sVarName << ">" << std::endl;
+        CVarUtils::GetCVarRef<int>( "console.CVarIndent" ) -= CVarUtils::GetCVar<int>( "console.CVarIndentIncr" );
+    }
+    stream << "</cvars>" << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The previous TXT saver: a flush per line.
+static void SaveTXTBefore( const std::string& sFileName )
+{
+    std::ofstream stream( sFileName.c_str() );
+    const std::vector<void*>& vCVars = CVarUtils::TrieInstance().GetAllCVars();
+    for( size_t ii = 0; ii < vCVars.size(); ii++ ) {
+        CVarUtils::CVar<int>* pCVar = (CVarUtils::CVar<int>*)vCVars[ii];
+        const std::string sVal = pCVar->GetValueAsString();
+        if( !sVal.empty() && pCVar->m_bSerialise ) {
+            stream << pCVar->m_sVarName << " = " << sVal << std::endl;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Best time in ms of nRepetitions calls to save.
+template <class Func>
+static double TimeSave( Func save, int nRepetitions )
+{
+    double dBest = 1e30;
+    for( int nRep = 0; nRep < nRepetitions; nRep++ ) {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        save();
+        dBest = std::min( dBest, std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start ).count() );
+    }
+    return dBest;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main( int argc, char** argv )
+{
+    const int nRepetitions = argc > 1 ? atoi( argv[1] ) : 3;
+
+    BenchCVars cvars;
+    for( size_t ii = 0; ii < NUM_CVARS; ii++ ) {
+        cvars.m_vInts.push_back( &CVarUtils::CreateCVar( CVarName( "int", ii ), 0 ) );
+        cvars.m_vDoubles.push_back( &CVarUtils::CreateCVar( CVarName( "double", ii ), 0.0 ) );
+        cvars.m_vStrings.push_back( &CVarUtils::CreateCVar( CVarName( "string", ii ), std::string() ) );
+    }
+    SetValues( cvars, true );
+
+    const CVARS_STREAM_TYPE streamTypes[] = { CVARS_XML_STREAM, CVARS_TXT_STREAM };
+    const char* sFormats[] = { "XML", "TXT" };
+    printf( "%zu CVars\n", 3 * NUM_CVARS );
+    printf( "format  before (ms)  after (ms)  speedup\n" );
+    int nErrors = 0;
+    for( int nFormat = 0; nFormat < 2; nFormat++ ) {
+        const double dBefore = TimeSave( [nFormat]() {
+                if( nFormat == 0 ) {
+                    SaveXMLBefore( FILE_NAME );
+                }
+                else {
+                    SaveTXTBefore( FILE_NAME );
+                }
+            }, nRepetitions );
+
+        CVarUtils::SetStreamType( streamTypes[nFormat] );
+        const double dAfter = TimeSave( []() { CVarUtils::Save( FILE_NAME ); }, nRepetitions );
+
+        SetValues( cvars, false );
+        CVarUtils::Load( FILE_NAME );
+        if( !CheckValues( cvars ) ) {
+            fprintf( stderr, "ERROR: wrong values after loading the %s file.\n", sFormats[nFormat] );
+            nErrors++;
+        }
+        SetValues( cvars, true );
+        printf( "%-6s  %11.1f  %10.1f  %6.1fx\n", sFormats[nFormat], dBefore, dAfter, dBefore / dAfter );
+    }
+    remove( FILE_NAME );
+    return nErrors == 0 ? 0 : 1;
+}
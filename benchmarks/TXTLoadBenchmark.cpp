@@ -0,0 +1,108 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Loads a generated TXT settings file (200k CVars, half of them in sections,
+// each set five times, ~45 MB) with 1, 2, 4, 8 and 16 parsing threads (see
+// SetLoadThreads), checks the values and prints the load times.
+// Usage: TXTLoadBenchmark [max threads] [repetitions]
+
+#include <cvars/CVar.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+const size_t NUM_CVARS   = 200000;
+const size_t NUM_PASSES  = 5;
+const size_t SECTION_SIZE = 1000;
+const char*  FILE_NAME   = "TXTLoadBenchmark.txt";
+
+////////////////////////////////////////////////////////////////////////////////
+static std::string CVarName( size_t ii )
+{
+    char sName[64];
+    if( ii < NUM_CVARS / 2 ) {
+        snprintf( sName, sizeof( sName ), "top.var%zu", ii );
+    }
+    else {
+        snprintf( sName, sizeof( sName ), "section%zu.var%zu", ii / SECTION_SIZE, ii );
+    }
+    return sName;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The last pass sets CVar ii to ii.
+static void GenerateFile()
+{
+    std::ofstream sOut( FILE_NAME );
+    char sLine[128];
+    for( size_t nPass = 0; nPass < NUM_PASSES; nPass++ ) {
+        const int nOffset = (int)( NUM_PASSES - 1 - nPass ) * 3;
+        sOut << "[]\n# top level\n";
+        for( size_t ii = 0; ii < NUM_CVARS / 2; ii++ ) {
+            snprintf( sLine, sizeof( sLine ), "top.var%zu = %zu\n", ii, ii + nOffset );
+            sOut << sLine;
+        }
+        for( size_t ii = NUM_CVARS / 2; ii < NUM_CVARS; ii++ ) {
+            if( ii % SECTION_SIZE == 0 ) {
+                sOut << "[section" << ii / SECTION_SIZE << "]\n";
+            }
+            snprintf( sLine, sizeof( sLine ), "var%zu = %zu\n", ii, ii + nOffset );
+            sOut << sLine;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main( int argc, char** argv )
+{
+    const unsigned int nMaxThreads = argc > 1 ? atoi( argv[1] ) : 16;
+    const int nRepetitions = argc > 2 ? atoi( argv[2] ) : 3;
+
+    std::vector<int*> vValues( NUM_CVARS );
+    for( size_t ii = 0; ii < NUM_CVARS; ii++ ) {
+        vValues[ii] = &CVarUtils::CreateCVar( CVarName( ii ), -1 );
+    }
+    GenerateFile();
+    CVarUtils::SetStreamType( CVARS_TXT_STREAM );
+
+    printf( "%u hardware threads\n", std::thread::hardware_concurrency() );
+    printf( "threads  load (ms)  speedup\n" );
+    double dSingle = 0;
+    int nErrors = 0;
+    for( unsigned int nThreads = 1; nThreads <= nMaxThreads; nThreads *= 2 ) {
+        CVarUtils::SetLoadThreads( nThreads );
+        double dBest = 1e30;
+        for( int nRep = 0; nRep < nRepetitions; nRep++ ) {
+            for( size_t ii = 0; ii < NUM_CVARS; ii++ ) {
+                *vValues[ii] = -1;
+            }
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            CVarUtils::Load( FILE_NAME );
+            const double dMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start ).count();
+            dBest = std::min( dBest, dMs );
+            for( size_t ii = 0; ii < NUM_CVARS; ii++ ) {
+                if( *vValues[ii] != (int)ii ) {
+                    fprintf( stderr, "ERROR: %s = %d after loading with %u threads.\n",
+                             CVarName( ii ).c_str(), *vValues[ii], nThreads );
+                    nErrors++;
+                    break;
+                }
+            }
+        }
+        if( nThreads == 1 ) {
+            dSingle = dBest;
+        }
+        printf( "%7u  %9.1f  %7.2f\n", nThreads, dBest, dSingle / dBest );
+    }
+    remove( FILE_NAME );
+    return nErrors == 0 ? 0 : 1;
+}
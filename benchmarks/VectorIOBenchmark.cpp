@@ -0,0 +1,132 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Formats and parses a std::vector<float> of 1M elements with the vector
+// stream operators of CVarVectorIO.h, and with the previous ones (a stream
+// insertion per element, and a stringstream per element plus a re-format to
+// validate it), checks the values and prints the best times of each.
+// Usage: VectorIOBenchmark [repetitions]
+
+#include <cvars/CVar.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+const size_t VECTOR_SIZE = 1000000;
+
+////////////////////////////////////////////////////////////////////////////////
+// At most 6 significant digits, so the previous operators keep them too.
+static float ElementValue( size_t ii )
+{
+    return ( ii % 10000 ) * 0.25f - 1000.0f;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The previous operator<<.
+static void WriteBefore( std::ostream& stream, const std::vector<float>& vT )
+{
+    if( vT.size() == 0 ) {
+        stream << "[ ]";
+        return;
+    }
+    stream << "[ " << vT[0];
+    for( size_t i = 1; i < vT.size(); i++ ) {
+        stream << " " << vT[i];
+    }
+    stream << " ]";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The previous operator>>.
+static void ReadBefore( std::istream& stream, std::vector<float>& vT )
+{
+    std::string sBuf;
+    vT.clear();
+    while( stream >> sBuf ) {
+        if( sBuf.find( "[" ) == std::string::npos &&
+            sBuf.find( "]" ) == std::string::npos ) {
+            float TVal;
+            std::stringstream( sBuf ) >> TVal;
+            std::stringstream sCheck;
+            sCheck << TVal;
+            if( sBuf != sCheck.str() ) {
+                printf( "ERROR deserialising vector, ignoring \"%s\" value.\n", sBuf.c_str() );
+                continue;
+            }
+            vT.push_back( TVal );
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool CheckValues( const std::vector<float>& vT, const char* sWhat )
+{
+    bool bOk = vT.size() == VECTOR_SIZE;
+    for( size_t ii = 0; bOk && ii < vT.size(); ii++ ) {
+        bOk = vT[ii] == ElementValue( ii );
+    }
+    if( !bOk ) {
+        fprintf( stderr, "ERROR: wrong values parsed %s.\n", sWhat );
+    }
+    return bOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static double MsSince( const std::chrono::steady_clock::time_point& start )
+{
+    return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main( int argc, char** argv )
+{
+    const int nRepetitions = argc > 1 ? atoi( argv[1] ) : 3;
+
+    std::vector<float> vValues( VECTOR_SIZE );
+    for( size_t ii = 0; ii < VECTOR_SIZE; ii++ ) {
+        vValues[ii] = ElementValue( ii );
+    }
+
+    double dWriteBefore = 1e30, dWriteAfter = 1e30, dReadBefore = 1e30, dReadAfter = 1e30;
+    std::string sBefore, sAfter;
+    int nErrors = 0;
+    for( int nRep = 0; nRep < nRepetitions; nRep++ ) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::ostringstream ossBefore;
+        WriteBefore( ossBefore, vValues );
+        sBefore = ossBefore.str();
+        dWriteBefore = std::min( dWriteBefore, MsSince( start ) );
+
+        start = std::chrono::steady_clock::now();
+        std::ostringstream ossAfter;
+        CVarUtils::operator<<( ossAfter, vValues );
+        sAfter = ossAfter.str();
+        dWriteAfter = std::min( dWriteAfter, MsSince( start ) );
+
+        std::vector<float> vRead;
+        start = std::chrono::steady_clock::now();
+        std::istringstream issBefore( sBefore );
+        ReadBefore( issBefore, vRead );
+        dReadBefore = std::min( dReadBefore, MsSince( start ) );
+        nErrors += !CheckValues( vRead, "before" );
+
+        start = std::chrono::steady_clock::now();
+        std::istringstream issAfter( sAfter );
+        CVarUtils::operator>>( issAfter, vRead );
+        dReadAfter = std::min( dReadAfter, MsSince( start ) );
+        nErrors += !CheckValues( vRead, "after" );
+    }
+
+    printf( "%zu floats, %.1f MB of text\n", VECTOR_SIZE, sAfter.size() / ( 1024.0 * 1024.0 ) );
+    printf( "step    before (ms)  after (ms)  speedup\n" );
+    printf( "format  %11.1f  %10.1f  %6.1fx\n", dWriteBefore, dWriteAfter, dWriteBefore / dWriteAfter );
+    printf( "parse   %11.1f  %10.1f  %6.1fx\n", dReadBefore, dReadAfter, dReadBefore / dReadAfter );
+    return nErrors == 0 ? 0 : 1;
+}
@@ -1446,12 +1446,8 @@ inline void FLConsoleInstance::HistoryForward()
 ////////////////////////////////////////////////////////////////////////////////
 inline bool FLConsoleInstance::_IsConsoleFunc( TrieNode *node )
 {
-    if( typeid( ConsoleFunc ).name() 
-            == ((CVarUtils::CVar<int>*)node->m_pNodeData)->type() ) {
-        return true;
-    }
-
-    return false; 
+    // plain and typed (CVarUtils::CreateCommand) functions
+    return CVarUtils::IsConsoleFunc( node );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1647,10 +1643,6 @@ inline void FLConsoleInstance::_TabComplete()
 // [Command] //prints out the command's value
 inline bool FLConsoleInstance::_ProcessCurrentCommand( bool bExecute )
 {
-    //trie version
-    //int error = 0;
-    TrieNode*node;
-    std::string sRes;
     bool bSuccess = true;
 
     Trie& trie = CVarUtils::TrieInstance();
@@ -1671,72 +1663,35 @@ inline bool FLConsoleInstance::_ProcessCurrentCommand( bool bExecute )
         EnterLogLine( m_sCurrentCommand.c_str(), LINEPROP_COMMAND, false );
     }
 
-    // Simply print value if the command is just a variable
-    if( ( node = trie.Find( m_sCurrentCommand ) ) ) {
-        //execute function if this is a function cvar
-        if( _IsConsoleFunc( node ) ) {
-            bSuccess &= CVarUtils::ExecuteFunction( m_sCurrentCommand, (CVarUtils::CVar<ConsoleFunc>*) node->m_pNodeData, sRes, bExecute );
-            EnterLogLine( m_sCurrentCommand.c_str(), LINEPROP_FUNCTION );
-        }
-        else { //print value associated with this cvar
-            EnterLogLine( ( m_sCurrentCommand + " = " + 
-                        CVarUtils::GetValueAsString(node->m_pNodeData)).c_str(), LINEPROP_LOG );
-        }
-    }
-    //see if it is an assignment or a function execution (with arguments)
-    else {
-        int eq_pos; //get the position of the equal sign
-        //see if this an assignment
-        if( ( eq_pos = m_sCurrentCommand.find( "=" ) ) != -1 ) {
-            std::string command, value;
-            std::string tmp = m_sCurrentCommand.substr(0, eq_pos ) ;
-            command = RemoveSpaces( tmp );
-            value = m_sCurrentCommand.substr( eq_pos+1, m_sCurrentCommand.length() );
-            if( !value.empty() ) { 
-                value = RemoveSpaces( value );
-                if( ( node = trie.Find(command) ) ) {
-                    if( bExecute ) {
-                        CVarUtils::SetValueFromString( node->m_pNodeData, value );
-                    }
-                    EnterLogLine( ( command + " = " + value ).c_str(), LINEPROP_LOG );
-                }
-            }
-            else {  
-                if( bExecute ) {
-                    std::string out = "-glconsole: " + command + ": command not found"; 
-                    EnterLogLine( out.c_str(), LINEPROP_ERROR );
-                }
-                bSuccess = false;
-            }
+    // the commands of the line, lexed and run as by CVarUtils::ProcessCommand
+    bool bEmpty = true;
+    std::string_view sLine( m_sCurrentCommand ), sCmd;
+    while( CVarUtils::NextCommand( sLine, sCmd ) ) {
+        if( sCmd.empty() ) {
+            continue;
         }
-        //check if this is a function
-        else if( ( eq_pos = m_sCurrentCommand.find(" ") ) != -1 ) {
-            std::string function;
-            function = m_sCurrentCommand.substr( 0, eq_pos );
-            //check if this is a valid function name
-            if( ( node = trie.Find( function ) ) && _IsConsoleFunc( node ) ) {
-                bSuccess &= CVarUtils::ExecuteFunction( m_sCurrentCommand, (CVarUtils::CVar<ConsoleFunc>*)node->m_pNodeData, sRes, bExecute );
-                EnterLogLine( m_sCurrentCommand.c_str(), LINEPROP_FUNCTION );
-            }
-            else {
-                if( bExecute ) {
-                    std::string out = "-glconsole: " + function + ": function not found"; 
-                    EnterLogLine( out.c_str(), LINEPROP_ERROR );
-                }
-                bSuccess = false;
-            }
+        bEmpty = false;
+        const std::string sCommand( sCmd );
+        const std::string sName = sCommand.substr( 0, sCommand.find_first_of( " \t=" ) );
+        TrieNode* node = trie.Find( sName );
+        const bool bFunction = node != NULL && _IsConsoleFunc( node );
+
+        std::string sRes;
+        const bool bCmdSuccess = CVarUtils::ProcessCommand( sCommand, sRes, bExecute );
+        bSuccess &= bCmdSuccess;
+        if( bFunction ) {
+            EnterLogLine( sCommand.c_str(), LINEPROP_FUNCTION );
         }
-        else if( !m_sCurrentCommand.empty() ) {
-            if( bExecute ) {
-                std::string out = "-glconsole: " + m_sCurrentCommand + ": command not found"; 
-                EnterLogLine( out.c_str(), LINEPROP_ERROR );
-            }
-            bSuccess = false;
+        else if( bCmdSuccess ) { // value printed or assigned
+            EnterLogLine( ( sName + " = " + sRes ).c_str(), LINEPROP_LOG );
         }
-        else { // just pressed enter
-            EnterLogLine( " ", LINEPROP_LOG );
+        else if( bExecute ) {
+            EnterLogLine( ( "-glconsole: " + sRes ).c_str(), LINEPROP_ERROR );
         }
     }
+    if( bEmpty ) { // just pressed enter
+        EnterLogLine( " ", LINEPROP_LOG );
+    }
 
     return bSuccess;
 }
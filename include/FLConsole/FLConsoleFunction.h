@@ -70,11 +70,10 @@ inline bool ConsoleSave( std::vector<std::string> *vArgs )
         }
     }
 
+    // written in the background so the console does not stall, errors are
+    // reported on std::cerr
     pConsole->Printf( "Saving cvars to \"%s\".", sFile.c_str() );
-    if( !CVarUtils::Save( sFile, vAcceptedSubstrings ) ) {
-        pConsole->PrintError( "Error saving file.\n" );
-        return false;
-    }
+    CVarUtils::SaveAsync( sFile, vAcceptedSubstrings );
 
     return true;
 }
@@ -79,11 +79,10 @@ inline bool ConsoleSave( std::vector<std::string> *vArgs )
         }
     }
 
+    // written in the background so the console does not stall, errors are
+    // reported on std::cerr
     pConsole->Printf( "Saving cvars to \"%s\".", sFile.c_str() );
-    if( !CVarUtils::Save( sFile, vAcceptedSubstrings ) ) {
-        pConsole->PrintError( "Error saving file.\n" );
-        return false;
-    }
+    CVarUtils::SaveAsync( sFile, vAcceptedSubstrings );
 
     return true;
 }
@@ -111,6 +110,80 @@ inline bool ConsoleLoad( std::vector<std::string> *vArgs )
     return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/**
+ * Watches a file, arguments as for load: the CVars are reloaded from it each
+ * time it is saved.
+ */
+inline bool ConsoleWatch( std::vector<std::string> *vArgs )
+{
+    GLConsole* pConsole = GetConsole();
+    std::string sFile = "cvars.xml";
+    std::vector< std::string > vAcceptedSubstrings;
+
+    if( vArgs != NULL && vArgs->size() > 0 ) {
+        sFile = vArgs->at( 0 );
+        for( size_t i=1; i<vArgs->size(); i++ ) {
+            vAcceptedSubstrings.push_back( vArgs->at(i) );
+        }
+    }
+    if( CVarUtils::WatchFile( sFile, vAcceptedSubstrings ) ) {
+        pConsole->Printf( "Watching file \"%s\".", sFile.c_str() );
+    }
+    else {
+        pConsole->PrintError( "Error: Could not watch \"%s\".", sFile.c_str() );
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/**
+ * Stops watching a file.
+ */
+inline bool ConsoleUnwatch( std::vector<std::string> *vArgs )
+{
+    std::string sFile = "cvars.xml";
+    if( vArgs != NULL && vArgs->size() > 0 ) {
+        sFile = vArgs->at( 0 );
+    }
+    CVarUtils::UnwatchFile( sFile );
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/**
+ * "preset" lists the presets, "preset name" switches to one and
+ * "preset name file [filters]" registers one from a file.
+ */
+inline bool ConsolePreset( std::vector<std::string> *vArgs )
+{
+    GLConsole* pConsole = GetConsole();
+    if( vArgs == NULL || vArgs->empty() ) {
+        const std::vector<std::string> vNames = CVarUtils::GetPresetNames();
+        for( size_t i=0; i<vNames.size(); i++ ) {
+            pConsole->Printf( "%s%s", vNames[i].c_str(),
+                              vNames[i] == CVarUtils::GetActivePreset() ? " (active)" : "" );
+        }
+        return true;
+    }
+    const std::string& sName = vArgs->at( 0 );
+    if( vArgs->size() > 1 ) {
+        std::vector< std::string > vAcceptedSubstrings( vArgs->begin() + 2, vArgs->end() );
+        if( !CVarUtils::RegisterPreset( sName, vArgs->at( 1 ), vAcceptedSubstrings ) ) {
+            pConsole->PrintError( "Error: Could not read \"%s\".", vArgs->at( 1 ).c_str() );
+        }
+        return true;
+    }
+    const int nChanged = CVarUtils::ApplyPreset( sName );
+    if( nChanged < 0 ) {
+        pConsole->PrintError( "Error: No preset \"%s\".", sName.c_str() );
+    }
+    else {
+        pConsole->Printf( "Preset \"%s\": %d CVars changed.", sName.c_str(), nChanged );
+    }
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /**
  * Exits program from command line
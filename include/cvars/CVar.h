@@ -30,16 +30,25 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <fstream>
 #include <iostream>
 #include <typeinfo>
 #include <algorithm>
 #include <memory>
+#include <type_traits>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <functional>
+#include <future>
 
 #include <cvars/Trie.h>
 #include <cvars/TrieNode.h>
 #include <cvars/CVarVectorIO.h>
+#include <cvars/CVarArrayIO.h>
+#include <cvars/CVarBinaryIO.h>
 
 // Console functions must have the following signature
 typedef bool (*ConsoleFunc)( std::vector<std::string> *args);
@@ -154,6 +163,98 @@ namespace CVarUtils
             iss >> *t;
         }
 
+    // Strings take the whole value, blanks included (e.g. c.str = two words).
+    inline void StringToCVarValue( std::string *t, const std::string &sValue )
+    {
+        *t = sValue;
+    }
+
+    inline void StringToCVarValue( CVarRef<std::string> *t, const std::string &sValue )
+    {
+        *t->var = sValue;
+    }
+
+    // character arrays: at most N - 1 characters and the terminating zero
+    template <size_t N>
+        void StringToCVarValue( char (*t)[N], const std::string &sValue )
+        {
+            const size_t nLength = std::min( sValue.size(), N - 1 );
+            sValue.copy( *t, nLength );
+            (*t)[nLength] = '\0';
+        }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Numeric view of a CVar, used when a CVar is an input of a derived CVar (see
+    // CVarExpression.h).  Arithmetic types are read directly, other types go
+    // through their string representation.
+    template <class T, bool bArithmetic = std::is_arithmetic<T>::value>
+        struct CVarNumeric
+        {
+            static double (*ValueFunc())( T* ) { return NULL; }
+            static void Assign( void*, double ) {}
+        };
+
+    template <class T>
+        struct CVarNumeric<T,true>
+        {
+            static double Value( T *t ) { return static_cast<double>( *t ); }
+            static double (*ValueFunc())( T* ) { return Value; }
+            static void Assign( void *pVarData, double dValue ) {
+                *(T*)pVarData = std::is_integral<T>::value ?
+                    static_cast<T>( std::llround( dValue ) ) : static_cast<T>( dValue );
+            }
+        };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Heap copies of a CVar value (see CVar::CloneValue), C arrays are copied
+    // element by element.  TrivialSize is the number of bytes to memcpy
+    // instead, 0 if the type is not trivially copyable.
+    template <class T>
+        struct CVarValueCopy
+        {
+            static void* Clone( T *t ) { return new T( *t ); }
+            static void Assign( T *t, const void *pCopy ) { *t = *(const T*)pCopy; }
+            static void Destroy( void *pCopy ) { delete (T*)pCopy; }
+            static size_t TrivialSize() { return std::is_trivially_copyable<T>::value ? sizeof( T ) : 0; }
+        };
+
+    template <class T, size_t N>
+        struct CVarValueCopy<T[N]>
+        {
+            static void* Clone( T (*t)[N] ) {
+                T* pCopy = new T[N];
+                std::copy( *t, *t + N, pCopy );
+                return pCopy;
+            }
+            static void Assign( T (*t)[N], const void *pCopy ) {
+                std::copy( (const T*)pCopy, (const T*)pCopy + N, *t );
+            }
+            static void Destroy( void *pCopy ) { delete[] (T*)pCopy; }
+            static size_t TrivialSize() { return std::is_trivially_copyable<T>::value ? sizeof( T[N] ) : 0; }
+        };
+
+    class CVarDerivation;
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Called after a CVar was written through SetCVar, the console or Load:
+    /// recomputes the derived CVars depending on it, each once and after all
+    /// of its inputs, then notifies them.  Lives in CVar.cpp.
+    void NotifyCVarChanged( void* pCVar );
+    /// The same for nCVars CVars written together (e.g. RestoreSnapshot).
+    void NotifyCVarsChanged( void* const* ppCVars, size_t nCVars );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Call this after writing a CVar through a reference if derived CVars
+    /// depend on it.
+    void NotifyChanged( const std::string& s );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Recomputes a derived CVar.  Lives in CVarExpression.cpp.
+    void RefreshDerivedCVar( void* pCVar );
+    void ReleaseCVarDerivation( CVarDerivation* pDerivation );
+    // Unlinks a CVar being destroyed from the derivations reading it.
+    void DetachCVarDependents( void* pCVar );
+
     ////////////////////////////////////////////////////////////////////////////////
     /** These functions must be called to create a CVar, they return a reference to
      *  the value saved.
@@ -241,7 +342,8 @@ namespace CVarUtils
      *  created CVar.
      *
      *  The exception "CVarUtils::CVarNonExistant" will be thrown if
-     *  the value does not exist.
+     *  the value does not exist, "CVarUtils::ReadOnlyCVar" if it is a
+     *  derived CVar.
      *  eg. CVarUtils::SetCVar<int>( "gui.Width", 20 );
      */
     template <class T> void SetCVar( const char* s, T val );
@@ -269,8 +371,42 @@ namespace CVarUtils
     /// - CVARS_XML_STREAM is the default
     /// - TXT_XML_STREAM is another option where the format is 'cvar_name = cvar_value' per line
     /// with commented lines starting by '#' or '//'
+    /// - CVARS_JSON_STREAM writes an object, dotted namespaces as nested objects
     inline void SetStreamType( const CVARS_STREAM_TYPE& stream_type );
 
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Changes how numeric arrays (std::vector of numbers) are saved in XML and
+    /// TXT files, options:
+    /// - CVARS_ARRAY_TEXT is the default: "[ 1 2 3 ]"
+    /// - CVARS_ARRAY_BASE64 writes the values as little-endian binary, base64
+    /// encoded, for arrays of at least nMinElements elements.
+    /// Both forms are always recognised when loading.
+    inline void SetArrayEncoding( const CVARS_ARRAY_ENCODING& encoding,
+                                  size_t nMinElements = 64 );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Groups the CVars by dot separated namespace when saving XML and TXT, so
+    /// each prefix is written once:
+    /// - XML: "<renderer.> <shadows.> <size>  1024</size> </shadows.> </renderer.>",
+    ///   an element whose name ends with '.' holds the CVars of that namespace,
+    /// - TXT: a "[renderer.shadows]" line followed by "size = 1024".
+    /// Grouped and flat files are both always recognised when loading.
+    inline void SetGroupedNames( bool bGrouped );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Number of threads parsing large TXT files in Load, 0 (the default) uses
+    /// one per core.  Values are always applied in file order.
+    inline void SetLoadThreads( unsigned int nThreads );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Lets Load skip a file when neither it (nor its delta) nor the CVars
+     *  changed since it was last saved or loaded with the same filters and
+     *  stream type.  Off by default (CVARS_ALWAYS_LOAD).  The CVar values are
+     *  compared with the ones recorded, so writes through the references
+     *  returned by CreateCVar are seen too.  Implemented in CVarFileState.cpp.
+     */
+    inline void SetUnchangedLoads( const CVARS_UNCHANGED_LOADS& unchangedLoads );
+
     ////////////////////////////////////////////////////////////////////////////////
     /** This function saves the CVars to "sFileName", it takes an optional
      *  argument that is a vector of substrings indicating the CVars that should
@@ -279,6 +415,7 @@ namespace CVarUtils
      *  If this vector is empty, all the CVars are saved.
      *  If "not" is add to the list, all the following substrings will not be saved.
      *  If "true" is used as the last argument, the saving will be verbose.
+     *  Any "sFileName.delta" left by SaveDelta is removed.
      */
     inline bool Save( const std::string& sFileName,
                       std::vector<std::string> vFilterSubstrings=std::vector<std::string>() );
@@ -291,10 +428,190 @@ namespace CVarUtils
      *  If this vector is empty, all the CVars are loaded.
      *  If "not" is add to the list, all the following substrings will not be loaded.
      *  If "true" is used as the last argument, the loading will be verbose.
+     *  Values of CVars that do not exist yet are kept and applied when the
+     *  CVar is created (see ClearPendingValues).
+     *  Waits for the pending SaveAsync calls first, so a file being saved in
+     *  the background is read once written.
      */
     inline bool Load( const std::string& sFileName,
                       std::vector<std::string> vFilterSubstrings=std::vector<std::string>() );
 
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Drops the values Load (or ApplyArgs, ApplyEnvironment) kept for CVars
+    /// not created yet, e.g. once all the plugins are registered.
+    inline void ClearPendingValues();
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Applies the CVar overrides among the program arguments, given as
+     *  "+name=value", "--cvar name=value" or "--cvar=name=value"; the other
+     *  arguments are ignored.  All are parsed, then applied in one pass
+     *  looking the CVars up by name hash; values of CVars that do not exist
+     *  yet are kept apart from those of Load and applied after them (and
+     *  after ApplyEnvironment's) when the CVar is created.  Call it after
+     *  Load so the overrides of existing CVars win.
+     *  Returns the number of overrides.  Implemented in CVarOverrides.cpp.
+     */
+    size_t ApplyArgs( int argc, const char* const* argv );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** As ApplyArgs for the environment variables starting with sPrefix:
+     *  "MYAPP_RENDERER_SHADOWS=1" with the prefix "MYAPP_" sets the CVar
+     *  whose name, in upper case with '.' replaced by '_', is
+     *  "RENDERER_SHADOWS" (e.g. "renderer.shadows"), now or when it is
+     *  created.
+     */
+    size_t ApplyEnvironment( const std::string& sPrefix );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Saves only the CVars whose value changed since the last Save, Load or
+     *  SaveDelta of "sFileName", appending them to "sFileName.delta" (TXT
+     *  format).  Load applies the delta after the file itself, a full Save
+     *  removes it.  When the delta grows larger than half of the file (or if
+     *  there is no file yet) a full Save is done instead.  Filters are as for
+     *  Save.  Implemented in CVarDelta.cpp.
+     */
+    bool SaveDelta( const std::string& sFileName,
+                    std::vector<std::string> vFilterSubstrings=std::vector<std::string>() );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Saves like Save without blocking the caller: the values are copied on
+     *  the calling thread, then formatted and written by a background thread
+     *  to "sFileName.tmp", which replaces "sFileName" once complete.  The
+     *  returned future (and the optional callback, called on the background
+     *  thread with the error message on failure) gives the result.  Requests
+     *  are written in order.  Implemented in CVarAsyncSave.cpp.
+     */
+    std::future<bool> SaveAsync( const std::string& sFileName,
+                                 std::vector<std::string> vFilterSubstrings=std::vector<std::string>(),
+                                 std::function<void( bool, const std::string& )> callback=nullptr );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Blocks until every pending SaveAsync has been written.
+    void WaitForAsyncSaves();
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Watches "sFileName" (and "sFileName.delta") for changes, with inotify
+     *  on a background thread (Linux only, false elsewhere).  Once the file
+     *  has not been written for nDebounceMs, the next ApplyWatchedFiles
+     *  reloads it with the given filters and the stream type in use now.
+     *  Implemented in CVarFileWatch.cpp.
+     */
+    bool WatchFile( const std::string& sFileName,
+                    std::vector<std::string> vFilterSubstrings=std::vector<std::string>(),
+                    unsigned int nDebounceMs=200 );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void UnwatchFile( const std::string& sFileName );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Reloads the watched files that changed; only the CVars whose value
+     *  differs are notified.  Call it from the thread using the CVars, e.g.
+     *  once per frame (GLConsole::RenderConsole does).  Returns the number
+     *  of files loaded.
+     */
+    size_t ApplyWatchedFiles();
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Journal mode, for crash safe settings without rewriting the file on
+     *  each change: loads the binary snapshot "sFileName" and replays
+     *  "sFileName.journal" over it, then appends each change notified to a
+     *  saved CVar (SetCVar, the console, Load, NotifyChanged) to the journal
+     *  as a binary record, flushed right away.  Once the journal grows over
+     *  nCompactBytes it is folded into a new snapshot written in the
+     *  background (see SaveAsync).  Implemented in CVarJournal.cpp.
+     */
+    bool OpenJournal( const std::string& sFileName, size_t nCompactBytes=1<<20 );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Folds the journal into a new snapshot now, false if there is no journal
+    /// or the previous compaction is still being written.
+    bool CompactJournal();
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Stops journaling, the snapshot and the journal stay as they are.
+    void CloseJournal();
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Values of a set of CVars held in memory, to switch between settings
+     *  without going through a file: trivially copyable values are packed in
+     *  one buffer and copied with memcpy, others are copies made with their
+     *  copy constructor.  Can be moved, not copied.
+     */
+    class CVarSnapshot
+    {
+        public:
+            CVarSnapshot() {}
+            CVarSnapshot( CVarSnapshot&& rOther );
+            CVarSnapshot& operator=( CVarSnapshot&& rOther );
+            ~CVarSnapshot(); // releases the copies
+
+            // copies the value of pCVar (a CVar<T>*)
+            void Add( void* pCVar );
+
+            // the values of rTo that rFrom does not hold: restoring them over
+            // rFrom's values has the same result as restoring rTo
+            static CVarSnapshot Difference( const CVarSnapshot& rFrom, const CVarSnapshot& rTo );
+
+            // number of CVars in the snapshot
+            size_t size() const { return m_vTrivialCVars.size() + m_vCopiedCVars.size(); }
+            void clear();
+
+        private:
+            CVarSnapshot( const CVarSnapshot& );
+            CVarSnapshot& operator=( const CVarSnapshot& );
+
+            friend size_t RestoreSnapshot( const CVarSnapshot& snapshot );
+
+            std::vector<void*>  m_vTrivialCVars;
+            std::vector<size_t> m_vOffsets;       // of their value in m_vBytes
+            std::vector<char>   m_vBytes;
+            std::vector<void*>  m_vCopiedCVars;
+            std::vector<void*>  m_vCopies;        // from CVar::CloneValue
+            // type id and binary form of the copies to compare with the
+            // CVars, empty for types without a binary form
+            std::vector<std::string> m_vCopyStates;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Copies the values of the CVars Save would write with these filters,
+     *  e.g. TakeSnapshot( { "renderer." } ).  Implemented in CVarSnapshot.cpp.
+     */
+    CVarSnapshot TakeSnapshot( std::vector<std::string> vFilterSubstrings=std::vector<std::string>() );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Writes the values of a snapshot back, then notifies the CVars whose
+    /// value changed (always, for types without a binary form).  Returns
+    /// that number.
+    size_t RestoreSnapshot( const CVarSnapshot& snapshot );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Registers the preset sName (e.g. quality levels) with the values
+     *  "sFileName" sets, read with the current stream type and filters as
+     *  for Load.  The CVars keep their values, values for CVars not created
+     *  yet are ignored.  Implemented in CVarPreset.cpp.
+     */
+    bool RegisterPreset( const std::string& sName, const std::string& sFileName,
+                         std::vector<std::string> vFilterSubstrings=std::vector<std::string>() );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Registers the preset sName with the values of a snapshot.
+    void RegisterPreset( const std::string& sName, CVarSnapshot&& snapshot );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Switches to the preset sName: only the CVars whose value differs from
+     *  the preset are written, all before the first of them is notified
+     *  (see RestoreSnapshot).  Every CVar of the preset is compared, so
+     *  values written through a reference since the previous switch are
+     *  put back too.  Returns the number of CVars changed, -1 if there is
+     *  no such preset.
+     */
+    int ApplyPreset( const std::string& sName );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// The registered presets, sorted, and the last one applied.
+    std::vector<std::string> GetPresetNames();
+    const std::string& GetActivePreset();
+
     /** Utilities for the indentation of XML output */
     inline std::string CVarSpc();
     inline void CVarIndent();
@@ -309,7 +626,9 @@ namespace CVarUtils {
         CVarsNotInitialized,
         CVarNonExistant,
         CVarAlreadyCreated,
-        ReservedName
+        ReservedName,
+        InvalidExpression,
+        ReadOnlyCVar
     };
 }
 
@@ -326,23 +645,34 @@ namespace CVarUtils {
                   std::istream& (*pDeserialisationFuncPtr)( std::istream &, T ) = NULL ) {
 
                 //std::cout << TToStream( std::cout, TVarValue );
-                m_pValueStringFuncPtr = CVarValueString; // template pointer to value string func
-                m_pTypeStringFuncPtr = CVarTypeString; // template pointer to type string func
-                m_pSetValueFuncPtr = StringToCVarValue;
-
-                m_pSerialisationFuncPtr   = pSerialisationFuncPtr;
-                m_pDeserialisationFuncPtr = pDeserialisationFuncPtr;
-
+                _Init( sVarName, sHelp, bSerialise, pSerialisationFuncPtr, pDeserialisationFuncPtr );
                 m_pVarData = new T;
                 *m_pVarData = TVarValue;
-                m_sVarName = sVarName;
-                m_bSerialise = bSerialise;
-                m_sHelp = sHelp;
+                m_bOwnsData = true;
+            }
+
+            ////////////////////////////////////////////////////////////////////////////////
+            // Attach to an existing variable instead of allocating one, the CVar
+            // does not own pVarData (used by AttachCVarStruct).
+            CVar( std::string sVarName,
+                  T* pVarData, std::string sHelp,
+                  bool bSerialise ) {
+                _Init( sVarName, sHelp, bSerialise, NULL, NULL );
+                m_pVarData = pVarData;
+                m_bOwnsData = false;
             }
 
             ////////////////////////////////////////////////////////////////////////////////
             ~CVar() {
-              delete m_pVarData;
+              if( m_pDerivation != NULL ) {
+                  ReleaseCVarDerivation( m_pDerivation );
+              }
+              if( !m_vDependents.empty() ) {
+                  DetachCVarDependents( this );
+              }
+              if( m_bOwnsData ) {
+                  delete m_pVarData;
+              }
             }
 
             ////////////////////////////////////////////////////////////////////////////////
@@ -350,21 +680,47 @@ namespace CVarUtils {
             // Call the original function that was installed at object creation time,
             // regardless of current object class type T.
             std::string GetValueAsString() {
+                return FormatValue( m_pVarData );
+            }
+
+            ////////////////////////////////////////////////////////////////////////////////
+            // String representation of pValue, the value of this CVar or a copy
+            // of it from CloneValue.
+            std::string FormatValue( void* pValue ) {
                 if( m_pSerialisationFuncPtr != NULL ) {
                     std::stringstream sStream( "" );
-                    m_pSerialisationFuncPtr( sStream, *m_pVarData );
+                    m_pSerialisationFuncPtr( sStream, *(T*)pValue );
                     return sStream.str();
                 }
                 else {
-                    return (*m_pValueStringFuncPtr)( m_pVarData );
+                    return (*m_pValueStringFuncPtr)( (T*)pValue );
                 }
             }
 
+            ////////////////////////////////////////////////////////////////////////////////
+            // FormatValue as written by the XML and TXT savers: numeric vectors
+            // of at least nMinElements are base64 encoded with CVARS_ARRAY_BASE64
+            // (see SetArrayEncoding), unless a serialisation function was given.
+            std::string FormatSavedValue( void* pValue, CVARS_ARRAY_ENCODING encoding,
+                                          size_t nMinElements ) {
+                if( encoding == CVARS_ARRAY_BASE64 && m_pSerialisationFuncPtr == NULL ) {
+                    std::ostringstream sStream;
+                    if( (*m_pBase64WriteFuncPtr)( (T*)pValue, nMinElements, sStream ) ) {
+                        return sStream.str();
+                    }
+                }
+                return FormatValue( pValue );
+            }
+
             ////////////////////////////////////////////////////////////////////////////////
             // Convert string representation to value
             // Call the original function that was installed at object creation time,
             // regardless of current object class type T.
-            void SetValueFromString( const std::string &sValue ) {
+            // Returns false, leaving the value, for derived (read only) CVars.
+            bool SetValueFromString( const std::string &sValue ) {
+                if( m_pDerivation != NULL ) {
+                    return false;
+                }
                 if( m_pDeserialisationFuncPtr != NULL ) {
                     std::stringstream sStream( sValue );
                     m_pDeserialisationFuncPtr( sStream, *m_pVarData );
@@ -374,6 +730,71 @@ namespace CVarUtils {
                         (*m_pSetValueFuncPtr)( m_pVarData, sValue );
                     }
                 }
+                NotifyCVarChanged( this );
+                return true;
+            }
+
+            ////////////////////////////////////////////////////////////////////////////////
+            // Numeric value, used when this CVar is an input of a derived CVar.
+            double GetValueAsDouble() {
+                if( m_pNumericValueFuncPtr != NULL ) {
+                    return (*m_pNumericValueFuncPtr)( m_pVarData );
+                }
+                return strtod( GetValueAsString().c_str(), NULL );
+            }
+
+            ////////////////////////////////////////////////////////////////////////////////
+            // Raw value for binary snapshots (see CVarBinaryIO.h): appends the
+            // payload to sOut and returns its type id, CVARS_BINARY_TEXT (with
+            // nothing appended) if the type has no binary form.
+            uint32_t GetValueAsBinary( std::string& sOut ) {
+                return FormatValueAsBinary( m_pVarData, sOut );
+            }
+
+            ////////////////////////////////////////////////////////////////////////////////
+            // GetValueAsBinary of pValue, the value of this CVar or a copy of it.
+            uint32_t FormatValueAsBinary( void* pValue, std::string& sOut ) {
+                return (*m_pBinaryWriteFuncPtr)( (T*)pValue, sOut );
+            }
+
+            ////////////////////////////////////////////////////////////////////////////////
+            // Copy of the value that can be formatted while the CVar keeps
+            // changing (see SaveAsync), released with DestroyValueCopy.
+            void* CloneValue() {
+                return (*m_pCloneFuncPtr)( m_pVarData );
+            }
+
+            // Copy of a copy made by CloneValue.
+            void* CloneValueCopy( void* pCopy ) {
+                return (*m_pCloneFuncPtr)( (T*)pCopy );
+            }
+
+            void DestroyValueCopy( void* pCopy ) {
+                (*m_pDestroyFuncPtr)( pCopy );
+            }
+
+            ////////////////////////////////////////////////////////////////////////////////
+            // Sets the value from a CloneValue copy (see RestoreSnapshot), the
+            // caller notifies the change.
+            void AssignValueCopy( const void* pCopy ) {
+                (*m_pAssignFuncPtr)( m_pVarData, pCopy );
+            }
+
+            // Bytes of the value if it can be copied with memcpy, 0 otherwise.
+            size_t TrivialValueSize() {
+                return m_nTrivialSize;
+            }
+
+            ////////////////////////////////////////////////////////////////////////////////
+            // Sets the value from a binary snapshot payload, returns false if
+            // the payload does not match the type of this CVar.
+            bool SetValueFromBinary( uint32_t nTypeId, const char* pData, size_t nBytes ) {
+                if( m_pDerivation != NULL ||
+                    !(*m_pBinaryReadFuncPtr)( m_pVarData, nTypeId, pData, nBytes ) ) {
+                    return false;
+                }
+                NotifyCVarChanged( this );
+                return true;
             }
 
             ////////////////////////////////////////////////////////////////////////////////
@@ -384,6 +805,16 @@ namespace CVarUtils {
                 return (*m_pTypeStringFuncPtr)( m_pVarData );
             }
 
+            // typeid of T, to test the type without building a string
+            const std::type_info& TypeInfo() {
+                return *m_pTypeInfo;
+            }
+
+            // derived CVars (see CVarExpression.h) are read only
+            bool IsDerived() const {
+                return m_pDerivation != NULL;
+            }
+
             ////////////////////////////////////////////////////////////////////////////////
             // Get values to and from a string representation (used for
             // serialization and console interaction)
@@ -394,10 +825,45 @@ namespace CVarUtils {
             }
 
 
+        private:
+            ////////////////////////////////////////////////////////////////////////////////
+            void _Init( const std::string& sVarName,
+                        const std::string& sHelp,
+                        bool bSerialise,
+                        std::ostream& (*pSerialisationFuncPtr)( std::ostream &, T ),
+                        std::istream& (*pDeserialisationFuncPtr)( std::istream &, T ) ) {
+                m_pValueStringFuncPtr = CVarValueString; // template pointer to value string func
+                m_pTypeStringFuncPtr = CVarTypeString; // template pointer to type string func
+                m_pSetValueFuncPtr = StringToCVarValue;
+                m_pNumericValueFuncPtr = CVarNumeric<T>::ValueFunc();
+                m_pBinaryWriteFuncPtr = CVarBinaryValue<T>::Write;
+                m_pBinaryReadFuncPtr = CVarBinaryValue<T>::Read;
+                m_pBase64WriteFuncPtr = CVarBase64Value<T>::Write;
+                m_pCloneFuncPtr = CVarValueCopy<T>::Clone;
+                m_pAssignFuncPtr = CVarValueCopy<T>::Assign;
+                m_pDestroyFuncPtr = CVarValueCopy<T>::Destroy;
+                m_nTrivialSize = CVarValueCopy<T>::TrivialSize();
+                m_pTypeInfo = &typeid( T );
+
+                m_pSerialisationFuncPtr   = pSerialisationFuncPtr;
+                m_pDeserialisationFuncPtr = pDeserialisationFuncPtr;
+
+                m_sVarName = sVarName;
+                m_bSerialise = bSerialise;
+                m_sHelp = sHelp;
+                m_pDerivation = NULL;
+            }
+
         public: // Public data
             std::string   m_sVarName;
             T            *m_pVarData;
             bool m_bSerialise;
+            bool m_bOwnsData;
+
+            // Derived CVars: m_pDerivation is set if this CVar is computed from
+            // an expression, m_vDependents lists the derivations reading it.
+            CVarDerivation*              m_pDerivation;
+            std::vector<CVarDerivation*> m_vDependents;
 
         private:
             std::string         m_sHelp;
@@ -411,12 +877,39 @@ namespace CVarUtils {
             // pointer to func to set CVar Value from a string
             void (*m_pSetValueFuncPtr)( T *t, const std::string & );
 
+            // pointer to func to get CVar value as a double (NULL if T is not arithmetic)
+            double (*m_pNumericValueFuncPtr)( T *t );
+
+            // pointers to funcs to get and set the CVar value in binary snapshots
+            uint32_t (*m_pBinaryWriteFuncPtr)( T *t, std::string & );
+            bool (*m_pBinaryReadFuncPtr)( T *t, uint32_t, const char *, size_t );
+
+            // pointer to func writing the CVar value base64 encoded (see
+            // FormatSavedValue)
+            bool (*m_pBase64WriteFuncPtr)( T *t, size_t, std::ostream & );
+
+            // pointers to funcs to copy the CVar value, assign it back and
+            // release the copy
+            void* (*m_pCloneFuncPtr)( T *t );
+            void (*m_pAssignFuncPtr)( T *t, const void * );
+            void (*m_pDestroyFuncPtr)( void * );
+            size_t m_nTrivialSize;
+
+            const std::type_info* m_pTypeInfo;
+
             std::ostream& (*m_pSerialisationFuncPtr)( std::ostream &, T );
             std::istream& (*m_pDeserialisationFuncPtr)( std::istream &, T ) ;
         };
 }
 
 namespace CVarUtils {
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Words of the Save/Load filters, which cannot name a CVar.
+    inline bool IsReservedCVarName( const std::string& s )
+    {
+        return s == "true" || s == "false" || s == "not";
+    }
+
     ////////////////////////////////////////////////////////////////////////////////
     template <class T> T& CreateCVar(
             const std::string& s,
@@ -431,9 +924,7 @@ namespace CVarUtils {
         if( trie.Exists( s ) ) {
             throw CVarAlreadyCreated;
         }
-        if( std::string( s ) == "true" ||
-                std::string( s ) == "false" ||
-                std::string( s ) == "not") {
+        if( IsReservedCVarName( s ) ) {
             throw ReservedName;
         }
 #ifdef DEBUG_CVAR
@@ -507,9 +998,7 @@ namespace CVarUtils {
         if( trie.Exists( s ) ) {
             throw CVarAlreadyCreated;
         }
-        if( std::string( s ) == "true" ||
-            std::string( s ) == "false" ||
-            std::string( s ) == "not") {
+        if( IsReservedCVarName( s ) ) {
             throw ReservedName;
         }
 #ifdef DEBUG_CVAR
@@ -533,10 +1022,12 @@ namespace CVarUtils {
     template <class T> T& GetCVarRef( const char* s ) {
         Trie& trie = TrieInstance();
 
-        if( !trie.Exists( s ) ) {
+        TrieNode* pNode = trie.Find( s );
+        if( pNode == NULL ) {
             throw CVarNonExistant;
         }
-        return *(((CVar<T>*)trie.Find(s)->m_pNodeData)->m_pVarData);
+        CVar<T>* pCVar = (CVar<T>*)pNode->m_pNodeData;
+        return *(pCVar->m_pVarData);
     }
 
     ////////////////////////////////////////////////////////////////////////////////
@@ -576,7 +1067,12 @@ namespace CVarUtils {
         if( !trie.Exists( s ) ) {
             throw CVarNonExistant;
         }
-        *(((CVar<T>*)trie.Find(s)->m_pNodeData)->m_pVarData) = val;
+        CVar<T>* pCVar = (CVar<T>*)trie.Find(s)->m_pNodeData;
+        if( pCVar->IsDerived() ) {
+            throw ReadOnlyCVar;
+        }
+        *(pCVar->m_pVarData) = val;
+        NotifyCVarChanged( pCVar );
     }
 
     ////////////////////////////////////////////////////////////////////////////////
@@ -604,8 +1100,8 @@ namespace CVarUtils {
     }
 
     ////////////////////////////////////////////////////////////////////////////////
-    inline void SetValueFromString( void* cvar, const std::string &sValue ) {
-        ((CVar<int>*) cvar)->SetValueFromString( sValue );
+    inline bool SetValueFromString( void* cvar, const std::string &sValue ) {
+        return ((CVar<int>*) cvar)->SetValueFromString( sValue );
     }
 
     ////////////////////////////////////////////////////////////////////////////////
@@ -664,15 +1160,52 @@ namespace CVarUtils {
         TrieInstance().SetStreamType( stream_type );
     }
 
+    ////////////////////////////////////////////////////////////////////////////////
+    inline void SetArrayEncoding( const CVARS_ARRAY_ENCODING& encoding, size_t nMinElements )
+    {
+        TrieInstance().SetArrayEncoding( encoding, nMinElements );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    inline void SetGroupedNames( bool bGrouped )
+    {
+        TrieInstance().SetGroupedNames( bGrouped );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    inline void ClearPendingValues()
+    {
+        TrieInstance().ClearPendingValues();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    inline void SetLoadThreads( unsigned int nThreads )
+    {
+        TrieInstance().SetLoadThreads( nThreads );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    inline void SetUnchangedLoads( const CVARS_UNCHANGED_LOADS& unchangedLoads )
+    {
+        TrieInstance().SetUnchangedLoads( unchangedLoads );
+    }
+
     ////////////////////////////////////////////////////////////////////////////////
     inline bool Save( const std::string& sFileName, std::vector<std::string> vAcceptedSubstrings ) {
-        std::ofstream sOut( sFileName.c_str() );
         Trie& trie = TrieInstance();
+        // a pending SaveAsync must not replace the file after this save
+        WaitForAsyncSaves();
+        std::ofstream sOut( sFileName.c_str(), trie.GetStreamType() == CVARS_BINARY_STREAM ?
+                            std::ios::out | std::ios::binary : std::ios::out );
         if( sOut.is_open() ) {
             trie.SetVerbose( false );
             trie.SetAcceptedSubstrings ( vAcceptedSubstrings );
             sOut << trie;
             sOut.close();
+            // a full save supersedes any delta saved for this file
+            std::remove( ( sFileName + CVARS_DELTA_SUFFIX ).c_str() );
+            RecordDeltaBase( sFileName, vAcceptedSubstrings, trie );
+            RecordFileState( sFileName, vAcceptedSubstrings, trie );
             return true;
         }
         else {
@@ -683,50 +1216,105 @@ namespace CVarUtils {
 
     ////////////////////////////////////////////////////////////////////////////////
     inline bool Load( const std::string& sFileName, std::vector<std::string> vAcceptedSubstrings ) {
-        std::ifstream sIn( sFileName.c_str() );
         Trie& trie = TrieInstance();
-        if( sIn.is_open() ) {
+        // the file may still be being written by a SaveAsync
+        WaitForAsyncSaves();
+        if( IsFileUnchanged( sFileName, vAcceptedSubstrings, trie ) ) {
+            return true;
+        }
+        CVarJournalBatch journalBatch;
+        bool bLoaded = false;
+        if( trie.GetStreamType() == CVARS_BINARY_STREAM ) {
             trie.SetVerbose( false );
             trie.SetAcceptedSubstrings ( vAcceptedSubstrings );
-            sIn >> trie;
-            sIn.close();
-            return true;
+            bLoaded = LoadBinarySnapshot( sFileName, trie );
+        }
+        else if( trie.GetStreamType() == CVARS_TXT_STREAM ) {
+            trie.SetVerbose( false );
+            trie.SetAcceptedSubstrings ( vAcceptedSubstrings );
+            bLoaded = LoadTXTFile( sFileName, trie );
+        }
+        else if( trie.GetStreamType() == CVARS_JSON_STREAM ) {
+            trie.SetVerbose( false );
+            trie.SetAcceptedSubstrings ( vAcceptedSubstrings );
+            bLoaded = LoadJSONFile( sFileName, trie );
         }
         else {
-            //            std::cerr << "ERROR opening cvars file for loading." << std::endl;
-            return false;
+            std::ifstream sIn( sFileName.c_str() );
+            if( sIn.is_open() ) {
+                trie.SetVerbose( false );
+                trie.SetAcceptedSubstrings ( vAcceptedSubstrings );
+                sIn >> trie;
+                sIn.close();
+                bLoaded = true;
+            }
+            else {
+                //            std::cerr << "ERROR opening cvars file for loading." << std::endl;
+            }
+        }
+        if( bLoaded ) {
+            // changes saved with SaveDelta since the last full save
+            LoadDelta( sFileName, trie );
+            RecordDeltaBase( sFileName, vAcceptedSubstrings, trie );
+            RecordFileState( sFileName, vAcceptedSubstrings, trie );
         }
+        return bLoaded;
     }
 
     ////////////////////////////////////////////////////////////////////////////////
     inline std::string CVarSpc() {
-        if( CVarUtils::GetCVar<int>( "console.CVarIndent" ) <= 0 ) {
+        const int nIndent = *TrieInstance().m_pCVarIndent;
+        if( nIndent <= 0 ) {
             return "";
         }
-        return std::string( CVarUtils::GetCVar<int>( "console.CVarIndent" ), ' ' );
+        return std::string( nIndent, ' ' );
     }
 
     ////////////////////////////////////////////////////////////////////////////////
     inline void CVarIndent() {
-        CVarUtils::GetCVarRef<int>( "console.CVarIndent" ) += CVarUtils::GetCVar<int>( "console.CVarIndentIncr" );
+        Trie& trie = TrieInstance();
+        *trie.m_pCVarIndent += *trie.m_pCVarIndentIncr;
     }
 
     ////////////////////////////////////////////////////////////////////////////////
     inline void CVarUnIndent() {
-        CVarUtils::GetCVarRef<int>( "console.CVarIndent" ) -= CVarUtils::GetCVar<int>( "console.CVarIndentIncr" );
+        Trie& trie = TrieInstance();
+        *trie.m_pCVarIndent -= *trie.m_pCVarIndentIncr;
     }
 
     ////////////////////////////////////////////////////////////////////////////////
     inline void CVarResetSpc() {
-        CVarUtils::SetCVar<int>( "console.CVarIndent", 0 );
+        *TrieInstance().m_pCVarIndent = 0;
     }
 
     ////////////////////////////////////////////////////////////////////////////////
 
 
 
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Console line lexing, in one pass over views of the line.  Commands are
+     *  separated by ';' and words by spaces or tabs.  "..." and '...' quote
+     *  (a word may mix quoted and unquoted parts).  Inside double quotes a
+     *  backslash escapes the next character, \n and \t giving a new line
+     *  and a tab; elsewhere it is kept as typed (e.g. C:\data\x.xml).
+     *  NextCommand takes the next command, without the blanks around it,
+     *  off sLine, false once sLine is used up.
+     */
+    bool NextCommand( std::string_view& sLine, std::string_view& sCommand );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Takes the next word off sText, false if there is none.  sWord points
+     *  into sText, or, when the word has escapes or several quoted parts, into
+     *  sUnescaped where it is written: sUnescaped is only allocated then, and
+     *  (if empty or used for this text only) not reallocated afterwards, so the
+     *  words taken before stay valid.
+     */
+    bool NextCommandWord( std::string_view& sText, std::string_view& sWord, std::string& sUnescaped );
+
     ////////////////////////////////////////////////////////////////////////////////
     /// This function parses console input for us -- useful function for glconsole, textconsole, etc
+    /// Several commands can be given separated by ';', their results are
+    /// returned one per line.
     bool ProcessCommand(
             const std::string& sCommand,   //< Input:
             std::string& sResult,          //< Output:
@@ -741,6 +1329,12 @@ namespace CVarUtils {
             bool bExecute = 1                       //< Input:
             );
 
+    ////////////////////////////////////////////////////////////////////////////////
+    /// True for console functions and typed commands (see CreateCommand).
+    bool IsConsoleFunc(
+            CVar<int> *pCVar  //< Input:
+            );
+
     ////////////////////////////////////////////////////////////////////////////////
     bool IsConsoleFunc(
             TrieNode *node  //< Input:
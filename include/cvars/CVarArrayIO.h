@@ -0,0 +1,188 @@
+#ifndef _CVAR_ARRAY_IO_H_
+#define _CVAR_ARRAY_IO_H_
+
+#include <array>
+#include <string>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include <cstdio>
+
+#include <cvars/CVarValueIO.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Fixed size arrays: std::array<T,N> CVars, and C arrays attached with
+// AttachCVar (eg. "float pos[3]; CVarUtils::AttachCVar( "obj.pos", &pos );").
+// They use the same "[ a b c ]" text as vectors, but numbers are formatted
+// and parsed through stack buffers (no allocation) and the element loop is
+// unrolled for small N.  Reading anything but exactly N elements is an error
+// that leaves the array unchanged.
+
+namespace CVarUtils {
+
+    /// Arrays up to this size are parsed with unrolled code.
+    const size_t CVAR_ARRAY_UNROLL_MAX = 16;
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Skips separators and reads the next element token from the stream buffer
+    /// into sToken (at most nMax-1 characters).  Returns the token length, 0 at
+    /// the end of the array.
+    inline size_t ReadArrayToken( std::streambuf* pBuf, char* sToken, size_t nMax ) {
+        int c = pBuf->sgetc();
+        while( c != EOF && IsElementSeparator( (char)c ) ) {
+            if( c == ']' ) {
+                return 0;
+            }
+            c = pBuf->snextc();
+        }
+        size_t nLen = 0;
+        while( c != EOF && !IsElementSeparator( (char)c ) ) {
+            if( nLen + 1 < nMax ) {
+                sToken[nLen] = (char)c;
+            }
+            nLen++;
+            c = pBuf->snextc();
+        }
+        return nLen < nMax ? nLen : nMax;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    template <class T>
+        bool ReadArrayElement( std::istream& stream, T& val ) {
+        if constexpr( IsFastNumber<T>::value ) {
+            char sToken[CVAR_NUMBER_MAX_CHARS];
+            const size_t nLen = ReadArrayToken( stream.rdbuf(), sToken, sizeof( sToken ) );
+            if( nLen == 0 || nLen == sizeof( sToken ) ) {
+                return false;
+            }
+            return ParseNumber( sToken, sToken + nLen, val );
+        }
+        else {
+            std::string sToken;
+            int c = stream.rdbuf()->sgetc();
+            while( c != EOF && IsElementSeparator( (char)c ) && c != ']' ) {
+                c = stream.rdbuf()->snextc();
+            }
+            while( c != EOF && !IsElementSeparator( (char)c ) ) {
+                sToken += (char)c;
+                c = stream.rdbuf()->snextc();
+            }
+            if( sToken.empty() ) {
+                return false;
+            }
+            std::istringstream iss( sToken );
+            iss >> val;
+            return !iss.fail();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    template <class T, size_t... I>
+        bool ReadArrayElementsUnrolled( std::istream& stream, T* pVals, std::index_sequence<I...> ) {
+        return ( ReadArrayElement( stream, pVals[I] ) && ... );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Arrays bigger than this are parsed into a heap buffer instead of the stack.
+    const size_t CVAR_ARRAY_STACK_BYTES = 16384;
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Parses exactly N elements into pVals, which is only written on success.
+    template <class T, size_t N>
+        std::istream& ReadFixedArray( std::istream& stream, T* pVals ) {
+        typedef typename std::conditional<sizeof( T ) * N <= CVAR_ARRAY_STACK_BYTES,
+            std::array<T,N>, std::vector<T> >::type TmpType;
+        TmpType vTmp;
+        if constexpr( std::is_same<TmpType,std::vector<T> >::value ) {
+            vTmp.resize( N );
+        }
+        bool bOk;
+        if constexpr( N <= CVAR_ARRAY_UNROLL_MAX ) {
+            bOk = ReadArrayElementsUnrolled( stream, vTmp.data(), std::make_index_sequence<N>() );
+        }
+        else {
+            bOk = true;
+            for( size_t i=0; i<N && bOk; i++ ) {
+                bOk = ReadArrayElement( stream, vTmp[i] );
+            }
+        }
+        if( bOk ) {
+            char sExtra[CVAR_NUMBER_MAX_CHARS];
+            if( ReadArrayToken( stream.rdbuf(), sExtra, sizeof( sExtra ) ) != 0 ) {
+                bOk = false;
+            }
+        }
+        if( !bOk ) {
+            fprintf( stderr, "ERROR deserialising array, expecting %zu valid elements.\n", N );
+            stream.setstate( std::ios::failbit );
+            return stream;
+        }
+        for( size_t i=0; i<N; i++ ) {
+            pVals[i] = vTmp[i];
+        }
+        return stream;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    template <class T, size_t N>
+        std::ostream& WriteFixedArray( std::ostream& stream, const T* pVals ) {
+        if constexpr( N == 0 ) {
+            stream << "[ ]";
+        }
+        else if constexpr( IsFastNumber<T>::value ) {
+            char sBuf[1024];
+            char* p = sBuf;
+            *p++ = '[';
+            for( size_t i=0; i<N; i++ ) {
+                if( sBuf + sizeof( sBuf ) - p < CVAR_NUMBER_MAX_CHARS + 1 ) {
+                    stream.write( sBuf, p - sBuf );
+                    p = sBuf;
+                }
+                *p++ = ' ';
+                p = FormatNumber<T>( p, pVals[i] );
+            }
+            stream.write( sBuf, p - sBuf );
+            stream << " ]";
+        }
+        else {
+            stream << "[ " << pVals[0];
+            for( size_t i=1; i<N; i++ ) {
+                stream << " " << pVals[i];
+            }
+            stream << " ]";
+        }
+        return stream;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // std::array<T,N>
+    template <class T, size_t N>
+        std::ostream &operator<<( std::ostream &stream, const std::array<T,N>& vT ) {
+        return WriteFixedArray<T,N>( stream, vT.data() );
+    }
+
+    template <class T, size_t N>
+        std::istream &operator>>( std::istream &stream, std::array<T,N>& vT ) {
+        return ReadFixedArray<T,N>( stream, vT.data() );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // C arrays, character arrays keep their usual string meaning.
+    template <class T, size_t N>
+        struct IsCVarCArray : std::integral_constant<bool,
+            !std::is_same<typename std::remove_cv<T>::type,char>::value> {};
+
+    template <class T, size_t N>
+        typename std::enable_if<IsCVarCArray<T,N>::value, std::ostream&>::type
+        operator<<( std::ostream &stream, T (&vT)[N] ) {
+        return WriteFixedArray<T,N>( stream, vT );
+    }
+
+    template <class T, size_t N>
+        typename std::enable_if<IsCVarCArray<T,N>::value, std::istream&>::type
+        operator>>( std::istream &stream, T (&vT)[N] ) {
+        return ReadFixedArray<T,N>( stream, vT );
+    }
+}
+
+#endif
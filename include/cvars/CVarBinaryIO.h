@@ -0,0 +1,258 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+////////////////////////////////////////////////////////////////////////////////
+// Raw values for the CVARS_BINARY_STREAM snapshot format.
+//
+// A snapshot file is laid out as (host byte order, see CVarBinaryHeader):
+//   - a CVarBinaryHeader,
+//   - m_nEntries CVarBinaryEntry records, sorted by name hash,
+//   - the names and the value payloads, each payload 8 byte aligned.
+// Numbers, strings and numeric vectors/std::arrays are stored as raw bytes and
+// copied straight into the CVar when loading.  Any other type is stored as its
+// text (CVARS_BINARY_TEXT) and parsed with SetValueFromString.
+
+#ifndef _CVAR_BINARY_IO_H_
+#define _CVAR_BINARY_IO_H_
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <type_traits>
+#include <stdint.h>
+
+namespace CVarUtils {
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Type ids of binary snapshot entries.  Numbers are (kind << 8) | size in
+    /// bytes with kind 'f', 'i', 'u' or 'b' (bool), CVARS_BINARY_ARRAY is or'ed
+    /// with the element id for vectors and arrays.
+    const uint32_t CVARS_BINARY_TEXT   = 0;
+    const uint32_t CVARS_BINARY_STRING = 's' << 8;
+    const uint32_t CVARS_BINARY_ARRAY  = 0x10000;
+
+    const char     CVARS_BINARY_MAGIC[8] = { 'C', 'V', 'A', 'R', 'B', 'I', 'N', '\0' };
+    const uint32_t CVARS_BINARY_VERSION = 1;
+    const uint32_t CVARS_BINARY_BYTE_ORDER = 0x01020304;
+
+    ////////////////////////////////////////////////////////////////////////////////
+    struct CVarBinaryHeader {
+        char     m_sMagic[8];
+        uint32_t m_nVersion;
+        uint32_t m_nByteOrder;  ///< CVARS_BINARY_BYTE_ORDER as written by the saving host
+        uint32_t m_nEntries;
+        uint32_t m_nReserved;
+        uint64_t m_nFileSize;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    struct CVarBinaryEntry {
+        uint64_t m_nNameHash;   ///< HashCVarName of the name
+        uint64_t m_nValueOffset;
+        uint32_t m_nNameOffset;
+        uint32_t m_nNameLength;
+        uint32_t m_nValueLength;
+        uint32_t m_nTypeId;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// 64 bit FNV-1a hash of a CVar name.  Passing the hash of a prefix as
+    /// nHash gives the hash of the prefix followed by s.
+    inline uint64_t HashCVarName( const char* s, size_t nLength,
+                                  uint64_t nHash = 14695981039346656037ULL ) {
+        for( size_t i=0; i<nLength; i++ ) {
+            nHash ^= (unsigned char)s[i];
+            nHash *= 1099511628211ULL;
+        }
+        return nHash;
+    }
+
+    inline uint64_t HashCVarName( const std::string& s ) {
+        return HashCVarName( s.data(), s.size() );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    template <class T>
+        uint32_t BinaryNumberTypeId() {
+        const uint32_t nKind = std::is_same<T,bool>::value ? 'b' :
+                               std::is_floating_point<T>::value ? 'f' :
+                               std::is_signed<T>::value ? 'i' : 'u';
+        return ( nKind << 8 ) | (uint32_t)sizeof( T );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Reads one number of type id nTypeId at p into val, converting if the
+    /// stored type differs from T.  Returns false for unknown ids.
+    template <class T>
+        bool ReadBinaryNumber( uint32_t nTypeId, const char* p, T& val ) {
+        switch( nTypeId ) {
+#define CVAR_BINARY_NUMBER_CASE( S ) \
+        case ( ( std::is_same<S,bool>::value ? 'b' : std::is_floating_point<S>::value ? 'f' : \
+                 std::is_signed<S>::value ? 'i' : 'u' ) << 8 ) | sizeof( S ): { \
+            S SVal; memcpy( &SVal, p, sizeof( S ) ); val = static_cast<T>( SVal ); return true; }
+        CVAR_BINARY_NUMBER_CASE( bool )
+        CVAR_BINARY_NUMBER_CASE( float )
+        CVAR_BINARY_NUMBER_CASE( double )
+        CVAR_BINARY_NUMBER_CASE( int8_t )
+        CVAR_BINARY_NUMBER_CASE( int16_t )
+        CVAR_BINARY_NUMBER_CASE( int32_t )
+        CVAR_BINARY_NUMBER_CASE( int64_t )
+        CVAR_BINARY_NUMBER_CASE( uint8_t )
+        CVAR_BINARY_NUMBER_CASE( uint16_t )
+        CVAR_BINARY_NUMBER_CASE( uint32_t )
+        CVAR_BINARY_NUMBER_CASE( uint64_t )
+#undef CVAR_BINARY_NUMBER_CASE
+        default:
+            return false;
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    inline size_t BinaryNumberSize( uint32_t nTypeId ) {
+        return nTypeId & 0xff;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Binary form of a CVar value.  Write appends the payload to sOut and
+    /// returns the type id, or CVARS_BINARY_TEXT (appending nothing) if T has
+    /// no binary form.  Read returns false if the entry cannot be applied.
+    template <class T, class Enable = void>
+        struct CVarBinaryValue {
+            static uint32_t Write( T*, std::string& ) { return CVARS_BINARY_TEXT; }
+            static bool Read( T*, uint32_t, const char*, size_t ) { return false; }
+        };
+
+    // Numbers
+    template <class T>
+        struct CVarBinaryValue<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+            static uint32_t Write( T* t, std::string& sOut ) {
+                sOut.append( (const char*)t, sizeof( T ) );
+                return BinaryNumberTypeId<T>();
+            }
+            static bool Read( T* t, uint32_t nTypeId, const char* p, size_t nBytes ) {
+                if( ( nTypeId & CVARS_BINARY_ARRAY ) || BinaryNumberSize( nTypeId ) != nBytes ) {
+                    return false;
+                }
+                return ReadBinaryNumber( nTypeId, p, *t );
+            }
+        };
+
+    // Strings
+    template <>
+        struct CVarBinaryValue<std::string> {
+            static uint32_t Write( std::string* t, std::string& sOut ) {
+                sOut.append( *t );
+                return CVARS_BINARY_STRING;
+            }
+            static bool Read( std::string* t, uint32_t nTypeId, const char* p, size_t nBytes ) {
+                if( nTypeId != CVARS_BINARY_STRING ) {
+                    return false;
+                }
+                t->assign( p, nBytes );
+                return true;
+            }
+        };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Reads nBytes of elements of type id nTypeId into pVals, which holds
+    /// nCount elements.
+    template <class T>
+        bool ReadBinaryArray( uint32_t nTypeId, const char* p, size_t nBytes, T* pVals, size_t nCount ) {
+        const uint32_t nElemId = nTypeId & ~CVARS_BINARY_ARRAY;
+        const size_t nElemSize = BinaryNumberSize( nElemId );
+        if( !( nTypeId & CVARS_BINARY_ARRAY ) || nElemSize == 0 || nElemSize * nCount != nBytes ) {
+            return false;
+        }
+        if( nElemId == BinaryNumberTypeId<T>() && !std::is_same<T,bool>::value ) {
+            memcpy( (void*)pVals, p, nBytes );
+            return true;
+        }
+        for( size_t i=0; i<nCount; i++ ) {
+            if( !ReadBinaryNumber( nElemId, p + i * nElemSize, pVals[i] ) ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Vectors of numbers
+    template <class T>
+        struct CVarBinaryValue<std::vector<T>, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+            static uint32_t Write( std::vector<T>* t, std::string& sOut ) {
+                if constexpr( std::is_same<T,bool>::value ) {
+                    for( size_t i=0; i<t->size(); i++ ) {
+                        sOut += (char)( (*t)[i] ? 1 : 0 );
+                    }
+                }
+                else {
+                    sOut.append( (const char*)t->data(), t->size() * sizeof( T ) );
+                }
+                return CVARS_BINARY_ARRAY | BinaryNumberTypeId<T>();
+            }
+            static bool Read( std::vector<T>* t, uint32_t nTypeId, const char* p, size_t nBytes ) {
+                const size_t nElemSize = BinaryNumberSize( nTypeId & ~CVARS_BINARY_ARRAY );
+                if( !( nTypeId & CVARS_BINARY_ARRAY ) || nElemSize == 0 || nBytes % nElemSize != 0 ) {
+                    return false;
+                }
+                const size_t nCount = nBytes / nElemSize;
+                if constexpr( std::is_same<T,bool>::value ) {
+                    std::vector<unsigned char> vTmp( nCount );
+                    if( !ReadBinaryArray( nTypeId, p, nBytes, vTmp.data(), nCount ) ) {
+                        return false;
+                    }
+                    t->assign( vTmp.begin(), vTmp.end() );
+                    return true;
+                }
+                else {
+                    std::vector<T> vTmp( nCount );
+                    if( !ReadBinaryArray( nTypeId, p, nBytes, vTmp.data(), nCount ) ) {
+                        return false;
+                    }
+                    t->swap( vTmp );
+                    return true;
+                }
+            }
+        };
+
+    // std::arrays of numbers
+    template <class T, size_t N>
+        struct CVarBinaryValue<std::array<T,N>, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+            static uint32_t Write( std::array<T,N>* t, std::string& sOut ) {
+                sOut.append( (const char*)t->data(), N * sizeof( T ) );
+                return CVARS_BINARY_ARRAY | BinaryNumberTypeId<T>();
+            }
+            static bool Read( std::array<T,N>* t, uint32_t nTypeId, const char* p, size_t nBytes ) {
+                std::array<T,N> vTmp;
+                if( !ReadBinaryArray( nTypeId, p, nBytes, vTmp.data(), N ) ) {
+                    return false;
+                }
+                *t = vTmp;
+                return true;
+            }
+        };
+
+    // C arrays of numbers (AttachCVar)
+    template <class T, size_t N>
+        struct CVarBinaryValue<T[N], typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+            static uint32_t Write( T (*t)[N], std::string& sOut ) {
+                sOut.append( (const char*)*t, N * sizeof( T ) );
+                return CVARS_BINARY_ARRAY | BinaryNumberTypeId<T>();
+            }
+            static bool Read( T (*t)[N], uint32_t nTypeId, const char* p, size_t nBytes ) {
+                std::array<T,N> vTmp;
+                if( !ReadBinaryArray( nTypeId, p, nBytes, vTmp.data(), N ) ) {
+                    return false;
+                }
+                memcpy( *t, vTmp.data(), N * sizeof( T ) );
+                return true;
+            }
+        };
+}
+
+#endif
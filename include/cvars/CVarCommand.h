@@ -0,0 +1,202 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+////////////////////////////////////////////////////////////////////////////////
+// Typed console commands: functions with ordinary parameters, called from
+// the console with their arguments converted to the parameter types.
+// Example:
+//  "bool Teleport( float x, float y, std::string_view sZone );
+//   CVarUtils::CreateCommand( "teleport", Teleport, "Moves the player" );"
+// then "teleport 10 2.5 north" in the console calls Teleport( 10, 2.5, "north" ).
+// The conversions are generated from the signature when the command is
+// created.  A wrong number of arguments or an argument that does not convert
+// is reported (with the usage) instead of calling the function.
+// Arguments are split as console words (see NextCommandWord), so they can be
+// quoted.  Integers and floats are read with std::from_chars, bools as 1/0,
+// true/false, on/off or yes/no, and std::string_view arguments point into the
+// command line, valid during the call only.  Other types are read with operator>>, as
+// CVar values are.  Captureless lambdas can be passed with a unary +.
+
+#ifndef _CVAR_COMMAND_H_
+#define _CVAR_COMMAND_H_
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+#include <cvars/CVar.h>
+
+namespace CVarUtils {
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// The value of a typed command CVar: the function, and the code converting
+    /// the arguments and calling it.
+    struct CVarCommand
+    {
+        // false with sError set if the arguments do not match the parameters
+        bool (*m_pInvoke)( void (*pFunc)(), std::string_view sArgs, std::string& sError );
+        void (*m_pFunc)();
+        std::string m_sUsage; // e.g. "teleport <number> <number> <string>"
+    };
+
+    inline std::ostream &operator<<( std::ostream &stream, CVarCommand & )
+    {
+        return stream;
+    }
+
+    inline std::istream &operator>>( std::istream &stream, CVarCommand & )
+    {
+        return stream;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Conversion of one argument to a parameter of type T.
+    template <class T, class Enable = void>
+        struct CVarCommandArg
+        {
+            static bool Parse( std::string_view s, T& t ) {
+                std::istringstream sIn{ std::string( s ) };
+                sIn >> t;
+                return !sIn.fail() && ( sIn >> std::ws ).eof();
+            }
+            static const char* Name() { return "value"; }
+        };
+
+    template <class T>
+        struct CVarCommandArg<T, typename std::enable_if<std::is_arithmetic<T>::value &&
+                                                         !std::is_same<T, bool>::value>::type>
+        {
+            static bool Parse( std::string_view s, T& t ) {
+                if( s.size() > 1 && s[0] == '+' ) {
+                    s.remove_prefix( 1 );
+                }
+                const std::from_chars_result res = std::from_chars( s.data(), s.data() + s.size(), t );
+                return res.ec == std::errc() && res.ptr == s.data() + s.size();
+            }
+            static const char* Name() { return std::is_integral<T>::value ? "integer" : "number"; }
+        };
+
+    template <>
+        struct CVarCommandArg<bool>
+        {
+            static bool Parse( std::string_view s, bool& t ) {
+                if( s == "1" || s == "true" || s == "on" || s == "yes" ) {
+                    t = true;
+                    return true;
+                }
+                if( s == "0" || s == "false" || s == "off" || s == "no" ) {
+                    t = false;
+                    return true;
+                }
+                return false;
+            }
+            static const char* Name() { return "bool"; }
+        };
+
+    template <>
+        struct CVarCommandArg<std::string_view>
+        {
+            static bool Parse( std::string_view s, std::string_view& t ) { t = s; return true; }
+            static const char* Name() { return "string"; }
+        };
+
+    template <>
+        struct CVarCommandArg<std::string>
+        {
+            static bool Parse( std::string_view s, std::string& t ) { t.assign( s ); return true; }
+            static const char* Name() { return "string"; }
+        };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Splits the arguments of a command into pArgs (at most nMaxArgs of them,
+    // see NextCommandWord) and returns how many there are.  Implemented in
+    // CVarParse.cpp.
+    size_t SplitCommandArgs( std::string_view sArgs, std::string_view* pArgs, size_t nMaxArgs,
+                             std::string& sUnescaped );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // The CVarCommand::m_pInvoke of a function R(Args...): the arguments are
+    // split into views on the stack and converted into a tuple, no heap
+    // allocation unless a parameter type needs one.
+    template <class R, class... Args>
+        struct CVarCommandInvoker
+        {
+            typedef R (*Func)( Args... );
+
+            static bool Invoke( void (*pFunc)(), std::string_view sArgs, std::string& sError ) {
+                return Call( (Func)pFunc, sArgs, sError, std::index_sequence_for<Args...>() );
+            }
+
+            template <size_t... I>
+                static bool Call( Func pFunc, std::string_view sArgs, std::string& sError,
+                                  std::index_sequence<I...> ) {
+                    // one more to tell too many arguments
+                    std::string_view vArgs[ sizeof...( Args ) + 1 ];
+                    std::string sUnescaped;
+                    const size_t nArgs = SplitCommandArgs( sArgs, vArgs, sizeof...( Args ) + 1, sUnescaped );
+                    if( nArgs != sizeof...( Args ) ) {
+                        sError = "expected " + std::to_string( sizeof...( Args ) ) + " argument" +
+                            ( sizeof...( Args ) == 1 ? "" : "s" ) + ", got " +
+                            ( nArgs > sizeof...( Args ) ? "more" : std::to_string( nArgs ) );
+                        return false;
+                    }
+                    std::tuple< typename std::decay<Args>::type... > values;
+                    if( !( Parse<I>( vArgs[I], std::get<I>( values ), sError ) && ... ) ) {
+                        return false;
+                    }
+                    if constexpr( std::is_void<R>::value ) {
+                        pFunc( std::get<I>( std::move( values ) )... );
+                        return true;
+                    }
+                    else {
+                        return pFunc( std::get<I>( std::move( values ) )... );
+                    }
+                }
+
+            template <size_t I, class T>
+                static bool Parse( std::string_view s, T& t, std::string& sError ) {
+                    if( CVarCommandArg<T>::Parse( s, t ) ) {
+                        return true;
+                    }
+                    const std::string sType( CVarCommandArg<T>::Name() );
+                    const bool bVowel = std::string( "aeiou" ).find( sType[0] ) != std::string::npos;
+                    sError = "argument " + std::to_string( I + 1 ) + " \"" + std::string( s ) +
+                        "\" is not " + ( bVowel ? "an " : "a " ) + sType;
+                    return false;
+                }
+
+            static std::string Usage( const std::string& sName ) {
+                std::string sUsage( sName );
+                ( ( sUsage += std::string( " <" ) + CVarCommandArg< typename std::decay<Args>::type >::Name() + ">" ), ... );
+                return sUsage;
+            }
+        };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Creates the console command s calling pFunc, which returns bool
+     *  (false for failure) or void.  Commands are never saved.
+     *  eg. CVarUtils::CreateCommand( "teleport", Teleport, "Moves the player" );
+     */
+    template <class R, class... Args> CVarCommand& CreateCommand(
+            const std::string& s,
+            R (*pFunc)( Args... ),
+            const std::string& sHelp = "No help available" )
+    {
+        static_assert( std::is_void<R>::value || std::is_convertible<R, bool>::value,
+                       "Commands must return bool or void" );
+        CVarCommand command;
+        command.m_pInvoke = CVarCommandInvoker<R, Args...>::Invoke;
+        command.m_pFunc = (void (*)())pFunc;
+        command.m_sUsage = CVarCommandInvoker<R, Args...>::Usage( s );
+        return CreateUnsavedCVar<CVarCommand>( s, command, sHelp );
+    }
+}
+
+#endif
@@ -0,0 +1,155 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+////////////////////////////////////////////////////////////////////////////////
+// Derived CVars: CVars whose value is computed from an expression over other
+// CVars.
+// Example:
+//  "const int& nMapSize = CVarUtils::CreateDerivedCVar<int>(
+//           "shadow.mapSize", "1024 * quality.scale" );"
+// The expression is compiled once when the CVar is created.  A derived CVar
+// is only recomputed when one of its inputs changes, never when it is read:
+// writing an input through SetCVar, the console or Load recomputes the CVars
+// depending on it right away, each once and after all of its own inputs (so
+// a value shared by several paths, e.g. a diamond, costs one evaluation).
+// The reference returned stays up to date and reading it costs the same as
+// reading a plain CVar.
+// If an input is changed through a reference, call
+// CVarUtils::NotifyChanged( "quality.scale" ) afterwards.
+// Derived CVars are read only: the console, SetCVar, Load and the overrides
+// refuse to write them.
+//
+// Supported syntax: numbers, CVar names, + - * / % ^, parentheses, unary minus
+// and the functions min, max, abs, floor, ceil, round, sqrt, pow and clamp.
+
+#ifndef _CVAR_EXPRESSION_H_
+#define _CVAR_EXPRESSION_H_
+
+#include <string>
+#include <vector>
+
+#include <cvars/CVar.h>
+
+namespace CVarUtils {
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// An expression compiled to a small stack program.
+    class CVarExpression
+    {
+    public:
+        ////////////////////////////////////////////////////////////////////////////////
+        /// Parses sExpression and resolves the CVar names it uses, returns false
+        /// and fills sError on failure.
+        bool Compile( const std::string& sExpression, std::string& sError );
+
+        ////////////////////////////////////////////////////////////////////////////////
+        double Evaluate();
+
+        ////////////////////////////////////////////////////////////////////////////////
+        /// CVars read by this expression (each appears once).
+        const std::vector<void*>& GetInputs() const { return m_vInputs; }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        /// Replaces the input pCVar, about to be destroyed, by its current value.
+        void RemoveInput( void* pCVar );
+
+    public:
+        enum OpCode {
+            OP_CONST,
+            OP_CVAR,
+            OP_NEG,
+            OP_ADD,
+            OP_SUB,
+            OP_MUL,
+            OP_DIV,
+            OP_MOD,
+            OP_POW,
+            OP_MIN,
+            OP_MAX,
+            OP_ABS,
+            OP_FLOOR,
+            OP_CEIL,
+            OP_ROUND,
+            OP_SQRT,
+            OP_CLAMP
+        };
+
+        struct Instruction {
+            OpCode  m_nOp;
+            double  m_dValue; // OP_CONST
+            void*   m_pCVar;  // OP_CVAR
+        };
+
+    private:
+        std::vector<Instruction> m_vProgram;
+        std::vector<void*>       m_vInputs;
+        std::vector<double>      m_vStack;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Links a derived CVar to its compiled expression.
+    class CVarDerivation
+    {
+    public:
+        CVarExpression m_Expression;
+        void*          m_pCVar;                            // the derived CVar
+        void         (*m_pAssignFuncPtr)( void *, double ); // stores into its m_pVarData
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Registers pDerivation with the CVars its expression reads and computes
+    /// the initial value.
+    void AttachCVarDerivation( void* pCVar, CVarDerivation* pDerivation );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Creates a derived CVar, T must be an arithmetic type.  Derived CVars are
+     *  never saved.  The exception "CVarUtils::InvalidExpression" is thrown if
+     *  the expression does not compile or uses an unknown CVar.
+     *  eg. const int& nMapSize = CVarUtils::CreateDerivedCVar<int>(
+     *          "shadow.mapSize", "1024 * quality.scale" );
+     */
+    template <class T> const T& CreateDerivedCVar(
+            const std::string& s,
+            const std::string& sExpression,
+            const std::string& sHelp = "No help available" )
+    {
+        static_assert( std::is_arithmetic<T>::value,
+                       "Derived CVars must have an arithmetic type" );
+
+        CVarDerivation* pDerivation = new CVarDerivation;
+        std::string sError;
+        if( !pDerivation->m_Expression.Compile( sExpression, sError ) ) {
+            std::cerr << "ERROR compiling expression \"" << sExpression << "\" for "
+                      << s << ": " << sError << std::endl;
+            delete pDerivation;
+            throw InvalidExpression;
+        }
+
+        // derived CVars are read only, values kept for them are dropped
+        if( TrieInstance().ErasePendingValues( s ) ) {
+            std::cerr << "WARNING: " << s << " is derived, ignoring the value loaded or "
+                      << "given for it." << std::endl;
+        }
+
+        try {
+            CreateUnsavedCVar<T>( s, T(), sHelp );
+        }
+        catch( CVarUtils::CVarException e ) {
+            delete pDerivation;
+            throw e;
+        }
+
+        CVar<T>* pCVar = (CVar<T>*)TrieInstance().Find( s )->m_pNodeData;
+        pDerivation->m_pCVar = pCVar;
+        pDerivation->m_pAssignFuncPtr = CVarNumeric<T>::Assign;
+        AttachCVarDerivation( pCVar, pDerivation );
+        return *(pCVar->m_pVarData);
+    }
+}
+
+#endif
@@ -2,120 +2,368 @@
 #define _CVAR_MAP_IO_H_
 
 #include <map>
+#include <unordered_map>
 #include <sstream>
 #include <string>
+#include <cstring>
 #include <iostream>
-#include <tinyxml2.h>
+#include <iterator>
+#include <algorithm>
+
+#include <cvars/CVarValueIO.h>
+#include <cvars/CVarVectorIO.h>
+#include <cvars/CVarArrayIO.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// std::map and std::unordered_map CVars are written on one line:
+//
+//   { 0: zero, 1: "one and a half", 2: [ 1 2 3 ] }
+//
+// Keys and values that contain separators are quoted ("..." with \" \\ \n \t
+// \r escapes), nested containers ("[ ... ]", "{ ... }") are written as is.
+// The map text is scanned once, without building a document.  The <map>
+// format written by earlier versions is still read.
 
 namespace CVarUtils {
-    // All types you wish to use with CVars must overload << and >>
-    // This is a possible overloading for maps
+
+    // Declared first so maps can hold maps.
     template<class K, class D>
-        std::ostream &operator<<( std::ostream &stream, std::map<K,D>& mMap ) {
+        std::ostream &operator<<( std::ostream &stream, std::map<K,D>& mMap );
+    template<class K, class D>
+        std::istream &operator>>( std::istream &stream, std::map<K,D>& mMap );
+    template<class K, class D>
+        std::ostream &operator<<( std::ostream &stream, std::unordered_map<K,D>& mMap );
+    template<class K, class D>
+        std::istream &operator>>( std::istream &stream, std::unordered_map<K,D>& mMap );
 
-        stream << std::endl;
-        stream << CVarUtils::CVarSpc() << "<map>\n";
-        for( typename std::map<K,D>::iterator it = mMap.begin(); it != mMap.end(); ++it ) {
-            CVarUtils::CVarIndent();
-            stream << CVarUtils::CVarSpc() << "<Object>\n";
-            CVarUtils::CVarIndent();
-            stream << CVarUtils::CVarSpc() << "<Key>  " << it->first << "  </Key>" << std::endl;
-            stream << CVarUtils::CVarSpc() << "<Data>  ";
-            CVarUtils::CVarIndent();
-            stream << it->second;
-            CVarUtils::CVarUnIndent();
-            stream << CVarUtils::CVarSpc() << "</Data>" << std::endl;
-            CVarUtils::CVarUnIndent();
-            stream << CVarUtils::CVarSpc() << "</Object>" << std::endl;
-            CVarUtils::CVarUnIndent();
-        }      
-        stream << CVarUtils::CVarSpc() << "</map>" << std::endl;
-        return stream;
+    ////////////////////////////////////////////////////////////////////////////////
+    inline bool IsMapSeparator( char c ) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+               c == ',' || c == ':' || c == '"' || c == '\\' ||
+               c == '[' || c == ']' || c == '{' || c == '}';
     }
 
-    template<class K, class D>
-        std::istream &operator>>( std::istream &stream, std::map<K,D>& mMap ) {
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Returns the end of the token starting at p: a quoted string, or else
+    /// everything up to cStop, ',' or '}' outside brackets and quotes.
+    inline const char* ScanMapToken( const char* p, const char* pEnd, char cStop ) {
+        if( p != pEnd && *p == '"' ) {
+            for( ++p; p != pEnd && *p != '"'; ++p ) {
+                if( *p == '\\' && p + 1 != pEnd ) {
+                    ++p;
+                }
+            }
+            return p == pEnd ? p : p + 1;
+        }
+        const char* pStart = p;
+        int nDepth = 0;
+        bool bQuoted = false;
+        for( ; p != pEnd; ++p ) {
+            const char c = *p;
+            if( bQuoted ) {
+                if( c == '\\' && p + 1 != pEnd ) {
+                    ++p;
+                }
+                else if( c == '"' ) {
+                    bQuoted = false;
+                }
+                continue;
+            }
+            if( c == '"' ) {
+                bQuoted = true;
+            }
+            else if( c == '[' || c == '{' ) {
+                nDepth++;
+            }
+            else if( nDepth > 0 && ( c == ']' || c == '}' ) ) {
+                nDepth--;
+            }
+            else if( nDepth == 0 && ( c == cStop || c == ',' || c == '}' ) ) {
+                break;
+            }
+        }
+        // trailing blanks are not part of the token
+        while( p != pStart && ( p[-1] == ' ' || p[-1] == '\t' || p[-1] == '\n' || p[-1] == '\r' ) ) {
+            --p;
+        }
+        return p;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Writes s quoted and escaped if it would not read back as one token.
+    inline void WriteMapString( std::ostream& stream, const std::string& s ) {
+        bool bQuote = s.empty();
+        for( size_t i=0; i<s.size() && !bQuote; i++ ) {
+            bQuote = IsMapSeparator( s[i] );
+        }
+        if( !bQuote ) {
+            stream.write( s.data(), s.size() );
+            return;
+        }
+        stream.put( '"' );
+        for( size_t i=0; i<s.size(); i++ ) {
+            switch( s[i] ) {
+            case '"':  stream.write( "\\\"", 2 ); break;
+            case '\\': stream.write( "\\\\", 2 ); break;
+            case '\n': stream.write( "\\n", 2 );  break;
+            case '\t': stream.write( "\\t", 2 );  break;
+            case '\r': stream.write( "\\r", 2 );  break;
+            default:   stream.put( s[i] );        break;
+            }
+        }
+        stream.put( '"' );
+    }
 
-        tinyxml2::XMLDocument doc;
+    ////////////////////////////////////////////////////////////////////////////////
+    /// The text of a map token: quotes removed and escapes resolved.
+    inline std::string MapTokenString( const char* pBegin, const char* pEnd ) {
+        if( pEnd - pBegin < 2 || *pBegin != '"' || pEnd[-1] != '"' ) {
+            return std::string( pBegin, pEnd );
+        }
         std::string s;
-        stream >> s;
-        doc.Parse(s.c_str());
-        //doc.Print( stdout );
-        tinyxml2::XMLNode* pCVarsNode = doc.RootElement();
+        s.reserve( pEnd - pBegin - 2 );
+        for( const char* p = pBegin + 1; p != pEnd - 1; ++p ) {
+            if( *p == '\\' && p + 1 != pEnd - 1 ) {
+                ++p;
+                switch( *p ) {
+                case 'n': s += '\n'; break;
+                case 't': s += '\t'; break;
+                case 'r': s += '\r'; break;
+                default:  s += *p;   break;
+                }
+            }
+            else {
+                s += *p;
+            }
+        }
+        return s;
+    }
 
-        if( pCVarsNode == NULL ) {
-            std::cerr <<  "ERROR: Could not find a <map> node." << std::endl;
-            return stream;
+    ////////////////////////////////////////////////////////////////////////////////
+    template <class T>
+        void WriteMapElement( std::ostream& stream, T& val ) {
+        typedef typename std::remove_cv<T>::type Type;
+        if constexpr( IsFastNumber<Type>::value ) {
+            char sBuf[CVAR_NUMBER_MAX_CHARS];
+            stream.write( sBuf, FormatNumber<Type>( sBuf, val ) - sBuf );
+        }
+        else if constexpr( std::is_same<Type,std::string>::value ) {
+            WriteMapString( stream, val );
+        }
+        else {
+            std::ostringstream oss;
+            oss << val;
+            const std::string s = oss.str();
+            // nested containers are kept as they are
+            if( s.size() >= 2 && ( s[0] == '[' || s[0] == '{' ) &&
+                ( s[s.size()-1] == ']' || s[s.size()-1] == '}' ) &&
+                ScanMapToken( s.data(), s.data() + s.size(), ':' ) == s.data() + s.size() ) {
+                stream.write( s.data(), s.size() );
+            }
+            else {
+                WriteMapString( stream, s );
+            }
         }
+    }
 
-        for( tinyxml2::XMLNode* pNode = pCVarsNode->FirstChild();
-             pNode != NULL;
-             pNode = pNode->NextSibling() ) {
+    ////////////////////////////////////////////////////////////////////////////////
+    template <class T>
+        bool ParseMapElement( const char* pBegin, const char* pEnd, T& val ) {
+        if constexpr( IsFastNumber<T>::value ) {
+            if( pBegin == pEnd || *pBegin != '"' ) {
+                return ParseNumber( pBegin, pEnd, val );
+            }
+        }
+        if constexpr( std::is_same<T,std::string>::value ) {
+            val = MapTokenString( pBegin, pEnd );
+            return true;
+        }
+        else {
+            std::istringstream iss( MapTokenString( pBegin, pEnd ) );
+            iss >> val;
+            return !iss.fail();
+        }
+    }
 
-            std::string sObject( pNode->Value() );
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Parses "{ key: value, ... }" into mMap, which is only modified on success.
+    template <class M>
+        bool ParseMap( const char* pBegin, const char* pEnd, M& mMap ) {
+        const char* p = pBegin;
+        while( p != pEnd && IsElementSeparator( *p ) ) {
+            ++p;
+        }
+        if( p == pEnd || *p != '{' ) {
+            std::cerr << "ERROR parsing map, expecting '{'." << std::endl;
+            return false;
+        }
+        ++p;
 
-            if( sObject != "Object" ) {
-                std::cerr << "WARNING: got '" << sObject << "' value when expecting 'Object'." << std::endl;
-                continue;
+        M mTmp;
+        while( true ) {
+            while( p != pEnd && ( IsElementSeparator( *p ) && *p != '[' && *p != ']' ) ) {
+                ++p;
+            }
+            if( p == pEnd ) {
+                std::cerr << "ERROR parsing map, missing closing '}'." << std::endl;
+                return false;
+            }
+            if( *p == '}' ) {
+                break;
             }
 
-            K KKey;
-            D DData;
+            const char* pKey = p;
+            const char* pKeyEnd = ScanMapToken( p, pEnd, ':' );
+            p = pKeyEnd;
+            while( p != pEnd && ( *p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' ) ) {
+                ++p;
+            }
+            if( p == pEnd || *p != ':' ) {
+                std::cerr << "ERROR parsing map, expecting ':' after key \""
+                          << std::string( pKey, pKeyEnd ) << "\"." << std::endl;
+                return false;
+            }
+            ++p;
+            while( p != pEnd && ( *p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' ) ) {
+                ++p;
+            }
+            const char* pData = p;
+            const char* pDataEnd = ScanMapToken( p, pEnd, '\0' );
+            p = pDataEnd;
 
-            ////////////////////////////////////////////////////////
-            tinyxml2::XMLNode* pChild = pNode->FirstChild();
-            ////////////////////////////////////////////////////////
-            if( pChild == NULL ) {
-                std::cerr << "ERROR parsing map, could not find first child (Key) of Object." << std::endl;
-                return stream;
+            typename M::key_type KKey;
+            typename M::mapped_type DData;
+            if( !ParseMapElement( pKey, pKeyEnd, KKey ) ) {
+                std::cerr << "ERROR parsing map, invalid key \""
+                          << std::string( pKey, pKeyEnd ) << "\"." << std::endl;
+                return false;
             }
-            else {
-                if( std::string( pChild->Value() ) != "Key" ) {
-                    std::cerr << "ERROR parsing key in map, expecting 'Key' node, got "<< pChild->Value() << "." << std::endl;
-                    return stream;
-                }
+            if( !ParseMapElement( pData, pDataEnd, DData ) ) {
+                std::cerr << "ERROR parsing map, invalid data \""
+                          << std::string( pData, pDataEnd ) << "\"." << std::endl;
+                return false;
+            }
+            mTmp[ KKey ] = DData;
+        }
+        mMap.swap( mTmp );
+        return true;
+    }
 
-                tinyxml2::XMLNode* pKeyChild = pChild->FirstChild();
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Text between <sTag> and </sTag> at or after p, NULL if not found.
+    inline const char* FindMapTag( const char* p, const char* pEnd, const char* sTag,
+                                   const char*& pTextEnd ) {
+        const std::string sOpen = std::string( "<" ) + sTag + ">";
+        const std::string sClose = std::string( "</" ) + sTag + ">";
+        const char* pOpen = std::search( p, pEnd, sOpen.begin(), sOpen.end() );
+        if( pOpen == pEnd ) {
+            return NULL;
+        }
+        const char* pText = pOpen + sOpen.size();
+        pTextEnd = std::search( pText, pEnd, sClose.begin(), sClose.end() );
+        if( pTextEnd == pEnd ) {
+            return NULL;
+        }
+        while( pText != pTextEnd && IsElementSeparator( *pText ) && *pText != '[' ) {
+            ++pText;
+        }
+        while( pTextEnd != pText && IsElementSeparator( pTextEnd[-1] ) && pTextEnd[-1] != ']' ) {
+            --pTextEnd;
+        }
+        return pText;
+    }
 
-                if( pKeyChild == NULL ) {
-                    std::cerr << "ERROR parsing key value in map (empty Key ?).\n" << std::endl;
-                    return stream;
-                }           
-                std::stringstream iKeyString(pKeyChild->ToText()->Value());
-                iKeyString >> KKey;
-                //std::cout << "Key value: " << pChild->FirstChild()->Value() << std::endl;
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Reads the "<map><Object><Key>k</Key><Data>d</Data></Object>...</map>"
+    /// format written by earlier versions.
+    template <class M>
+        bool ParseLegacyMap( const char* pBegin, const char* pEnd, M& mMap ) {
+        M mTmp;
+        const char* p = pBegin;
+        const char* pKeyEnd;
+        const char* pDataEnd;
+        while( const char* pKey = FindMapTag( p, pEnd, "Key", pKeyEnd ) ) {
+            const char* pData = FindMapTag( pKeyEnd, pEnd, "Data", pDataEnd );
+            if( pData == NULL ) {
+                std::cerr << "ERROR parsing map, could not find Data of Object." << std::endl;
+                return false;
             }
-
-            ////////////////////////////////////////////////////////
-            pChild = pChild->NextSibling();
-            ////////////////////////////////////////////////////////
-            if( pChild == NULL ) {
-                std::cerr << "ERROR parsing map, could not find 2nd child (Data) of Object." << std::endl;
-                return stream;
+            typename M::key_type KKey;
+            typename M::mapped_type DData;
+            if( !ParseMapElement( pKey, pKeyEnd, KKey ) ||
+                !ParseMapElement( pData, pDataEnd, DData ) ) {
+                std::cerr << "ERROR parsing map Object \"" << std::string( pKey, pKeyEnd )
+                          << "\"." << std::endl;
+                return false;
             }
-            else {
-                if( std::string( pChild->Value() ) != "Data" ) {
-                    std::cerr << "ERROR parsing key in map, expecting 'Data' node, got "<< pChild->Value() << "." << std::endl;
-                    return stream;
-                }
-
-                tinyxml2::XMLNode* pDataChild = pChild->FirstChild();
+            mTmp[ KKey ] = DData;
+            p = pDataEnd;
+        }
+        mMap.swap( mTmp );
+        return true;
+    }
 
-                if( pDataChild == NULL ) {
-                    std::cerr << "ERROR parsing Data value in map (empty Data ?).\n" << std::endl;
-                    return stream;
-                }
-                std::stringstream iDataString(pDataChild->ToText()->Value());
-                iDataString >> DData;         
-                //std::cout << "Data value: " << pChild->FirstChild()->Value() << std::endl;
+    ////////////////////////////////////////////////////////////////////////////////
+    template <class M>
+        std::ostream& WriteMap( std::ostream& stream, M& mMap ) {
+        if( mMap.empty() ) {
+            stream << "{ }";
+            return stream;
+        }
+        stream << "{ ";
+        for( typename M::iterator it = mMap.begin(); it != mMap.end(); ++it ) {
+            if( it != mMap.begin() ) {
+                stream.write( ", ", 2 );
             }
-            ////////////////////////////////////////////////////////
-            //std::cout << "Found Key: " << KKey << " with data: " << DData << std::endl;
+            WriteMapElement( stream, it->first );
+            stream.write( ": ", 2 );
+            WriteMapElement( stream, it->second );
+        }
+        stream << " }";
+        return stream;
+    }
 
-            mMap[ KKey ] = DData;
+    ////////////////////////////////////////////////////////////////////////////////
+    template <class M>
+        std::istream& ReadMap( std::istream& stream, M& mMap ) {
+        std::string sBuf( (std::istreambuf_iterator<char>( stream )),
+                          std::istreambuf_iterator<char>() );
+        stream.setstate( std::ios::eofbit );
+        const char* pBegin = sBuf.data();
+        const char* pEnd = pBegin + sBuf.size();
+        const char* pFirst = pBegin;
+        while( pFirst != pEnd && IsElementSeparator( *pFirst ) ) {
+            ++pFirst;
+        }
+        const bool bOk = ( pFirst != pEnd && *pFirst == '<' ) ?
+            ParseLegacyMap( pFirst, pEnd, mMap ) : ParseMap( pFirst, pEnd, mMap );
+        if( !bOk ) {
+            stream.setstate( std::ios::failbit );
         }
         return stream;
     }
+
+    // All types you wish to use with CVars must overload << and >>
+    // This is a possible overloading for maps
+    template<class K, class D>
+        std::ostream &operator<<( std::ostream &stream, std::map<K,D>& mMap ) {
+        return WriteMap( stream, mMap );
+    }
+
+    template<class K, class D>
+        std::istream &operator>>( std::istream &stream, std::map<K,D>& mMap ) {
+        return ReadMap( stream, mMap );
+    }
+
+    template<class K, class D>
+        std::ostream &operator<<( std::ostream &stream, std::unordered_map<K,D>& mMap ) {
+        return WriteMap( stream, mMap );
+    }
+
+    template<class K, class D>
+        std::istream &operator>>( std::istream &stream, std::unordered_map<K,D>& mMap ) {
+        return ReadMap( stream, mMap );
+    }
 }
 
 #endif
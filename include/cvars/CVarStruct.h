@@ -0,0 +1,269 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+////////////////////////////////////////////////////////////////////////////////
+// Registration of a whole settings struct in one call.
+// Example:
+//   struct ShadowSettings { int mapSize; float bias; bool enabled; };
+//   CVAR_STRUCT( ShadowSettings, mapSize, bias, enabled )
+//
+//   ShadowSettings shadow;
+//   CVarUtils::AttachCVarStruct( "renderer.shadow", &shadow );
+// creates "renderer.shadow.mapSize", "renderer.shadow.bias" and
+// "renderer.shadow.enabled" bound to the fields of 'shadow'.  The prefix path
+// is walked once for all the fields and no CVarRef is allocated: the CVars
+// point directly at the fields, so GetCVarRef<int>( "renderer.shadow.mapSize" )
+// works as for a CVar created with CreateCVar.
+//
+// CVAR_STRUCT must be used in the namespace of the struct (it is found by
+// argument dependent lookup) and accepts up to 32 fields.
+//
+// Trivially copyable structs can also be saved and loaded as one binary block
+// with SaveCVarStruct and LoadCVarStruct, which notifies the CVars of the
+// fields it changed.
+
+#ifndef _CVAR_STRUCT_H_
+#define _CVAR_STRUCT_H_
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <stdint.h>
+
+#include <cvars/CVar.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Preprocessor "for each" over up to 32 field names.
+#define CVAR_STRUCT_EXPAND( x ) x
+#define CVAR_STRUCT_FE_1( M, x )       M( x )
+#define CVAR_STRUCT_FE_2( M, x, ... )  M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_1( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_3( M, x, ... )  M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_2( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_4( M, x, ... )  M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_3( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_5( M, x, ... )  M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_4( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_6( M, x, ... )  M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_5( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_7( M, x, ... )  M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_6( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_8( M, x, ... )  M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_7( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_9( M, x, ... )  M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_8( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_10( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_9( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_11( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_10( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_12( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_11( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_13( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_12( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_14( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_13( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_15( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_14( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_16( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_15( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_17( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_16( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_18( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_17( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_19( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_18( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_20( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_19( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_21( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_20( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_22( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_21( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_23( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_22( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_24( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_23( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_25( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_24( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_26( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_25( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_27( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_26( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_28( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_27( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_29( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_28( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_30( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_29( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_31( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_30( M, __VA_ARGS__ ) )
+#define CVAR_STRUCT_FE_32( M, x, ... ) M( x ) CVAR_STRUCT_EXPAND( CVAR_STRUCT_FE_31( M, __VA_ARGS__ ) )
+
+#define CVAR_STRUCT_GET_FE( _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, \
+                            _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, \
+                            _31, _32, NAME, ... ) NAME
+
+#define CVAR_STRUCT_FOR_EACH( M, ... )                                                          \
+    CVAR_STRUCT_EXPAND( CVAR_STRUCT_GET_FE( __VA_ARGS__,                                        \
+        CVAR_STRUCT_FE_32, CVAR_STRUCT_FE_31, CVAR_STRUCT_FE_30, CVAR_STRUCT_FE_29,             \
+        CVAR_STRUCT_FE_28, CVAR_STRUCT_FE_27, CVAR_STRUCT_FE_26, CVAR_STRUCT_FE_25,             \
+        CVAR_STRUCT_FE_24, CVAR_STRUCT_FE_23, CVAR_STRUCT_FE_22, CVAR_STRUCT_FE_21,             \
+        CVAR_STRUCT_FE_20, CVAR_STRUCT_FE_19, CVAR_STRUCT_FE_18, CVAR_STRUCT_FE_17,             \
+        CVAR_STRUCT_FE_16, CVAR_STRUCT_FE_15, CVAR_STRUCT_FE_14, CVAR_STRUCT_FE_13,             \
+        CVAR_STRUCT_FE_12, CVAR_STRUCT_FE_11, CVAR_STRUCT_FE_10, CVAR_STRUCT_FE_9,              \
+        CVAR_STRUCT_FE_8, CVAR_STRUCT_FE_7, CVAR_STRUCT_FE_6, CVAR_STRUCT_FE_5,                 \
+        CVAR_STRUCT_FE_4, CVAR_STRUCT_FE_3, CVAR_STRUCT_FE_2, CVAR_STRUCT_FE_1 )( M, __VA_ARGS__ ) )
+
+#define CVAR_STRUCT_VISIT_FIELD( field ) visitor( #field, s.field );
+
+////////////////////////////////////////////////////////////////////////////////
+/// Declares the fields of 'Type' that AttachCVarStruct registers.
+#define CVAR_STRUCT( Type, ... )                                                \
+    template <class Visitor>                                                    \
+    inline void CVarVisitFields( Type& s, Visitor& visitor ) {                  \
+        CVAR_STRUCT_FOR_EACH( CVAR_STRUCT_VISIT_FIELD, __VA_ARGS__ )            \
+    }
+
+namespace CVarUtils {
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Field visitors used by AttachCVarStruct and the block IO.
+    struct CVarStructChecker {
+        Trie*       m_pTrie;
+        TrieNode*   m_pPrefixNode;
+        std::string m_sPrefix;
+        template <class F> void operator()( const char* sField, F& ) {
+            if( m_pPrefixNode != NULL && m_pTrie->FindFrom( m_pPrefixNode, sField ) != NULL ) {
+                throw CVarAlreadyCreated;
+            }
+            if( IsReservedCVarName( m_sPrefix + sField ) ) {
+                throw ReservedName;
+            }
+        }
+    };
+
+    struct CVarStructRegistrar {
+        Trie*              m_pTrie;
+        TrieNode*          m_pPrefixNode;
+        std::string        m_sPrefix;
+        const std::string* m_pHelp;
+        template <class F> void operator()( const char* sField, F& field ) {
+            const std::string sName = m_sPrefix + sField;
+            CVar<F>* pCVar = new CVar<F>( sName, &field, *m_pHelp, true );
+            m_pTrie->InsertLeaf( m_pTrie->InsertPath( m_pPrefixNode, sField ), sName, (void*)pCVar );
+        }
+    };
+
+    // the fields whose bytes differ between *this struct and m_pOther
+    struct CVarStructDiff {
+        const char*         m_pBase;
+        const char*         m_pOther;
+        std::vector<void*>  m_vChanged;
+        template <class F> void operator()( const char*, F& field ) {
+            if( memcmp( &field, m_pOther + ( (const char*)&field - m_pBase ), sizeof( F ) ) != 0 ) {
+                m_vChanged.push_back( &field );
+            }
+        }
+    };
+
+    struct CVarStructSignature {
+        const char* m_pBase;
+        uint64_t    m_nHash;
+        template <class F> void operator()( const char* sField, F& field ) {
+            // FNV-1a over field names, offsets and sizes: detects layout changes
+            for( const char* c = sField; *c; c++ ) {
+                _Mix( (unsigned char)*c );
+            }
+            _Mix( (uint64_t)( (const char*)&field - m_pBase ) );
+            _Mix( (uint64_t)sizeof( F ) );
+        }
+        void _Mix( uint64_t n ) {
+            m_nHash ^= n;
+            m_nHash *= 1099511628211ULL;
+        }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Registers every field listed with CVAR_STRUCT as "sPrefix.field", bound to
+     *  the fields of *pStruct.  All the fields are checked before any is
+     *  inserted: the exception "CVarUtils::CVarAlreadyCreated" is thrown, and
+     *  nothing is registered, if one of the names is already used,
+     *  "CVarUtils::ReservedName" if one is reserved (see CreateCVar) or if
+     *  sPrefix names a console function.
+     */
+    template <class S>
+    void AttachCVarStruct( const std::string& sPrefix,
+                           S* pStruct,
+                           const std::string& sHelp = "No help available" )
+    {
+        Trie& trie = TrieInstance();
+        const std::string sPath = sPrefix + ".";
+        TrieNode* pPrefixLeaf = trie.Find( sPrefix );
+        if( pPrefixLeaf != NULL && IsConsoleFunc( pPrefixLeaf ) ) {
+            throw ReservedName;
+        }
+
+        CVarStructChecker checker = { &trie, trie.FindPath( trie.GetRoot(), sPath ), sPath };
+        CVarVisitFields( *pStruct, checker );
+
+        CVarStructRegistrar registrar = { &trie, trie.InsertPath( trie.GetRoot(), sPath ), sPath, &sHelp };
+        CVarVisitFields( *pStruct, registrar );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Layout signature of a CVAR_STRUCT, stored with the binary block.
+    template <class S>
+    uint64_t CVarStructLayout( S& s )
+    {
+        CVarStructSignature signature = { (const char*)&s, 14695981039346656037ULL };
+        CVarVisitFields( s, signature );
+        signature._Mix( (uint64_t)sizeof( S ) );
+        return signature.m_nHash;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Saves a trivially copyable CVAR_STRUCT as one binary block, preceded by
+     *  a layout signature.
+     */
+    template <class S>
+    bool SaveCVarStruct( const std::string& sFileName, S& s )
+    {
+        static_assert( std::is_trivially_copyable<S>::value,
+                       "Only trivially copyable structs can be saved as a block" );
+        std::ofstream sOut( sFileName.c_str(), std::ios::binary );
+        if( !sOut.is_open() ) {
+            return false;
+        }
+        const uint64_t nLayout = CVarStructLayout( s );
+        sOut.write( (const char*)&nLayout, sizeof( nLayout ) );
+        sOut.write( (const char*)&s, sizeof( S ) );
+        return sOut.good();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /** Loads a block written by SaveCVarStruct, then notifies the CVars
+     *  bound to the fields whose value changed.  Returns false, leaving s
+     *  untouched, if the file cannot be read or was written for a different
+     *  layout of S.
+     */
+    template <class S>
+    bool LoadCVarStruct( const std::string& sFileName, S& s )
+    {
+        static_assert( std::is_trivially_copyable<S>::value,
+                       "Only trivially copyable structs can be loaded as a block" );
+        std::ifstream sIn( sFileName.c_str(), std::ios::binary );
+        if( !sIn.is_open() ) {
+            return false;
+        }
+        uint64_t nLayout = 0;
+        S loaded;
+        sIn.read( (char*)&nLayout, sizeof( nLayout ) );
+        sIn.read( (char*)&loaded, sizeof( S ) );
+        if( !sIn.good() ) {
+            return false;
+        }
+        if( nLayout != CVarStructLayout( s ) ) {
+            std::cerr << "ERROR loading \"" << sFileName << "\": struct layout changed." << std::endl;
+            return false;
+        }
+        CVarStructDiff diff = { (const char*)&s, (const char*)&loaded, std::vector<void*>() };
+        CVarVisitFields( s, diff );
+        s = loaded;
+        if( diff.m_vChanged.empty() ) {
+            return true;
+        }
+        // the CVars attached to the changed fields
+        std::sort( diff.m_vChanged.begin(), diff.m_vChanged.end() );
+        const std::vector<void*>& vAllCVars = TrieInstance().GetAllCVars();
+        std::vector<void*> vChangedCVars;
+        for( size_t ii = 0; ii < vAllCVars.size(); ii++ ) {
+            void* pVarData = ((CVar<int>*)vAllCVars[ii])->m_pVarData;
+            if( std::binary_search( diff.m_vChanged.begin(), diff.m_vChanged.end(), pVarData ) ) {
+                vChangedCVars.push_back( vAllCVars[ii] );
+            }
+        }
+        if( !vChangedCVars.empty() ) {
+            NotifyCVarsChanged( vChangedCVars.data(), vChangedCVars.size() );
+        }
+        return true;
+    }
+}
+
+#endif
@@ -0,0 +1,132 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+////////////////////////////////////////////////////////////////////////////////
+// Low level helpers used by the container serialisers (CVarVectorIO.h, ...)
+// to format and parse numbers without a stringstream per element, and the
+// base64 encoding of large numeric arrays.
+
+#ifndef _CVAR_VALUE_IO_H_
+#define _CVAR_VALUE_IO_H_
+
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <type_traits>
+#include <stdint.h>
+
+////////////////////////////////////////////////////////////////////////////////
+/// How numeric arrays (std::vector of numbers) are written by Save in XML and
+/// TXT files (the console and GetValueAsString always show them as text):
+/// - CVARS_ARRAY_TEXT is the default: "[ 1 2 3 ]"
+/// - CVARS_ARRAY_BASE64 writes the little-endian binary values base64 encoded:
+///   "@base64 f32 3 AACAPwAAAEAAAEBA".  Loading recognises both forms.
+enum CVARS_ARRAY_ENCODING
+  {
+    CVARS_ARRAY_TEXT,
+    CVARS_ARRAY_BASE64
+  };
+
+namespace CVarUtils {
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Base64 (RFC 4648, with padding).  Lives in CVarValueIO.cpp.
+    void   Base64Encode( std::ostream& stream, const void* pData, size_t nBytes );
+    /// Decodes [pBegin,pEnd) into pOut, which must hold nMaxBytes, returns the
+    /// number of bytes decoded or -1 on invalid input.
+    long   Base64Decode( const char* pBegin, const char* pEnd, void* pOut, size_t nMaxBytes );
+
+    ////////////////////////////////////////////////////////////////////////////////
+    inline bool IsLittleEndianHost() {
+        const uint16_t nOne = 1;
+        return *(const unsigned char*)&nOne == 1;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Element tag written in base64 arrays: kind ('f', 'i', 'u' or 'b' for
+    /// bool) followed by the size in bits.
+    template <class T>
+        std::string ArrayTypeTag() {
+            const char cKind = std::is_same<T,bool>::value ? 'b' :
+                               std::is_floating_point<T>::value ? 'f' :
+                               std::is_signed<T>::value ? 'i' : 'u';
+            return cKind + std::to_string( 8 * sizeof( T ) );
+        }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Numbers parsed and formatted with from_chars/to_chars.  Character types
+    /// keep their stream behaviour (one character, not a number).
+    template <class T>
+        struct IsFastNumber : std::integral_constant<bool,
+            std::is_arithmetic<T>::value &&
+            !std::is_same<T,char>::value &&
+            !std::is_same<T,signed char>::value &&
+            !std::is_same<T,unsigned char>::value> {};
+
+    /// Buffer size always sufficient for one FormatNumber call.
+    const int CVAR_NUMBER_MAX_CHARS = 64;
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Separators between the elements of a serialised container.
+    inline bool IsElementSeparator( char c ) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+               c == ',' || c == '[' || c == ']';
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Parses the whole token [pBegin,pEnd) into val, returns false if the token
+    /// is not a valid number of type T.
+    template <class T>
+        bool ParseNumber( const char* pBegin, const char* pEnd, T& val )
+        {
+            if constexpr( std::is_same<T,bool>::value ) {
+                const size_t nLen = pEnd - pBegin;
+                if( nLen == 4 && strncmp( pBegin, "true", 4 ) == 0 ) {
+                    val = true;
+                    return true;
+                }
+                if( nLen == 5 && strncmp( pBegin, "false", 5 ) == 0 ) {
+                    val = false;
+                    return true;
+                }
+                long nVal = 0;
+                if( !ParseNumber( pBegin, pEnd, nVal ) ) {
+                    return false;
+                }
+                val = ( nVal != 0 );
+                return true;
+            }
+            else {
+                // from_chars does not accept a leading '+'
+                if( pBegin < pEnd && *pBegin == '+' ) {
+                    pBegin++;
+                }
+                std::from_chars_result res = std::from_chars( pBegin, pEnd, val );
+                return res.ec == std::errc() && res.ptr == pEnd;
+            }
+        }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Writes val at pBuf (which must hold CVAR_NUMBER_MAX_CHARS characters) and
+    /// returns the end of the written characters.  Floating point values are
+    /// written with the shortest representation that reads back exactly.
+    template <class T>
+        char* FormatNumber( char* pBuf, T val )
+        {
+            if constexpr( std::is_same<T,bool>::value ) {
+                *pBuf = val ? '1' : '0';
+                return pBuf + 1;
+            }
+            else {
+                return std::to_chars( pBuf, pBuf + CVAR_NUMBER_MAX_CHARS, val ).ptr;
+            }
+        }
+}
+
+#endif
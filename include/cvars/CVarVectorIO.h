@@ -2,11 +2,276 @@
 #define _CVAR_VECTOR_IO_H_
 
 #include <vector>
+#include <string>
+#include <string_view>
 #include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include <cvars/CVarValueIO.h>
 
 #define VECTOR_NAME_MAX 1000
 
 namespace CVarUtils {
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Copies nCount little-endian values of type S from pBytes into vT.
+    template<class S, class T>
+        void CopyArrayElements( const unsigned char* pBytes, size_t nCount, std::vector<T>& vT ) {
+        const bool bSwap = !IsLittleEndianHost();
+        vT.resize( nCount );
+        for( size_t i=0; i<nCount; i++ ) {
+            unsigned char sElem[sizeof( S )];
+            for( size_t b=0; b<sizeof( S ); b++ ) {
+                sElem[b] = pBytes[ i*sizeof( S ) + ( bSwap ? sizeof( S )-1-b : b ) ];
+            }
+            S SVal;
+            memcpy( &SVal, sElem, sizeof( S ) );
+            vT[i] = static_cast<T>( SVal );
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Parses "@base64 <tag> <count> <payload>" as written with the
+    /// CVARS_ARRAY_BASE64 encoding.  Values stored with another numeric type
+    /// than T (eg. saved as float, loaded as double) are converted.
+    template<class T>
+        bool ParseVectorBase64( const char* pBegin, const char* pEnd, std::vector<T>& vT ) {
+        vT.clear();
+        std::istringstream iss( std::string( pBegin, std::min<size_t>( pEnd - pBegin, 64 ) ) );
+        std::string sBase64, sTag;
+        size_t nCount = 0;
+        iss >> sBase64 >> sTag >> nCount;
+        if( iss.fail() || sTag.size() < 2 ) {
+            fprintf( stderr, "ERROR deserialising vector, invalid base64 header.\n" );
+            return false;
+        }
+        const char cKind = sTag[0];
+        const size_t nBits = strtoul( sTag.c_str() + 1, NULL, 10 );
+        const size_t nElemSize = nBits / 8;
+        if( nElemSize == 0 ) {
+            fprintf( stderr, "ERROR deserialising vector, invalid element type \"%s\".\n", sTag.c_str() );
+            return false;
+        }
+        const char* pPayload = pBegin + (size_t)iss.tellg();
+        if( nCount * nElemSize > (size_t)( pEnd - pPayload ) / 4 * 3 + 3 ) {
+            fprintf( stderr, "ERROR deserialising vector, base64 payload shorter than %zu elements.\n",
+                     nCount );
+            return false;
+        }
+
+        std::vector<unsigned char> vBytes( nCount * nElemSize );
+        const long nDecoded = Base64Decode( pPayload, pEnd, vBytes.data(), vBytes.size() );
+        if( nDecoded != (long)vBytes.size() ) {
+            fprintf( stderr, "ERROR deserialising vector, expected %zu base64 encoded bytes.\n",
+                     vBytes.size() );
+            return false;
+        }
+
+        const unsigned char* p = vBytes.data();
+        switch( cKind ) {
+        case 'f':
+            if( nBits == 32 ) { CopyArrayElements<float>( p, nCount, vT ); return true; }
+            if( nBits == 64 ) { CopyArrayElements<double>( p, nCount, vT ); return true; }
+            break;
+        case 'i':
+            if( nBits == 8 )  { CopyArrayElements<int8_t>( p, nCount, vT ); return true; }
+            if( nBits == 16 ) { CopyArrayElements<int16_t>( p, nCount, vT ); return true; }
+            if( nBits == 32 ) { CopyArrayElements<int32_t>( p, nCount, vT ); return true; }
+            if( nBits == 64 ) { CopyArrayElements<int64_t>( p, nCount, vT ); return true; }
+            break;
+        case 'u':
+        case 'b':
+            if( nBits == 8 )  { CopyArrayElements<uint8_t>( p, nCount, vT ); return true; }
+            if( nBits == 16 ) { CopyArrayElements<uint16_t>( p, nCount, vT ); return true; }
+            if( nBits == 32 ) { CopyArrayElements<uint32_t>( p, nCount, vT ); return true; }
+            if( nBits == 64 ) { CopyArrayElements<uint64_t>( p, nCount, vT ); return true; }
+            break;
+        default:
+            break;
+        }
+        fprintf( stderr, "ERROR deserialising vector, invalid element type \"%s\".\n", sTag.c_str() );
+        vT.clear();
+        return false;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Writes vT with the CVARS_ARRAY_BASE64 encoding.
+    template<class T>
+        void WriteVectorBase64( std::ostream &stream, const std::vector<T>& vT ) {
+        stream << "@base64 " << ArrayTypeTag<T>() << " " << vT.size() << " ";
+        if constexpr( !std::is_same<T,bool>::value ) {
+            if( IsLittleEndianHost() ) {
+                Base64Encode( stream, vT.data(), vT.size() * sizeof( T ) );
+                return;
+            }
+        }
+        // std::vector<bool> is not contiguous, big-endian hosts need swapping
+        std::vector<unsigned char> vBytes( vT.size() * sizeof( T ) );
+        for( size_t i=0; i<vT.size(); i++ ) {
+            const T TVal = vT[i];
+            const unsigned char* pVal = (const unsigned char*)&TVal;
+            for( size_t b=0; b<sizeof( T ); b++ ) {
+                vBytes[ i*sizeof( T ) + b ] = pVal[ IsLittleEndianHost() ? b : sizeof( T )-1-b ];
+            }
+        }
+        Base64Encode( stream, vBytes.data(), vBytes.size() );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Writes a CVar value of type T with the CVARS_ARRAY_BASE64 encoding if
+    /// it is a vector of at least nMinElements numbers, returns false (writing
+    /// nothing) otherwise.  Only the XML and TXT savers use it.
+    template<class T>
+        struct CVarBase64Value {
+            static bool Write( T*, size_t, std::ostream& ) { return false; }
+        };
+
+    template<class T>
+        struct CVarBase64Value< std::vector<T> > {
+            static bool Write( std::vector<T>* pVec, size_t nMinElements, std::ostream& stream ) {
+                if constexpr( IsFastNumber<T>::value ) {
+                    if( !pVec->empty() && pVec->size() >= nMinElements ) {
+                        WriteVectorBase64( stream, *pVec );
+                        return true;
+                    }
+                }
+                return false;
+            }
+        };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Separators between the elements of a vector of T: blanks, and for
+    /// numbers also ',', '[' and ']'.  Other elements (eg. strings) may contain
+    /// commas and brackets, a lone "[" or "]" is skipped.
+    template<class T>
+        inline bool IsVectorSeparator( char c ) {
+        if constexpr( IsFastNumber<T>::value ) {
+            return IsElementSeparator( c );
+        }
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Appends the string element s to sOut, quoted and with '"' and '\\'
+    /// escaped if it would not read back as one element.
+    inline void AppendVectorString( std::string& sOut, std::string_view s ) {
+        bool bQuote = s.empty() || s == "[" || s == "]";
+        for( size_t i=0; i<s.size() && !bQuote; i++ ) {
+            bQuote = s[i] == ' ' || s[i] == '\t' || s[i] == '\n' || s[i] == '\r' ||
+                     s[i] == '"' || s[i] == '\\';
+        }
+        if( !bQuote ) {
+            sOut.append( s.data(), s.size() );
+            return;
+        }
+        sOut += '"';
+        for( size_t i=0; i<s.size(); i++ ) {
+            if( s[i] == '"' || s[i] == '\\' ) {
+                sOut += '\\';
+            }
+            sOut += s[i];
+        }
+        sOut += '"';
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Reads the quoted element starting at p (on its '"') into s, returns
+    /// the end of the element.
+    inline const char* ParseQuotedVectorElement( const char* p, const char* pEnd, std::string& s ) {
+        s.clear();
+        for( ++p; p != pEnd && *p != '"'; ++p ) {
+            if( *p == '\\' && p + 1 != pEnd ) {
+                ++p;
+            }
+            s += *p;
+        }
+        return p == pEnd ? p : p + 1;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Parses "[ a b c ]" (commas are also accepted between numbers) in one
+    /// pass.  Elements other than numbers may be quoted.  Invalid elements
+    /// are reported and skipped.
+    template<class T>
+        void ParseVector( const char* pBegin, const char* pEnd, std::vector<T>& vT ) {
+
+        if constexpr( IsFastNumber<T>::value ) {
+            const char* pFirst = pBegin;
+            while( pFirst != pEnd && IsElementSeparator( *pFirst ) ) {
+                ++pFirst;
+            }
+            if( pEnd - pFirst > 7 && strncmp( pFirst, "@base64", 7 ) == 0 ) {
+                ParseVectorBase64( pFirst, pEnd, vT );
+                return;
+            }
+        }
+
+        vT.clear();
+
+        if( IsFastNumber<T>::value ) {
+            // Count the elements first so the vector is allocated once.
+            size_t nTokens = 0;
+            bool bInToken = false;
+            for( const char* p = pBegin; p != pEnd; ++p ) {
+                const bool bSep = IsElementSeparator( *p );
+                nTokens += ( !bSep && !bInToken );
+                bInToken = !bSep;
+            }
+            vT.reserve( nTokens );
+        }
+
+        const char* p = pBegin;
+        while( p != pEnd ) {
+            while( p != pEnd && IsVectorSeparator<T>( *p ) ) {
+                ++p;
+            }
+            if( p == pEnd ) {
+                break;
+            }
+            const char* pToken = p;
+            T TVal;
+            bool bOk;
+            if constexpr( IsFastNumber<T>::value ) {
+                while( p != pEnd && !IsVectorSeparator<T>( *p ) ) {
+                    ++p;
+                }
+                bOk = ParseNumber( pToken, p, TVal );
+            }
+            else {
+                std::string sElem;
+                if( *p == '"' ) {
+                    p = ParseQuotedVectorElement( p, pEnd, sElem );
+                }
+                else {
+                    while( p != pEnd && !IsVectorSeparator<T>( *p ) ) {
+                        ++p;
+                    }
+                    if( p - pToken == 1 && ( *pToken == '[' || *pToken == ']' ) ) {
+                        continue;
+                    }
+                    sElem.assign( pToken, p );
+                }
+                if constexpr( std::is_same<T,std::string>::value ) {
+                    TVal.swap( sElem );
+                    bOk = true;
+                }
+                else {
+                    std::istringstream iss( sElem );
+                    iss >> TVal;
+                    bOk = !iss.fail();
+                }
+            }
+            if( !bOk ) {
+                fprintf( stderr, "ERROR deserialising vector element %zu, ignoring \"%.*s\" value.\n",
+                         vT.size(), (int)( p - pToken ), pToken );
+                continue;
+            }
+            vT.push_back( TVal );
+        }
+    }
+
     // All types you wish to use with CVars must overload << and >>
     // This is a possible overloading for vectors
     template<class T>
@@ -16,42 +281,49 @@ namespace CVarUtils {
             return stream;
         }
 
-        stream << "[ " << vT[0]; 
-        for( size_t i=1; i<vT.size(); i++ ) {
-            stream << " " << vT[i];
+        if constexpr( IsFastNumber<T>::value ) {
+            // Format into a local buffer written in large blocks.
+            char sBuf[4096];
+            char* p = sBuf;
+            *p++ = '[';
+            for( size_t i=0; i<vT.size(); i++ ) {
+                if( sBuf + sizeof( sBuf ) - p < CVAR_NUMBER_MAX_CHARS + 1 ) {
+                    stream.write( sBuf, p - sBuf );
+                    p = sBuf;
+                }
+                *p++ = ' ';
+                p = FormatNumber<T>( p, vT[i] );
+            }
+            stream.write( sBuf, p - sBuf );
+            stream << " ]";
+        }
+        else if constexpr( std::is_same<T,std::string>::value ) {
+            std::string sOut = "[";
+            for( size_t i=0; i<vT.size(); i++ ) {
+                sOut += ' ';
+                AppendVectorString( sOut, vT[i] );
+            }
+            sOut += " ]";
+            stream.write( sOut.data(), sOut.size() );
+        }
+        else {
+            stream << "[ " << vT[0];
+            for( size_t i=1; i<vT.size(); i++ ) {
+                stream << " " << vT[i];
+            }
+            stream << " ]";
         }
-        stream << " ]";
-        
+
         return stream;
     }
 
 
     template<class T>
         std::istream &operator>>(std::istream &stream, std::vector<T>& vT ) {
-
-        std::string sBuf; // Have a buffer string
-  
-        vT.clear();
-        
-        // Only works for splitting with whitespaces
-        while( stream >> sBuf ) {
-            if( sBuf.find( "[" ) == std::string::npos &&
-                sBuf.find( "]" ) == std::string::npos ) {
-                
-                T TVal;
-                std::stringstream( sBuf ) >> TVal;
-                std::stringstream sCheck;
-                sCheck << TVal;
-                if( sBuf != sCheck.str() ) {
-                    printf( "ERROR deserialising vector, ignoring \"%s\" value.\n" , 
-                            sBuf.c_str() );
-                    continue;
-                }
-
-                vT.push_back( TVal );
-            }
-        }
-        
+        std::string sBuf( (std::istreambuf_iterator<char>( stream )),
+                          std::istreambuf_iterator<char>() );
+        stream.setstate( std::ios::eofbit );
+        ParseVector( sBuf.data(), sBuf.data() + sBuf.size(), vT );
         return stream;
     }
 }
@@ -14,8 +14,11 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <stdint.h>
 
 #include <cvars/CVar.h>
+#include <cvars/CVarValueIO.h>
 
 class TrieNode;
 
@@ -77,9 +80,56 @@ namespace CVarUtils {
 enum CVARS_STREAM_TYPE
   {
     CVARS_XML_STREAM,
-    CVARS_TXT_STREAM
+    CVARS_TXT_STREAM,
+    CVARS_BINARY_STREAM, ///< memory mappable snapshot, see CVarBinaryIO.h
+    CVARS_JSON_STREAM    ///< namespaces as nested objects, see CVarJSONIO.cpp
   };
 
+// A value loaded for a CVar that was not created yet (see SetPendingValue).
+struct CVarPendingValue
+{
+    uint32_t    m_nTypeId;
+    std::string m_sValue;
+};
+
+// Whether Load skips a file that did not change since it was last saved or
+// loaded (see CVarFileState.cpp).
+enum CVARS_UNCHANGED_LOADS
+  {
+    CVARS_ALWAYS_LOAD,        ///< default
+    CVARS_SKIP_SAME_CONTENT,  ///< skip if the size and content hash match
+    CVARS_SKIP_SAME_MTIME     ///< as above, trusting a matching size and mtime without hashing
+  };
+
+// Size, modification time (ns on Linux, s elsewhere) and content hash of a
+// file, size -1 if missing.
+struct CVarFileStamp
+{
+    int64_t  m_nSize;
+    int64_t  m_nMTime;
+    uint64_t m_nHash;
+};
+
+// State of a file, and of its delta, when last saved or loaded.
+struct CVarFileRecord
+{
+    CVarFileStamp     m_File;
+    CVarFileStamp     m_Delta;
+    CVARS_STREAM_TYPE m_StreamType;
+    std::vector< std::string > m_vFilters;
+    uint64_t          m_nChangeCount; // Trie::m_nChangeCount after the save/load
+    size_t            m_nCVars;
+    uint64_t          m_nValuesHash;  // of the CVar values after the save/load
+};
+
+// Values of the CVars (indexed as GetAllCVars) when a file was last saved or
+// loaded, compared against by SaveDelta (see CVarDelta.cpp).
+struct CVarDeltaBase
+{
+    std::vector< std::string > m_vFilters;
+    std::vector< std::string > m_vStates;
+};
+
 class Trie
 {
  public:
@@ -88,18 +138,34 @@ class Trie
     void Init();
     // add string to tree and store data at leaf
     void         Insert( std::string s, void *data );
+    // walk (creating nodes as needed) the path s below pFrom and return its
+    // last node, used to share a common prefix between many insertions
+    TrieNode*    InsertPath( TrieNode* pFrom, const std::string& s );
+    // add a leaf holding data below pNode, sFullName is the complete CVar name
+    void         InsertLeaf( TrieNode* pNode, const std::string& sFullName, void *data );
+    // finds the node (never a leaf) for path s below pFrom, null if none
+    TrieNode*    FindPath( TrieNode* pFrom, const std::string& s );
+    // finds the leaf for path s below pFrom, returns null otherwise
+    TrieNode*    FindFrom( TrieNode* pFrom, const std::string& s );
     // finds s in the tree and returns the node (may not be a leaf)
     // returns null otherwise
     TrieNode*    FindSubStr( const std::string& s );
     std::vector<std::string> FindListSubStr( const std::string& s );
     TrieNode*    Find( const std::string& s );
     void*        FindData( const std::string& s );
+    // finds the data of the CVar named sName (nLength characters) from the
+    // HashCVarName of the name, null if there is no such CVar
+    void*        FindDataByHash( uint64_t nHash, const char* sName, size_t nLength );
 
     bool         Exists( const std::string& s );
 
     TrieNode*    GetRoot();
     void         SetAcceptedSubstrings( std::vector< std::string > vAcceptedSubstrings );
-    bool         IsNameAcceptable( const std::string& sVarName );
+    bool         IsNameAcceptable( const std::string& sVarName ) const;
+    bool         IsNameAcceptable( const char* sVarName, size_t nLength ) const;
+    // the CVars passing the filters, only visiting the subtrees of the
+    // accepted prefixes when there are some
+    void         CollectAcceptedCVars( std::vector<void*>& vCVars );
     bool         IsVerbose();
     void         SetVerbose( bool bVerbose );
 
@@ -108,12 +174,78 @@ class Trie
     std::vector<std::string> CollectAllNames( TrieNode* node );
     // traverse from the supplied node and return a list of all nodes
     std::vector<TrieNode*>   CollectAllNodes( TrieNode* node );
+    // all the CVars, in creation order (no traversal)
+    const std::vector<void*>& GetAllCVars() { return m_vCVarData; }
 
     CVARS_STREAM_TYPE GetStreamType() { return m_StreamType; }
     void SetStreamType( const CVARS_STREAM_TYPE& streamType ) { m_StreamType = streamType; }
 
+    CVARS_ARRAY_ENCODING GetArrayEncoding() { return m_ArrayEncoding; }
+    size_t GetArrayEncodingMinElements() { return m_nArrayEncodingMinElements; }
+    void SetArrayEncoding( const CVARS_ARRAY_ENCODING& encoding, size_t nMinElements ) {
+        m_ArrayEncoding = encoding;
+        m_nArrayEncodingMinElements = nMinElements;
+    }
+
+    // Values loaded for CVars that do not exist yet, applied by InsertLeaf
+    // when the CVar is created: nTypeId is the binary snapshot type id of
+    // the value, CVARS_BINARY_TEXT for text.
+    void SetPendingValue( const std::string& sName, uint32_t nTypeId, const char* pValue, size_t nBytes );
+    // Text values from environment variables (see ApplyEnvironment) for CVars
+    // not created yet, by EnvironmentName of the CVar name.
+    void SetPendingEnvironmentValue( const std::string& sEnvironmentName, const std::string& sValue );
+    // Text values from the program arguments (see ApplyArgs) for CVars not
+    // created yet, by CVar name; a later Load does not replace them.
+    void SetPendingArgValue( const std::string& sName, const std::string& sValue );
+    // Drops the values kept for sName, true if there were any.
+    bool ErasePendingValues( const std::string& sName );
+    void ClearPendingValues() {
+        std::unordered_map< std::string, CVarPendingValue >().swap( m_mPendingValues );
+        std::unordered_map< std::string, std::string >().swap( m_mPendingEnvironmentValues );
+        std::unordered_map< std::string, std::string >().swap( m_mPendingArgValues );
+    }
+    size_t GetNumPendingValues() {
+        return m_mPendingValues.size() + m_mPendingEnvironmentValues.size() + m_mPendingArgValues.size();
+    }
+    const std::unordered_map< std::string, CVarPendingValue >& GetPendingValues() { return m_mPendingValues; }
+
+    CVARS_UNCHANGED_LOADS GetUnchangedLoads() { return m_UnchangedLoads; }
+    void SetUnchangedLoads( const CVARS_UNCHANGED_LOADS& unchangedLoads ) { m_UnchangedLoads = unchangedLoads; }
+
+    // whether XML and TXT saves group the CVars by dot separated namespace
+    bool GetGroupedNames() { return m_bGroupedNames; }
+    void SetGroupedNames( bool bGrouped ) { m_bGroupedNames = bGrouped; }
+
+    // number of threads parsing large TXT loads, 0 for one per core
+    unsigned int GetLoadThreads() { return m_nLoadThreads; }
+    void SetLoadThreads( unsigned int nThreads ) { m_nLoadThreads = nThreads; }
+
     // CVar
     int*   m_pVerboseCVarNamePaddingWidth;
+    // "console.CVarIndent" and "console.CVarIndentIncr", XML output indentation
+    int*   m_pCVarIndent;
+    int*   m_pCVarIndentIncr;
+
+    // The delta bases by file name, only kept for the files SaveDelta has
+    // been used with.
+    std::unordered_map< std::string, CVarDeltaBase > m_mDeltaBases;
+
+    // Counts the CVar changes notified through NotifyCVarChanged, and the
+    // files last saved or loaded by path (see SetUnchangedLoads).
+    uint64_t m_nChangeCount;
+    std::unordered_map< std::string, CVarFileRecord > m_mFileRecords;
+
+    // while set NotifyCVarChanged does nothing, the caller notifies the CVars
+    // that changed afterwards (see ApplyWatchedFiles)
+    bool m_bHoldNotifications;
+
+    // changes are appended to the journal (see OpenJournal)
+    bool m_bJournaling;
+
+    // while set NotifyCVarChanged, even holding notifications, appends the
+    // CVars it is called for, and values for CVars not created yet are
+    // dropped instead of kept pending (see RegisterPreset)
+    std::vector< void* >* m_pChangeLog;
 
     // To avoid memory leaks, CVars should be created using the memory holder
     CVarUtils::MemoryHolder mem;
@@ -122,13 +254,127 @@ class Trie
     TrieNode* root;
     std::vector< std::string > m_vAcceptedSubstrings;
     std::vector< std::string > m_vNotAcceptedSubstrings;
+    // the filter prefixes as a trie, node 0 is the root
+    struct FilterNode {
+        FilterNode() : m_bAccept( false ), m_bReject( false ) {}
+        std::vector< std::pair<char,int> > m_vChildren;
+        bool m_bAccept;
+        bool m_bReject;
+    };
+    std::vector< FilterNode > m_vFilterNodes;
+    int AddFilterPrefix( const std::string& sPrefix );
+    int FindFilterChild( int nNode, char c ) const;
     std::vector< std::string > m_vCVarNames; // Keep a list of CVar names
+    std::vector< void* > m_vCVarData; // and of the CVars
+    std::unordered_map< uint64_t, void* > m_mNameHashIndex; // CVar data by HashCVarName
+    std::unordered_map< std::string, CVarPendingValue > m_mPendingValues; // by CVar name
+    std::unordered_map< std::string, std::string > m_mPendingEnvironmentValues;
+    std::unordered_map< std::string, std::string > m_mPendingArgValues; // by CVar name
     bool m_bVerbose;
     CVARS_STREAM_TYPE m_StreamType;
+    CVARS_ARRAY_ENCODING m_ArrayEncoding;
+    size_t m_nArrayEncodingMinElements;
+    unsigned int m_nLoadThreads;
+    bool m_bGroupedNames;
+    CVARS_UNCHANGED_LOADS m_UnchangedLoads;
 };
 
 std::ostream &operator<<(std::ostream &stream, Trie &rTrie );
 std::istream &operator>>(std::istream &stream, Trie &rTrie );
 
+////////////////////////////////////////////////////////////////////////////////
+// The CVars to save with their values: the values themselves, or copies
+// (CVar::CloneValue) when the set is written on another thread (SaveAsync).
+// Along with the output settings, so writing does not read the Trie.
+struct CVarSaveSet
+{
+    CVarSaveSet();
+    ~CVarSaveSet(); // releases the copies
+
+    std::vector< void* > m_vCVars;
+    std::vector< void* > m_vValues;
+    CVARS_STREAM_TYPE m_StreamType;
+    CVARS_ARRAY_ENCODING m_ArrayEncoding;
+    size_t m_nArrayEncodingMinElements;
+    int  m_nIndent;
+    int  m_nIndentIncr;
+    int  m_nVerbosePaddingWidth;
+    bool m_bVerbose;
+    bool m_bCopies;
+    bool m_bGroupedNames;
+
+ private:
+    CVarSaveSet( const CVarSaveSet& );
+    CVarSaveSet& operator=( const CVarSaveSet& );
+};
+
+// selects the serialisable CVars accepted by the filters of rTrie
+void CollectSaveSet( Trie &rTrie, bool bCopyValues, CVarSaveSet &saveSet );
+// writes saveSet in its stream type, what operator<< does for the Trie
+std::ostream &WriteSaveSet( std::ostream &stream, const CVarSaveSet &saveSet );
+
+// Binary snapshots (CVARS_BINARY_STREAM), implemented in CVarBinaryIO.cpp.
+std::ostream &SaveSetToBinary( std::ostream &stream, const CVarSaveSet &saveSet );
+bool ApplyBinarySnapshot( const char* pData, size_t nBytes, Trie &rTrie );
+// maps sFileName in memory (where supported) and applies it
+bool LoadBinarySnapshot( const std::string& sFileName, Trie &rTrie );
+
+// TXT settings (CVARS_TXT_STREAM) held in memory, implemented in
+// CVarTXTLoad.cpp: parsed on up to GetLoadThreads() threads, then applied in
+// file order on the calling thread.
+bool ApplyTXTBuffer( const char* pData, size_t nBytes, Trie &rTrie );
+// maps sFileName in memory (where supported) and applies it
+bool LoadTXTFile( const std::string& sFileName, Trie &rTrie );
+
+// JSON settings (CVARS_JSON_STREAM), implemented in CVarJSONIO.cpp.
+std::ostream &SaveSetToJSON( std::ostream &stream, const CVarSaveSet &saveSet );
+bool ApplyJSONBuffer( const char* pData, size_t nBytes, Trie &rTrie );
+// maps sFileName in memory (where supported) and applies it
+bool LoadJSONFile( const std::string& sFileName, Trie &rTrie );
+
+// Maps sFileName read-only in memory (reads it on Windows) and passes its
+// content to pApply, false if the file cannot be opened.  Lives in Trie.cpp.
+bool ApplyMappedFile( const std::string& sFileName, Trie &rTrie,
+                      bool (*pApply)( const char*, size_t, Trie& ) );
+
+// Unchanged file detection, implemented in CVarFileState.cpp.
+// records the state of sFileName after a Save/Load with vFilters
+void RecordFileState( const std::string& sFileName, const std::vector<std::string>& vFilters, Trie &rTrie );
+// true if neither sFileName nor the CVars changed since it was recorded
+bool IsFileUnchanged( const std::string& sFileName, const std::vector<std::string>& vFilters, Trie &rTrie );
+
+// Journal mode, implemented in CVarJournal.cpp.
+// appends the value of pCVar (a CVar<T>*) to the journal
+void AppendToJournal( void* pCVar );
+// Between BeginJournalBatch and EndJournalBatch (they nest) the journal is
+// neither flushed nor compacted, both happen once in the last
+// EndJournalBatch: a Load then costs one flush, and no compaction changes
+// the filters of the Trie under it.
+void BeginJournalBatch();
+void EndJournalBatch();
+
+// a journal batch for the lifetime of the object
+struct CVarJournalBatch
+{
+    CVarJournalBatch() { BeginJournalBatch(); }
+    ~CVarJournalBatch() { EndJournalBatch(); }
+};
+
+// Overrides from the command line and the environment, implemented in
+// CVarOverrides.cpp.
+// the name of the environment variable (after the prefix) overriding the
+// CVar sCVarName: upper case, '.' replaced by '_'
+std::string EnvironmentName( const std::string& sCVarName );
+
+// Delta saves, implemented in CVarDelta.cpp.
+#define CVARS_DELTA_SUFFIX ".delta"
+// records the current values as the base SaveDelta compares against for
+// sFileName, if SaveDelta is used with it
+void RecordDeltaBase( const std::string& sFileName, const std::vector<std::string>& vFilters, Trie &rTrie );
+// comparable state of the value of pCVar (a CVar<T>*), to detect changes
+void GetCVarValueState( void* pCVar, std::string& sState );
+// applies "sFileName.delta" if it exists
+bool LoadDelta( const std::string& sFileName, Trie &rTrie );
+
 
 #endif
@@ -0,0 +1,153 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+#ifndef _XML_CVAR_READER_H_
+#define _XML_CVAR_READER_H_
+
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+// Streaming reader for the XML CVars document.  The input is read in chunks and
+// each element directly below the root element is returned as soon as it is
+// closed, so memory use is bounded by the largest value rather than the file.
+// Comments, processing instructions (<?xml ... ?>), DOCTYPE and CDATA sections
+// are handled; values containing elements are returned as raw markup.
+// Implemented in XMLCVarReader.cpp.
+class XMLCVarReader
+{
+public:
+    XMLCVarReader( std::istream& stream )
+        : m_Stream( stream ), m_nPos( 0 ), m_nEnd( 0 ), m_nDepth( 0 ),
+          m_bFoundRoot( false ), m_bError( false ) {}
+
+    // Next CVar element, returns false at the end of the document.  sName is
+    // the full name, its first GroupLength() characters are the namespace
+    // elements it is in.
+    bool Next( std::string& sName, std::string& sValue );
+
+    size_t GroupLength() const { return m_sGroup.size(); }
+    bool FoundRoot() const { return m_bFoundRoot; }
+    bool Error() const { return m_bError; }
+
+private:
+    bool Fill() {
+        if( !m_Stream.good() ) {
+            return false;
+        }
+        m_Stream.read( m_sChunk, sizeof( m_sChunk ) );
+        m_nEnd = m_Stream.gcount();
+        m_nPos = 0;
+        return m_nEnd > 0;
+    }
+
+    int Get() {
+        if( m_nPos == m_nEnd && !Fill() ) {
+            return EOF;
+        }
+        return (unsigned char)m_sChunk[ m_nPos++ ];
+    }
+
+    // Appends (if pOut) the text up to the next '<', which is consumed.
+    bool ReadText( std::string* pOut ) {
+        while( true ) {
+            if( m_nPos == m_nEnd && !Fill() ) {
+                return false;
+            }
+            const char* pBegin = m_sChunk + m_nPos;
+            const char* pLt = (const char*)memchr( pBegin, '<', m_nEnd - m_nPos );
+            const size_t nLen = ( pLt ? pLt : m_sChunk + m_nEnd ) - pBegin;
+            if( pOut ) {
+                pOut->append( pBegin, nLen );
+            }
+            m_nPos += nLen;
+            if( pLt ) {
+                m_nPos++;
+                return true;
+            }
+        }
+    }
+
+    // Consumes input up to and including sEnd, appending what precedes it to
+    // pOut if not null.
+    bool SkipPast( const char* sEnd, std::string* pOut ) {
+        const size_t nEndLen = strlen( sEnd );
+        std::string sSkipped;
+        std::string& s = pOut ? *pOut : sSkipped;
+        const size_t nStart = s.size();
+        int c;
+        while( ( c = Get() ) != EOF ) {
+            s += (char)c;
+            if( s.size() - nStart >= nEndLen &&
+                s.compare( s.size() - nEndLen, nEndLen, sEnd ) == 0 ) {
+                s.resize( s.size() - nEndLen );
+                return true;
+            }
+            if( !pOut && sSkipped.size() > 64 ) {
+                sSkipped.erase( 0, sSkipped.size() - nEndLen );
+            }
+        }
+        return false;
+    }
+
+    // Reads a tag after "<" up to and including ">", sets its name, whether it
+    // is an end tag and whether it is self-closing.
+    bool ReadTag( int c, std::string& sTag, std::string& sTagName, bool& bEndTag, bool& bEmptyTag ) {
+        sTag = "<";
+        sTagName.clear();
+        bEndTag = ( c == '/' );
+        bEmptyTag = false;
+        bool bInName = true;
+        char cQuote = 0;
+        for( ; c != EOF; c = Get() ) {
+            sTag += (char)c;
+            if( cQuote ) {
+                if( c == cQuote ) {
+                    cQuote = 0;
+                }
+                continue;
+            }
+            if( c == '>' ) {
+                bEmptyTag = sTag.size() > 2 && sTag[ sTag.size()-2 ] == '/';
+                return true;
+            }
+            if( c == '"' || c == '\'' ) {
+                cQuote = (char)c;
+            }
+            if( bInName ) {
+                if( c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '/' ) {
+                    bInName = sTagName.empty() && c == '/';
+                }
+                else {
+                    sTagName += (char)c;
+                }
+            }
+        }
+        return false;
+    }
+
+    std::istream& m_Stream;
+    char          m_sChunk[65536];
+    size_t        m_nPos;
+    size_t        m_nEnd;
+    int           m_nDepth; // 1 inside the root element, 2 inside a CVar
+    std::string   m_sGroup; // namespace elements around the current level
+    std::vector<size_t> m_vGroupStarts;
+    bool          m_bFoundRoot;
+    bool          m_bError;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Appends s to sOut with the characters that cannot appear in XML text
+// ('&', '<' and '>') replaced by entities.
+void AppendXMLText( std::string& sOut, const char* s, size_t nLength );
+
+#endif
@@ -1,5 +1,7 @@
 #include <cvars/CVar.h>
+#include <cvars/CVarExpression.h>
 #include <memory>
+#include <unordered_set>
 
 namespace CVarUtils
 {
@@ -19,4 +21,92 @@ Trie& TrieInstance()
     return context.trie;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Counts and journals a notified change.
+static void RecordChange( Trie& trie, void* pCVar )
+{
+    trie.m_nChangeCount++;
+    if( trie.m_bJournaling ) {
+        AppendToJournal( pCVar );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Appends to vOrder the derived CVars reachable from pCVar that are not in
+// sVisited yet, each after all the derived CVars reading it (depth first
+// post-order), so vOrder read backwards is a topological order.
+static void CollectDerivedCVars( void* pCVar, std::unordered_set<void*>& sVisited,
+                                 std::vector<void*>& vOrder )
+{
+    std::vector< std::pair<CVar<int>*, size_t> > vStack( 1, std::make_pair( (CVar<int>*)pCVar, (size_t)0 ) );
+    while( !vStack.empty() ) {
+        CVar<int>* pTop = vStack.back().first;
+        const size_t nNext = vStack.back().second++;
+        if( nNext == pTop->m_vDependents.size() ) {
+            if( vStack.size() > 1 ) {
+                vOrder.push_back( pTop );
+            }
+            vStack.pop_back();
+            continue;
+        }
+        void* pDerived = pTop->m_vDependents[nNext]->m_pCVar;
+        if( sVisited.insert( pDerived ).second ) {
+            vStack.push_back( std::make_pair( (CVar<int>*)pDerived, (size_t)0 ) );
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NotifyCVarsChanged( void* const* ppCVars, size_t nCVars )
+{
+    Trie& trie = TrieInstance();
+    if( trie.m_pChangeLog != NULL ) {
+        trie.m_pChangeLog->insert( trie.m_pChangeLog->end(), ppCVars, ppCVars + nCVars );
+    }
+    if( trie.m_bHoldNotifications ) {
+        return;
+    }
+    bool bDependents = false;
+    for( size_t ii = 0; ii < nCVars; ii++ ) {
+        RecordChange( trie, ppCVars[ii] );
+        bDependents |= !((CVar<int>*)ppCVars[ii])->m_vDependents.empty();
+    }
+    if( !bDependents ) {
+        return;
+    }
+
+    // derived CVars are recomputed right away, so references to them stay up
+    // to date: each once, after all of its inputs, then they are notified
+    std::unordered_set<void*> sVisited;
+    std::vector<void*> vOrder;
+    for( size_t ii = 0; ii < nCVars; ii++ ) {
+        CollectDerivedCVars( ppCVars[ii], sVisited, vOrder );
+    }
+    for( size_t ii = vOrder.size(); ii-- > 0; ) {
+        RefreshDerivedCVar( vOrder[ii] );
+    }
+    if( trie.m_pChangeLog != NULL ) {
+        trie.m_pChangeLog->insert( trie.m_pChangeLog->end(), vOrder.rbegin(), vOrder.rend() );
+    }
+    for( size_t ii = vOrder.size(); ii-- > 0; ) {
+        RecordChange( trie, vOrder[ii] );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NotifyCVarChanged( void* pCVar )
+{
+    NotifyCVarsChanged( &pCVar, 1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NotifyChanged( const std::string& s )
+{
+    TrieNode* pNode = TrieInstance().Find( s );
+    if( pNode == NULL ) {
+        throw CVarNonExistant;
+    }
+    NotifyCVarChanged( pNode->m_pNodeData );
+}
+
 }
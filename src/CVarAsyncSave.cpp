@@ -0,0 +1,200 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Background saves: SaveAsync copies the values on the calling thread and a
+// worker thread formats and writes them, one request at a time in order.
+
+#include <cvars/config.h>
+#include <cvars/CVar.h>
+#include <cvars/Trie.h>
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <cstdio>
+
+using namespace CVarUtils;
+
+////////////////////////////////////////////////////////////////////////////////
+struct CVarSaveRequest
+{
+    std::string                                     m_sFileName;
+    std::unique_ptr<CVarSaveSet>                    m_pSaveSet;
+    std::promise<bool>                              m_Promise;
+    std::function<void( bool, const std::string& )> m_Callback;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes saveSet to "sFileName.tmp" and renames it over sFileName, so readers
+// only ever see a complete file.
+static bool WriteSaveSetToFile( const std::string& sFileName, const CVarSaveSet &saveSet,
+                                std::string& sError )
+{
+    const std::string sTmpFileName = sFileName + ".tmp";
+    std::ofstream sOut( sTmpFileName.c_str(), saveSet.m_StreamType == CVARS_BINARY_STREAM ?
+                        std::ios::out | std::ios::binary : std::ios::out );
+    if( !sOut.is_open() ) {
+        sError = "could not open \"" + sTmpFileName + "\"";
+        return false;
+    }
+    WriteSaveSet( sOut, saveSet );
+    sOut.close();
+    if( !sOut ) {
+        std::remove( sTmpFileName.c_str() );
+        sError = "could not write \"" + sTmpFileName + "\"";
+        return false;
+    }
+#ifdef _WIN_
+    // rename does not replace an existing file on Windows
+    std::remove( sFileName.c_str() );
+#endif
+    if( std::rename( sTmpFileName.c_str(), sFileName.c_str() ) != 0 ) {
+        std::remove( sTmpFileName.c_str() );
+        sError = "could not replace \"" + sFileName + "\"";
+        return false;
+    }
+    // a full save supersedes any delta saved for this file
+    std::remove( ( sFileName + CVARS_DELTA_SUFFIX ).c_str() );
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The background thread and its queue of requests.  The thread is started by
+// the first request and joined, once the queue is empty, at exit.
+class CVarSaveWorker
+{
+public:
+    CVarSaveWorker() : m_bBusy( false ), m_bStop( false ) {}
+
+    ~CVarSaveWorker() {
+        {
+            std::lock_guard<std::mutex> lock( m_Mutex );
+            m_bStop = true;
+        }
+        m_QueueCond.notify_all();
+        if( m_Thread.joinable() ) {
+            m_Thread.join();
+        }
+    }
+
+    void Push( CVarSaveRequest* pRequest ) {
+        {
+            std::lock_guard<std::mutex> lock( m_Mutex );
+            m_vQueue.push_back( std::unique_ptr<CVarSaveRequest>( pRequest ) );
+            if( !m_Thread.joinable() ) {
+                m_Thread = std::thread( &CVarSaveWorker::Run, this );
+            }
+        }
+        m_QueueCond.notify_one();
+    }
+
+    void WaitIdle() {
+        std::unique_lock<std::mutex> lock( m_Mutex );
+        m_IdleCond.wait( lock, [this] { return m_vQueue.empty() && !m_bBusy; } );
+    }
+
+private:
+    void Run() {
+        std::unique_lock<std::mutex> lock( m_Mutex );
+        for( ;; ) {
+            m_QueueCond.wait( lock, [this] { return m_bStop || !m_vQueue.empty(); } );
+            if( m_vQueue.empty() ) {
+                return;
+            }
+            std::unique_ptr<CVarSaveRequest> pRequest( std::move( m_vQueue.front() ) );
+            m_vQueue.pop_front();
+            m_bBusy = true;
+            lock.unlock();
+
+            Process( *pRequest );
+            pRequest.reset();
+
+            lock.lock();
+            m_bBusy = false;
+            if( m_vQueue.empty() ) {
+                m_IdleCond.notify_all();
+            }
+        }
+    }
+
+    static void Process( CVarSaveRequest& request ) {
+        std::string sError;
+        bool bRes = false;
+        try {
+            bRes = WriteSaveSetToFile( request.m_sFileName, *request.m_pSaveSet, sError );
+        }
+        catch( const std::exception& e ) {
+            sError = e.what();
+        }
+        catch( ... ) {
+            sError = "unknown exception";
+        }
+        if( !bRes ) {
+            std::cerr << "ERROR saving CVars to \"" << request.m_sFileName << "\": " << sError << "." << std::endl;
+        }
+        // the copies are released before anyone is told the save completed
+        request.m_pSaveSet.reset();
+        if( request.m_Callback ) {
+            request.m_Callback( bRes, sError );
+        }
+        request.m_Promise.set_value( bRes );
+    }
+
+    std::mutex                                    m_Mutex;
+    std::condition_variable                       m_QueueCond;
+    std::condition_variable                       m_IdleCond;
+    std::deque< std::unique_ptr<CVarSaveRequest> > m_vQueue;
+    std::thread                                   m_Thread;
+    bool                                          m_bBusy;
+    bool                                          m_bStop;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Created after the Trie so it is destroyed, and pending saves written, before
+// the CVars go away.
+static CVarSaveWorker& SaveWorkerInstance()
+{
+    static CVarSaveWorker worker;
+    return worker;
+}
+
+namespace CVarUtils
+{
+    ////////////////////////////////////////////////////////////////////////////////
+    std::future<bool> SaveAsync( const std::string& sFileName,
+                                 std::vector<std::string> vAcceptedSubstrings,
+                                 std::function<void( bool, const std::string& )> callback )
+    {
+        Trie& trie = TrieInstance();
+        CVarSaveRequest* pRequest = new CVarSaveRequest;
+        pRequest->m_sFileName = sFileName;
+        pRequest->m_Callback = callback;
+        pRequest->m_pSaveSet.reset( new CVarSaveSet );
+
+        trie.SetVerbose( false );
+        trie.SetAcceptedSubstrings( vAcceptedSubstrings );
+        CollectSaveSet( trie, true, *pRequest->m_pSaveSet );
+        // the values being written are the base of this file only
+        RecordDeltaBase( sFileName, vAcceptedSubstrings, trie );
+        // the file is only known once written, the next Load reads it
+        trie.m_mFileRecords.erase( sFileName );
+
+        std::future<bool> result = pRequest->m_Promise.get_future();
+        SaveWorkerInstance().Push( pRequest );
+        return result;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void WaitForAsyncSaves()
+    {
+        SaveWorkerInstance().WaitIdle();
+    }
+}
@@ -0,0 +1,175 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Binary snapshots of the CVars (CVARS_BINARY_STREAM).
+
+#include <cvars/config.h>
+#include <cvars/CVar.h>
+#include <cvars/CVarBinaryIO.h>
+#include <cvars/Trie.h>
+#include <cvars/TrieNode.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace CVarUtils;
+
+////////////////////////////////////////////////////////////////////////////////
+static bool CompareEntryHash( const CVarBinaryEntry& a, const CVarBinaryEntry& b )
+{
+    return a.m_nNameHash < b.m_nNameHash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::ostream &SaveSetToBinary( std::ostream &stream, const CVarSaveSet &saveSet )
+{
+    std::vector<CVarBinaryEntry> vEntries;
+    vEntries.reserve( saveSet.m_vCVars.size() );
+
+    // Names and values, offsets are fixed up once the table size is known.
+    std::string sBlob;
+    for( size_t ii = 0; ii < saveSet.m_vCVars.size(); ii++ ) {
+        CVar<int>* pCVar = (CVar<int>*)saveSet.m_vCVars[ii];
+        void* pValue = saveSet.m_vValues[ii];
+        const std::string& sCVarName = pCVar->m_sVarName;
+
+        CVarBinaryEntry entry;
+        entry.m_nNameHash = HashCVarName( sCVarName );
+        entry.m_nNameOffset = (uint32_t)sBlob.size();
+        entry.m_nNameLength = (uint32_t)sCVarName.size();
+        sBlob += sCVarName;
+        sBlob.resize( ( sBlob.size() + 7 ) & ~(size_t)7, '\0' );
+        entry.m_nValueOffset = sBlob.size();
+        entry.m_nTypeId = pCVar->FormatValueAsBinary( pValue, sBlob );
+        if( entry.m_nTypeId == CVARS_BINARY_TEXT ) {
+            const std::string sVal = pCVar->FormatValue( pValue );
+            if( sVal.empty() ) {
+                sBlob.resize( entry.m_nNameOffset );
+                continue;
+            }
+            sBlob += sVal;
+        }
+        entry.m_nValueLength = (uint32_t)( sBlob.size() - entry.m_nValueOffset );
+        if( saveSet.m_bVerbose ) {
+            printf( "Saving \"%-*s\" (%u bytes, type 0x%x).\n", saveSet.m_nVerbosePaddingWidth,
+                    sCVarName.c_str(), entry.m_nValueLength, entry.m_nTypeId );
+        }
+        vEntries.push_back( entry );
+    }
+    std::sort( vEntries.begin(), vEntries.end(), CompareEntryHash );
+
+    const size_t nBlobOffset = sizeof( CVarBinaryHeader ) + vEntries.size() * sizeof( CVarBinaryEntry );
+    for( size_t ii = 0; ii < vEntries.size(); ii++ ) {
+        vEntries[ii].m_nNameOffset += (uint32_t)nBlobOffset;
+        vEntries[ii].m_nValueOffset += nBlobOffset;
+    }
+
+    CVarBinaryHeader header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.m_sMagic, CVARS_BINARY_MAGIC, sizeof( header.m_sMagic ) );
+    header.m_nVersion = CVARS_BINARY_VERSION;
+    header.m_nByteOrder = CVARS_BINARY_BYTE_ORDER;
+    header.m_nEntries = (uint32_t)vEntries.size();
+    header.m_nFileSize = nBlobOffset + sBlob.size();
+
+    stream.write( (const char*)&header, sizeof( header ) );
+    if( !vEntries.empty() ) {
+        stream.write( (const char*)vEntries.data(), vEntries.size() * sizeof( CVarBinaryEntry ) );
+    }
+    stream.write( sBlob.data(), sBlob.size() );
+    return stream;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ApplyBinarySnapshot( const char* pData, size_t nBytes, Trie &rTrie )
+{
+    CVarBinaryHeader header;
+    if( nBytes < sizeof( header ) ) {
+        std::cerr << "ERROR: invalid CVars binary snapshot (too short)." << std::endl;
+        return false;
+    }
+    memcpy( &header, pData, sizeof( header ) );
+    if( memcmp( header.m_sMagic, CVARS_BINARY_MAGIC, sizeof( header.m_sMagic ) ) != 0 ) {
+        std::cerr << "ERROR: not a CVars binary snapshot." << std::endl;
+        return false;
+    }
+    if( header.m_nVersion != CVARS_BINARY_VERSION ) {
+        std::cerr << "ERROR: unsupported CVars binary snapshot version " << header.m_nVersion << "." << std::endl;
+        return false;
+    }
+    if( header.m_nByteOrder != CVARS_BINARY_BYTE_ORDER ) {
+        std::cerr << "ERROR: CVars binary snapshot saved with another byte order." << std::endl;
+        return false;
+    }
+    if( header.m_nFileSize > nBytes ||
+        header.m_nEntries > ( nBytes - sizeof( header ) ) / sizeof( CVarBinaryEntry ) ) {
+        std::cerr << "ERROR: truncated CVars binary snapshot." << std::endl;
+        return false;
+    }
+
+    const char* pEntries = pData + sizeof( header );
+    for( uint32_t ii = 0; ii < header.m_nEntries; ii++ ) {
+        CVarBinaryEntry entry;
+        memcpy( &entry, pEntries + ii * sizeof( CVarBinaryEntry ), sizeof( entry ) );
+        if( (uint64_t)entry.m_nNameOffset + entry.m_nNameLength > header.m_nFileSize ||
+            entry.m_nValueOffset + entry.m_nValueLength > header.m_nFileSize ) {
+            std::cerr << "ERROR: corrupted entry " << ii << " in CVars binary snapshot." << std::endl;
+            return false;
+        }
+        const char* sName = pData + entry.m_nNameOffset;
+        const char* pValue = pData + entry.m_nValueOffset;
+
+        CVar<int>* pCVar = (CVar<int>*)rTrie.FindDataByHash( entry.m_nNameHash, sName, entry.m_nNameLength );
+        if( pCVar == NULL ) {
+            const std::string sCVarName( sName, entry.m_nNameLength );
+            if( !rTrie.IsNameAcceptable( sCVarName ) ) {
+                if( rTrie.IsVerbose() ) {
+                    printf( "NOT loading %s (not in acceptable name list).\n", sCVarName.c_str() );
+                }
+                continue;
+            }
+            if( rTrie.IsVerbose() ) {
+                printf( "Keeping %s until it is created (not in Trie).\n", sCVarName.c_str() );
+            }
+            rTrie.SetPendingValue( sCVarName, entry.m_nTypeId, pValue, entry.m_nValueLength );
+            continue;
+        }
+        if( !rTrie.IsNameAcceptable( pCVar->m_sVarName ) ) {
+            if( rTrie.IsVerbose() ) {
+                printf( "NOT loading %s (not in acceptable name list).\n", pCVar->m_sVarName.c_str() );
+            }
+            continue;
+        }
+        if( pCVar->IsDerived() ) {
+            if( rTrie.IsVerbose() ) {
+                printf( "NOT loading %s (derived, read only).\n", pCVar->m_sVarName.c_str() );
+            }
+            continue;
+        }
+
+        if( entry.m_nTypeId == CVARS_BINARY_TEXT ) {
+            pCVar->SetValueFromString( std::string( pValue, entry.m_nValueLength ) );
+        }
+        else if( !pCVar->SetValueFromBinary( entry.m_nTypeId, pValue, entry.m_nValueLength ) ) {
+            std::cerr << "WARNING: " << pCVar->m_sVarName << " in CVars binary snapshot has type 0x"
+                      << std::hex << entry.m_nTypeId << std::dec << " not matching the CVar, ignoring." << std::endl;
+            continue;
+        }
+        if( rTrie.IsVerbose() ) {
+            printf( "Loading \"%-*s\" (%u bytes, type 0x%x).\n", *rTrie.m_pVerboseCVarNamePaddingWidth,
+                    pCVar->m_sVarName.c_str(), entry.m_nValueLength, entry.m_nTypeId );
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool LoadBinarySnapshot( const std::string& sFileName, Trie &rTrie )
+{
+    return ApplyMappedFile( sFileName, rTrie, ApplyBinarySnapshot );
+}
@@ -0,0 +1,135 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Incremental saves: SaveDelta appends the CVars that changed since the last
+// full Save/Load (or SaveDelta) of the same file, with the same filters, to
+// "<file>.delta".  Load applies that file after the base file and a full Save
+// removes it.
+
+#include <cvars/CVar.h>
+#include <cvars/Trie.h>
+
+#include <fstream>
+#include <cstdio>
+
+using namespace CVarUtils;
+
+////////////////////////////////////////////////////////////////////////////////
+// Comparable state of a CVar value: its binary form, or its text for types
+// without one.  Catches changes made through references as well.
+void GetCVarValueState( void* pVoid, std::string& sState )
+{
+    CVar<int>* pCVar = (CVar<int>*)pVoid;
+    sState.clear();
+    if( pCVar->GetValueAsBinary( sState ) == CVARS_BINARY_TEXT ) {
+        sState = pCVar->GetValueAsString();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RecordDeltaBase( const std::string& sFileName, const std::vector<std::string>& vFilters, Trie &rTrie )
+{
+    std::unordered_map< std::string, CVarDeltaBase >::iterator it = rTrie.m_mDeltaBases.find( sFileName );
+    if( it == rTrie.m_mDeltaBases.end() ) {
+        return;
+    }
+    CVarDeltaBase& base = it->second;
+    base.m_vFilters = vFilters;
+    const std::vector<void*>& vCVars = rTrie.GetAllCVars();
+    base.m_vStates.resize( vCVars.size() );
+    for( size_t ii = 0; ii < vCVars.size(); ii++ ) {
+        CVar<int>* pCVar = (CVar<int>*)vCVars[ii];
+        if( pCVar->m_bSerialise ) {
+            GetCVarValueState( pCVar, base.m_vStates[ii] );
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool LoadDelta( const std::string& sFileName, Trie &rTrie )
+{
+    // deltas are always written as text, whatever the base file format
+    return LoadTXTFile( sFileName + CVARS_DELTA_SUFFIX, rTrie );
+}
+
+namespace CVarUtils
+{
+    ////////////////////////////////////////////////////////////////////////////////
+    bool SaveDelta( const std::string& sFileName, std::vector<std::string> vAcceptedSubstrings )
+    {
+        Trie& trie = TrieInstance();
+        // the base file must be the last requested full save
+        WaitForAsyncSaves();
+        std::ifstream sBase( sFileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate );
+        std::unordered_map< std::string, CVarDeltaBase >::iterator it = trie.m_mDeltaBases.find( sFileName );
+        if( it == trie.m_mDeltaBases.end() || it->second.m_vFilters != vAcceptedSubstrings ||
+            !sBase.is_open() ) {
+            // nothing to compare against yet, Save records the base
+            trie.m_mDeltaBases[ sFileName ];
+            return Save( sFileName, vAcceptedSubstrings );
+        }
+        CVarDeltaBase& base = it->second;
+        const std::streamoff nBaseSize = sBase.tellg();
+        sBase.close();
+
+        trie.SetVerbose( false );
+        trie.SetAcceptedSubstrings( vAcceptedSubstrings );
+
+        // CVars created since the base was recorded compare as changed
+        const std::vector<void*>& vCVars = trie.GetAllCVars();
+        base.m_vStates.resize( vCVars.size() );
+        std::string sDelta, sState;
+        for( size_t ii = 0; ii < vCVars.size(); ii++ ) {
+            CVar<int>* pCVar = (CVar<int>*)vCVars[ii];
+            if( !pCVar->m_bSerialise || !trie.IsNameAcceptable( pCVar->m_sVarName ) ) {
+                continue;
+            }
+            GetCVarValueState( pCVar, sState );
+            std::string& sBaseState = base.m_vStates[ii];
+            if( sState == sBaseState ) {
+                continue;
+            }
+            const std::string sVal = pCVar->GetValueAsString();
+            if( sVal.empty() ) {
+                continue;
+            }
+            if( trie.IsVerbose() ) {
+                printf( "Saving \"%-*s\" with value \"%s\" (changed).\n", *trie.m_pVerboseCVarNamePaddingWidth,
+                        pCVar->m_sVarName.c_str(), sVal.c_str() );
+            }
+            sDelta += pCVar->m_sVarName;
+            sDelta += " = ";
+            sDelta += sVal;
+            sDelta += '\n';
+            sBaseState.swap( sState );
+        }
+        if( sDelta.empty() ) {
+            RecordFileState( sFileName, vAcceptedSubstrings, trie );
+            return true;
+        }
+
+        std::ofstream sOut( ( sFileName + CVARS_DELTA_SUFFIX ).c_str(), std::ios::out | std::ios::app );
+        if( !sOut.is_open() ) {
+            return false;
+        }
+        sOut.write( sDelta.data(), sDelta.size() );
+        const std::streamoff nDeltaSize = sOut.tellp();
+        sOut.close();
+        if( !sOut ) {
+            return false;
+        }
+
+        // Compact into a full save once the delta outgrows half the base file,
+        // which keeps the amortised cost proportional to the changes.
+        if( nDeltaSize > nBaseSize / 2 ) {
+            return Save( sFileName, vAcceptedSubstrings );
+        }
+        RecordFileState( sFileName, vAcceptedSubstrings, trie );
+        return true;
+    }
+}
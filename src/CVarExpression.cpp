@@ -0,0 +1,355 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Compilation and evaluation of derived CVar expressions.
+
+#include <cvars/CVar.h>
+#include <cvars/CVarExpression.h>
+
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace CVarUtils
+{
+    ////////////////////////////////////////////////////////////////////////////////
+    // Recursive descent parser emitting postfix instructions.
+    //   expr    := term ( ('+'|'-') term )*
+    //   term    := unary ( ('*'|'/'|'%') unary )*
+    //   unary   := ('-'|'+') unary | power
+    //   power   := primary ( '^' unary )?
+    //   primary := number | name | name '(' expr ( ',' expr )* ')' | '(' expr ')'
+    class ExpressionParser
+    {
+    public:
+        ExpressionParser( const std::string& sExpression,
+                          std::vector<CVarExpression::Instruction>& vProgram,
+                          std::vector<void*>& vInputs )
+            : m_sExpr( sExpression ), m_nPos( 0 ),
+              m_vProgram( vProgram ), m_vInputs( vInputs ) {}
+
+        bool Parse( std::string& sError ) {
+            if( !_Expr() ) {
+                sError = m_sError;
+                return false;
+            }
+            _SkipSpaces();
+            if( m_nPos != m_sExpr.length() ) {
+                sError = "unexpected '" + m_sExpr.substr( m_nPos, 1 ) + "'";
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        void _SkipSpaces() {
+            while( m_nPos < m_sExpr.length() && isspace( (unsigned char)m_sExpr[m_nPos] ) ) {
+                m_nPos++;
+            }
+        }
+
+        bool _Accept( char c ) {
+            _SkipSpaces();
+            if( m_nPos < m_sExpr.length() && m_sExpr[m_nPos] == c ) {
+                m_nPos++;
+                return true;
+            }
+            return false;
+        }
+
+        bool _Error( const std::string& sError ) {
+            if( m_sError.empty() ) {
+                m_sError = sError;
+            }
+            return false;
+        }
+
+        void _Emit( CVarExpression::OpCode nOp, double dValue = 0, void* pCVar = NULL ) {
+            CVarExpression::Instruction ins = { nOp, dValue, pCVar };
+            m_vProgram.push_back( ins );
+        }
+
+        bool _Expr() {
+            if( !_Term() ) { return false; }
+            while( true ) {
+                if( _Accept( '+' ) ) {
+                    if( !_Term() ) { return false; }
+                    _Emit( CVarExpression::OP_ADD );
+                }
+                else if( _Accept( '-' ) ) {
+                    if( !_Term() ) { return false; }
+                    _Emit( CVarExpression::OP_SUB );
+                }
+                else {
+                    return true;
+                }
+            }
+        }
+
+        bool _Term() {
+            if( !_Unary() ) { return false; }
+            while( true ) {
+                if( _Accept( '*' ) ) {
+                    if( !_Unary() ) { return false; }
+                    _Emit( CVarExpression::OP_MUL );
+                }
+                else if( _Accept( '/' ) ) {
+                    if( !_Unary() ) { return false; }
+                    _Emit( CVarExpression::OP_DIV );
+                }
+                else if( _Accept( '%' ) ) {
+                    if( !_Unary() ) { return false; }
+                    _Emit( CVarExpression::OP_MOD );
+                }
+                else {
+                    return true;
+                }
+            }
+        }
+
+        bool _Unary() {
+            if( _Accept( '-' ) ) {
+                if( !_Unary() ) { return false; }
+                _Emit( CVarExpression::OP_NEG );
+                return true;
+            }
+            if( _Accept( '+' ) ) {
+                return _Unary();
+            }
+            return _Power();
+        }
+
+        bool _Power() {
+            if( !_Primary() ) { return false; }
+            if( _Accept( '^' ) ) {
+                if( !_Unary() ) { return false; }
+                _Emit( CVarExpression::OP_POW );
+            }
+            return true;
+        }
+
+        bool _Primary() {
+            _SkipSpaces();
+            if( m_nPos >= m_sExpr.length() ) {
+                return _Error( "unexpected end of expression" );
+            }
+            const char c = m_sExpr[m_nPos];
+            if( c == '(' ) {
+                m_nPos++;
+                if( !_Expr() ) { return false; }
+                return _Accept( ')' ) || _Error( "missing ')'" );
+            }
+            if( isdigit( (unsigned char)c ) || c == '.' ) {
+                const char* pStart = m_sExpr.c_str() + m_nPos;
+                char* pEnd = NULL;
+                const double dValue = strtod( pStart, &pEnd );
+                if( pEnd == pStart ) {
+                    return _Error( "invalid number" );
+                }
+                m_nPos += pEnd - pStart;
+                _Emit( CVarExpression::OP_CONST, dValue );
+                return true;
+            }
+            if( isalpha( (unsigned char)c ) || c == '_' ) {
+                const size_t nStart = m_nPos;
+                while( m_nPos < m_sExpr.length() &&
+                       ( isalnum( (unsigned char)m_sExpr[m_nPos] ) ||
+                         m_sExpr[m_nPos] == '_' || m_sExpr[m_nPos] == '.' ) ) {
+                    m_nPos++;
+                }
+                const std::string sName = m_sExpr.substr( nStart, m_nPos - nStart );
+                if( _Accept( '(' ) ) {
+                    return _Function( sName );
+                }
+                return _CVar( sName );
+            }
+            return _Error( std::string( "unexpected '" ) + c + "'" );
+        }
+
+        bool _Function( const std::string& sName ) {
+            struct FunctionDef { const char* sName; int nArgs; CVarExpression::OpCode nOp; };
+            static const FunctionDef functions[] = {
+                { "min",   2, CVarExpression::OP_MIN },
+                { "max",   2, CVarExpression::OP_MAX },
+                { "abs",   1, CVarExpression::OP_ABS },
+                { "floor", 1, CVarExpression::OP_FLOOR },
+                { "ceil",  1, CVarExpression::OP_CEIL },
+                { "round", 1, CVarExpression::OP_ROUND },
+                { "sqrt",  1, CVarExpression::OP_SQRT },
+                { "pow",   2, CVarExpression::OP_POW },
+                { "clamp", 3, CVarExpression::OP_CLAMP }
+            };
+            const FunctionDef* pDef = NULL;
+            for( size_t ii = 0; ii < sizeof( functions ) / sizeof( functions[0] ); ii++ ) {
+                if( sName == functions[ii].sName ) {
+                    pDef = &functions[ii];
+                }
+            }
+            if( pDef == NULL ) {
+                return _Error( "unknown function '" + sName + "'" );
+            }
+            int nArgs = 0;
+            if( !_Accept( ')' ) ) {
+                do {
+                    if( !_Expr() ) { return false; }
+                    nArgs++;
+                } while( _Accept( ',' ) );
+                if( !_Accept( ')' ) ) {
+                    return _Error( "missing ')' after arguments of '" + sName + "'" );
+                }
+            }
+            if( nArgs != pDef->nArgs ) {
+                std::ostringstream oss;
+                oss << "'" << sName << "' expects " << pDef->nArgs << " argument(s)";
+                return _Error( oss.str() );
+            }
+            _Emit( pDef->nOp );
+            return true;
+        }
+
+        bool _CVar( const std::string& sName ) {
+            TrieNode* pNode = TrieInstance().Find( sName );
+            if( pNode == NULL ) {
+                return _Error( "unknown CVar '" + sName + "'" );
+            }
+            if( std::find( m_vInputs.begin(), m_vInputs.end(), pNode->m_pNodeData ) == m_vInputs.end() ) {
+                m_vInputs.push_back( pNode->m_pNodeData );
+            }
+            _Emit( CVarExpression::OP_CVAR, 0, pNode->m_pNodeData );
+            return true;
+        }
+
+    private:
+        const std::string&                        m_sExpr;
+        size_t                                    m_nPos;
+        std::string                               m_sError;
+        std::vector<CVarExpression::Instruction>& m_vProgram;
+        std::vector<void*>&                       m_vInputs;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    bool CVarExpression::Compile( const std::string& sExpression, std::string& sError )
+    {
+        m_vProgram.clear();
+        m_vInputs.clear();
+        ExpressionParser parser( sExpression, m_vProgram, m_vInputs );
+        if( !parser.Parse( sError ) ) {
+            m_vProgram.clear();
+            m_vInputs.clear();
+            return false;
+        }
+        m_vStack.reserve( m_vProgram.size() );
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    double CVarExpression::Evaluate()
+    {
+        m_vStack.clear();
+        for( size_t ii = 0; ii < m_vProgram.size(); ii++ ) {
+            const Instruction& ins = m_vProgram[ii];
+            double a, b;
+            switch( ins.m_nOp ) {
+            case OP_CONST:
+                m_vStack.push_back( ins.m_dValue );
+                continue;
+            case OP_CVAR:
+                m_vStack.push_back( ((CVar<int>*)ins.m_pCVar)->GetValueAsDouble() );
+                continue;
+            case OP_NEG:   m_vStack.back() = -m_vStack.back();              continue;
+            case OP_ABS:   m_vStack.back() = fabs( m_vStack.back() );       continue;
+            case OP_FLOOR: m_vStack.back() = floor( m_vStack.back() );      continue;
+            case OP_CEIL:  m_vStack.back() = ceil( m_vStack.back() );       continue;
+            case OP_ROUND: m_vStack.back() = round( m_vStack.back() );      continue;
+            case OP_SQRT:  m_vStack.back() = sqrt( m_vStack.back() );       continue;
+            case OP_CLAMP:
+                b = m_vStack.back(); m_vStack.pop_back();
+                a = m_vStack.back(); m_vStack.pop_back();
+                m_vStack.back() = std::min( std::max( m_vStack.back(), a ), b );
+                continue;
+            default:
+                break;
+            }
+            // binary operators
+            b = m_vStack.back(); m_vStack.pop_back();
+            a = m_vStack.back();
+            switch( ins.m_nOp ) {
+            case OP_ADD: a = a + b;                 break;
+            case OP_SUB: a = a - b;                 break;
+            case OP_MUL: a = a * b;                 break;
+            case OP_DIV: a = a / b;                 break;
+            case OP_MOD: a = fmod( a, b );          break;
+            case OP_POW: a = pow( a, b );           break;
+            case OP_MIN: a = std::min( a, b );      break;
+            case OP_MAX: a = std::max( a, b );      break;
+            default:                                break;
+            }
+            m_vStack.back() = a;
+        }
+        return m_vStack.empty() ? 0 : m_vStack.back();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void CVarExpression::RemoveInput( void* pCVar )
+    {
+        const double dValue = ((CVar<int>*)pCVar)->GetValueAsDouble();
+        for( size_t ii = 0; ii < m_vProgram.size(); ii++ ) {
+            if( m_vProgram[ii].m_nOp == OP_CVAR && m_vProgram[ii].m_pCVar == pCVar ) {
+                m_vProgram[ii].m_nOp = OP_CONST;
+                m_vProgram[ii].m_dValue = dValue;
+                m_vProgram[ii].m_pCVar = NULL;
+            }
+        }
+        m_vInputs.erase( std::remove( m_vInputs.begin(), m_vInputs.end(), pCVar ), m_vInputs.end() );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void AttachCVarDerivation( void* pCVar, CVarDerivation* pDerivation )
+    {
+        const std::vector<void*>& vInputs = pDerivation->m_Expression.GetInputs();
+        for( size_t ii = 0; ii < vInputs.size(); ii++ ) {
+            ((CVar<int>*)vInputs[ii])->m_vDependents.push_back( pDerivation );
+        }
+        ((CVar<int>*)pCVar)->m_pDerivation = pDerivation;
+        RefreshDerivedCVar( pCVar );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void RefreshDerivedCVar( void* pCVar )
+    {
+        CVar<int>* pDerived = (CVar<int>*)pCVar;
+        CVarDerivation* pDerivation = pDerived->m_pDerivation;
+        if( pDerivation != NULL ) {
+            (*pDerivation->m_pAssignFuncPtr)( pDerived->m_pVarData,
+                                              pDerivation->m_Expression.Evaluate() );
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void ReleaseCVarDerivation( CVarDerivation* pDerivation )
+    {
+        const std::vector<void*>& vInputs = pDerivation->m_Expression.GetInputs();
+        for( size_t ii = 0; ii < vInputs.size(); ii++ ) {
+            std::vector<CVarDerivation*>& vDependents = ((CVar<int>*)vInputs[ii])->m_vDependents;
+            vDependents.erase( std::remove( vDependents.begin(), vDependents.end(), pDerivation ),
+                               vDependents.end() );
+        }
+        delete pDerivation;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void DetachCVarDependents( void* pCVar )
+    {
+        std::vector<CVarDerivation*>& vDependents = ((CVar<int>*)pCVar)->m_vDependents;
+        for( size_t ii = 0; ii < vDependents.size(); ii++ ) {
+            vDependents[ii]->m_Expression.RemoveInput( pCVar );
+        }
+        vDependents.clear();
+    }
+}
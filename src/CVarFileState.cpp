@@ -0,0 +1,153 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Unchanged file detection: with SetUnchangedLoads, Save and Load record the
+// size, mtime and content hash of the file (and of its delta) and a hash of
+// the CVar values, and Load skips a file recorded since when neither it nor
+// the CVars changed.
+
+#include <cvars/CVar.h>
+#include <cvars/Trie.h>
+
+#include <fstream>
+#include <cstring>
+
+#include <sys/stat.h>
+
+using namespace CVarUtils;
+
+////////////////////////////////////////////////////////////////////////////////
+// Adds nBytes at pData to a 64 bit hash, 8 bytes at a time.
+static uint64_t HashBytes( uint64_t nHash, const char* pData, size_t nBytes )
+{
+    size_t ii = 0;
+    for( ; ii + 8 <= nBytes; ii += 8 ) {
+        uint64_t nWord;
+        memcpy( &nWord, pData + ii, 8 );
+        nHash = ( nHash ^ nWord ) * 0x9E3779B97F4A7C15ULL;
+        nHash ^= nHash >> 32;
+    }
+    for( ; ii < nBytes; ii++ ) {
+        nHash = ( nHash ^ (unsigned char)pData[ii] ) * 1099511628211ULL;
+    }
+    return nHash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static uint64_t HashFile( const std::string& sFileName )
+{
+    std::ifstream sIn( sFileName.c_str(), std::ios::in | std::ios::binary );
+    uint64_t nHash = 14695981039346656037ULL;
+    char buf[65536];
+    while( sIn.read( buf, sizeof( buf ) ) || sIn.gcount() > 0 ) {
+        nHash = HashBytes( nHash, buf, sIn.gcount() );
+    }
+    return nHash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Hash of the values of the serialisable CVars (see GetCVarValueState), so
+// writes through references are seen as well.
+static uint64_t HashCVarValues( Trie &rTrie )
+{
+    const std::vector<void*>& vCVars = rTrie.GetAllCVars();
+    uint64_t nHash = 14695981039346656037ULL;
+    std::string sState;
+    for( size_t ii = 0; ii < vCVars.size(); ii++ ) {
+        if( !((CVar<int>*)vCVars[ii])->m_bSerialise ) {
+            continue;
+        }
+        GetCVarValueState( vCVars[ii], sState );
+        const uint64_t nSize = sState.size();
+        nHash = HashBytes( nHash, (const char*)&nSize, sizeof( nSize ) );
+        nHash = HashBytes( nHash, sState.data(), sState.size() );
+    }
+    return nHash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void GetFileStamp( const std::string& sFileName, bool bHash, CVarFileStamp& stamp )
+{
+    struct stat st;
+    if( stat( sFileName.c_str(), &st ) != 0 ) {
+        stamp.m_nSize = -1;
+        stamp.m_nMTime = 0;
+        stamp.m_nHash = 0;
+        return;
+    }
+    stamp.m_nSize = st.st_size;
+#ifdef __linux__
+    stamp.m_nMTime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    stamp.m_nMTime = st.st_mtime;
+#endif
+    stamp.m_nHash = bHash ? HashFile( sFileName ) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Compares sFileName with its recorded stamp, hashing it only if the size
+// matches (and, for CVARS_SKIP_SAME_MTIME, the mtime does not).
+static bool IsSameFile( const std::string& sFileName, const CVarFileStamp& recorded,
+                        CVARS_UNCHANGED_LOADS unchangedLoads )
+{
+    CVarFileStamp stamp;
+    GetFileStamp( sFileName, false, stamp );
+    if( stamp.m_nSize != recorded.m_nSize ) {
+        return false;
+    }
+    if( stamp.m_nSize < 0 ) {
+        return true;
+    }
+    if( unchangedLoads == CVARS_SKIP_SAME_MTIME && stamp.m_nMTime == recorded.m_nMTime ) {
+        return true;
+    }
+    return HashFile( sFileName ) == recorded.m_nHash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RecordFileState( const std::string& sFileName, const std::vector<std::string>& vFilters, Trie &rTrie )
+{
+    if( rTrie.GetUnchangedLoads() == CVARS_ALWAYS_LOAD ) {
+        return;
+    }
+    CVarFileRecord& record = rTrie.m_mFileRecords[ sFileName ];
+    GetFileStamp( sFileName, true, record.m_File );
+    GetFileStamp( sFileName + CVARS_DELTA_SUFFIX, true, record.m_Delta );
+    record.m_StreamType = rTrie.GetStreamType();
+    record.m_vFilters = vFilters;
+    record.m_nChangeCount = rTrie.m_nChangeCount;
+    record.m_nCVars = rTrie.GetAllCVars().size();
+    record.m_nValuesHash = HashCVarValues( rTrie );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool IsFileUnchanged( const std::string& sFileName, const std::vector<std::string>& vFilters, Trie &rTrie )
+{
+    const CVARS_UNCHANGED_LOADS unchangedLoads = rTrie.GetUnchangedLoads();
+    if( unchangedLoads == CVARS_ALWAYS_LOAD ) {
+        return false;
+    }
+    std::unordered_map< std::string, CVarFileRecord >::iterator it = rTrie.m_mFileRecords.find( sFileName );
+    if( it == rTrie.m_mFileRecords.end() ) {
+        return false;
+    }
+    // the CVars must still hold what the file was saved from or loaded into
+    const CVarFileRecord& record = it->second;
+    if( record.m_nChangeCount != rTrie.m_nChangeCount ||
+        record.m_nCVars != rTrie.GetAllCVars().size() ||
+        record.m_StreamType != rTrie.GetStreamType() ||
+        record.m_vFilters != vFilters ) {
+        return false;
+    }
+    if( !IsSameFile( sFileName, record.m_File, unchangedLoads ) ||
+        !IsSameFile( sFileName + CVARS_DELTA_SUFFIX, record.m_Delta, unchangedLoads ) ) {
+        return false;
+    }
+    // NotifyChanged is not called after writes through references
+    return HashCVarValues( rTrie ) == record.m_nValuesHash;
+}
@@ -0,0 +1,338 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Hot reload of settings files: a background thread waits for inotify events
+// on the directories of the watched files and, once a file has not been
+// written for its debounce delay, marks it for reloading.  The CVars are only
+// touched by ApplyWatchedFiles, on the thread owning them, which loads the
+// marked files and notifies the CVars whose value changed.
+
+#include <cvars/CVar.h>
+#include <cvars/Trie.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+using namespace CVarUtils;
+
+////////////////////////////////////////////////////////////////////////////////
+struct CVarWatchedFile
+{
+    std::vector<std::string> m_vFilters;
+    CVARS_STREAM_TYPE        m_StreamType;
+    std::chrono::milliseconds m_Debounce;
+    std::chrono::steady_clock::time_point m_Deadline; // of the last write seen
+    bool                     m_bWritten;   // waiting for the debounce delay
+    bool                     m_bChanged;   // to be reloaded by ApplyWatchedFiles
+};
+
+#ifdef __linux__
+
+////////////////////////////////////////////////////////////////////////////////
+// Splits sFileName into the directory to watch and the name inotify reports.
+static void SplitWatchPath( const std::string& sFileName, std::string& sDir, std::string& sName )
+{
+    const size_t nSlash = sFileName.find_last_of( '/' );
+    if( nSlash == std::string::npos ) {
+        sDir = ".";
+        sName = sFileName;
+    }
+    else {
+        sDir = nSlash == 0 ? "/" : sFileName.substr( 0, nSlash );
+        sName = sFileName.substr( nSlash + 1 );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The inotify descriptor and the thread reading it, started by the first
+// WatchFile and stopped at exit.
+class CVarFileWatcher
+{
+public:
+    CVarFileWatcher() : m_nInotify( -1 ), m_bAnyChanged( false ) {
+        m_vWakePipe[0] = m_vWakePipe[1] = -1;
+    }
+
+    ~CVarFileWatcher() {
+        if( m_Thread.joinable() ) {
+            const char c = 0;
+            if( write( m_vWakePipe[1], &c, 1 ) == 1 ) {
+                m_Thread.join();
+            }
+            else {
+                m_Thread.detach();
+            }
+        }
+        if( m_nInotify >= 0 ) {
+            close( m_nInotify );
+            close( m_vWakePipe[0] );
+            close( m_vWakePipe[1] );
+        }
+    }
+
+    bool Watch( const std::string& sFileName, const std::vector<std::string>& vFilters,
+                CVARS_STREAM_TYPE streamType, unsigned int nDebounceMs ) {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        if( m_nInotify < 0 ) {
+            m_nInotify = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+            if( m_nInotify < 0 ) {
+                return false;
+            }
+            if( pipe( m_vWakePipe ) != 0 ) {
+                close( m_nInotify );
+                m_nInotify = -1;
+                return false;
+            }
+        }
+        std::string sDir, sName;
+        SplitWatchPath( sFileName, sDir, sName );
+        // editors often write a new file and rename it over the old one
+        const int nWatch = inotify_add_watch( m_nInotify, sDir.c_str(),
+                                              IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE );
+        if( nWatch < 0 ) {
+            return false;
+        }
+        m_sWatches.insert( nWatch );
+        CVarWatchedFile& file = m_mFiles[ sFileName ];
+        file.m_vFilters = vFilters;
+        file.m_StreamType = streamType;
+        file.m_Debounce = std::chrono::milliseconds( nDebounceMs );
+        file.m_bWritten = false;
+        file.m_bChanged = false;
+        m_mNames[ std::make_pair( nWatch, sName ) ] = sFileName;
+        m_mNames[ std::make_pair( nWatch, sName + CVARS_DELTA_SUFFIX ) ] = sFileName;
+        if( !m_Thread.joinable() ) {
+            m_Thread = std::thread( &CVarFileWatcher::Run, this );
+        }
+        return true;
+    }
+
+    void Unwatch( const std::string& sFileName ) {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_mFiles.erase( sFileName );
+        std::set<int> sUsedWatches;
+        for( NameMap::iterator it = m_mNames.begin(); it != m_mNames.end(); ) {
+            if( it->second == sFileName ) {
+                m_mNames.erase( it++ );
+            }
+            else {
+                sUsedWatches.insert( it->first.first );
+                ++it;
+            }
+        }
+        // directories without watched files left
+        for( std::set<int>::iterator it = m_sWatches.begin(); it != m_sWatches.end(); ) {
+            if( sUsedWatches.count( *it ) == 0 ) {
+                inotify_rm_watch( m_nInotify, *it );
+                m_sWatches.erase( it++ );
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    // Files changed since the last call, with their filters and stream type.
+    void TakeChanged( std::vector< std::pair<std::string, CVarWatchedFile> >& vChanged ) {
+        if( !m_bAnyChanged ) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        for( FileMap::iterator it = m_mFiles.begin(); it != m_mFiles.end(); ++it ) {
+            if( it->second.m_bChanged ) {
+                it->second.m_bChanged = false;
+                vChanged.push_back( *it );
+            }
+        }
+        m_bAnyChanged = false;
+    }
+
+private:
+    typedef std::map< std::string, CVarWatchedFile > FileMap;
+    typedef std::map< std::pair<int, std::string>, std::string > NameMap;
+
+    void Run() {
+        alignas( struct inotify_event ) char buf[4096];
+        pollfd vFds[2] = { { m_nInotify, POLLIN, 0 }, { m_vWakePipe[0], POLLIN, 0 } };
+        for( ;; ) {
+            const int nTimeoutMs = NextTimeoutMs();
+            if( poll( vFds, 2, nTimeoutMs ) < 0 && errno != EINTR ) {
+                return;
+            }
+            if( vFds[1].revents != 0 ) {
+                return;
+            }
+            ssize_t nBytes;
+            while( ( nBytes = read( m_nInotify, buf, sizeof( buf ) ) ) > 0 ) {
+                std::lock_guard<std::mutex> lock( m_Mutex );
+                for( char* p = buf; p < buf + nBytes; ) {
+                    const inotify_event* pEvent = (const inotify_event*)p;
+                    p += sizeof( inotify_event ) + pEvent->len;
+                    if( pEvent->len == 0 ) {
+                        continue;
+                    }
+                    NameMap::iterator itName = m_mNames.find( std::make_pair( pEvent->wd, std::string( pEvent->name ) ) );
+                    if( itName == m_mNames.end() ) {
+                        continue;
+                    }
+                    // each write restarts the debounce delay
+                    CVarWatchedFile& file = m_mFiles[ itName->second ];
+                    file.m_bWritten = true;
+                    file.m_Deadline = std::chrono::steady_clock::now() + file.m_Debounce;
+                }
+            }
+            std::lock_guard<std::mutex> lock( m_Mutex );
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            for( FileMap::iterator it = m_mFiles.begin(); it != m_mFiles.end(); ++it ) {
+                if( it->second.m_bWritten && it->second.m_Deadline <= now ) {
+                    it->second.m_bWritten = false;
+                    it->second.m_bChanged = true;
+                    m_bAnyChanged = true;
+                }
+            }
+        }
+    }
+
+    // until the earliest debounce deadline, -1 (forever) if there is none
+    int NextTimeoutMs() {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        int nTimeoutMs = -1;
+        for( FileMap::iterator it = m_mFiles.begin(); it != m_mFiles.end(); ++it ) {
+            if( !it->second.m_bWritten ) {
+                continue;
+            }
+            const int nMs = it->second.m_Deadline <= now ? 0 : (int)std::chrono::ceil<std::chrono::milliseconds>(
+                it->second.m_Deadline - now ).count();
+            if( nTimeoutMs < 0 || nMs < nTimeoutMs ) {
+                nTimeoutMs = nMs;
+            }
+        }
+        return nTimeoutMs;
+    }
+
+    std::mutex        m_Mutex;
+    int               m_nInotify;
+    int               m_vWakePipe[2];
+    std::set<int>     m_sWatches;
+    FileMap           m_mFiles;
+    NameMap           m_mNames;
+    std::thread       m_Thread;
+    std::atomic<bool> m_bAnyChanged;
+};
+
+#else
+
+////////////////////////////////////////////////////////////////////////////////
+// Without inotify files cannot be watched.
+class CVarFileWatcher
+{
+public:
+    bool Watch( const std::string&, const std::vector<std::string>&, CVARS_STREAM_TYPE, unsigned int ) {
+        return false;
+    }
+    void Unwatch( const std::string& ) {}
+    void TakeChanged( std::vector< std::pair<std::string, CVarWatchedFile> >& ) {}
+};
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+static CVarFileWatcher& FileWatcherInstance()
+{
+    static CVarFileWatcher watcher;
+    return watcher;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Loads sFileName, then notifies the CVars it actually changed: the loaders
+// notify every value they set, which would also mark unchanged CVars.
+static bool ReloadWatchedFile( const std::string& sFileName, const CVarWatchedFile& file )
+{
+    Trie& trie = TrieInstance();
+    trie.SetAcceptedSubstrings( file.m_vFilters );
+    std::vector<void*> vCVars;
+    trie.CollectAcceptedCVars( vCVars );
+    std::vector<std::string> vStates( vCVars.size() );
+    for( size_t ii = 0; ii < vCVars.size(); ii++ ) {
+        GetCVarValueState( (CVar<int>*)vCVars[ii], vStates[ii] );
+    }
+
+    const CVARS_STREAM_TYPE streamType = trie.GetStreamType();
+    trie.SetStreamType( file.m_StreamType );
+    trie.m_bHoldNotifications = true;
+    bool bLoaded = false;
+    try {
+        bLoaded = Load( sFileName, file.m_vFilters );
+    }
+    catch( ... ) {
+        trie.m_bHoldNotifications = false;
+        trie.SetStreamType( streamType );
+        throw;
+    }
+    trie.m_bHoldNotifications = false;
+    trie.SetStreamType( streamType );
+
+    std::string sState;
+    for( size_t ii = 0; ii < vCVars.size(); ii++ ) {
+        GetCVarValueState( (CVar<int>*)vCVars[ii], sState );
+        if( sState != vStates[ii] ) {
+            NotifyCVarChanged( vCVars[ii] );
+        }
+    }
+    return bLoaded;
+}
+
+namespace CVarUtils
+{
+    ////////////////////////////////////////////////////////////////////////////////
+    bool WatchFile( const std::string& sFileName, std::vector<std::string> vAcceptedSubstrings,
+                    unsigned int nDebounceMs )
+    {
+        if( !FileWatcherInstance().Watch( sFileName, vAcceptedSubstrings,
+                                          TrieInstance().GetStreamType(), nDebounceMs ) ) {
+            std::cerr << "ERROR: could not watch \"" << sFileName << "\" for changes." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void UnwatchFile( const std::string& sFileName )
+    {
+        FileWatcherInstance().Unwatch( sFileName );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    size_t ApplyWatchedFiles()
+    {
+        std::vector< std::pair<std::string, CVarWatchedFile> > vChanged;
+        FileWatcherInstance().TakeChanged( vChanged );
+        size_t nLoaded = 0;
+        for( size_t ii = 0; ii < vChanged.size(); ii++ ) {
+            if( ReloadWatchedFile( vChanged[ii].first, vChanged[ii].second ) ) {
+                nLoaded++;
+            }
+            else {
+                std::cerr << "ERROR: could not reload \"" << vChanged[ii].first << "\"." << std::endl;
+            }
+        }
+        return nLoaded;
+    }
+}
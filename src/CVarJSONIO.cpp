@@ -0,0 +1,678 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// JSON settings (CVARS_JSON_STREAM): one object holding the CVars, dotted
+// namespaces as nested objects, eg. "renderer.shadows.size" is saved as
+// { "renderer": { "shadows": { "size": 1024 } } }.  Numbers, bools and
+// std::strings are JSON numbers, bools and strings, numeric vectors and
+// arrays and std::vector<std::string> JSON arrays; other types are saved as
+// a string of their text.
+// A key may hold dots, it is then relative to the enclosing objects: the
+// writer uses that when a CVar name is also a namespace ("a.b" and "a.b.c").
+//
+// The writer formats the values from their binary form (see CVarBinaryIO.h)
+// and the reader is a pull parser applying each value as it is read, nothing
+// is built in memory.
+
+#include <cvars/CVar.h>
+#include <cvars/Trie.h>
+#include <cvars/CVarBinaryIO.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <string_view>
+#include <cstring>
+
+using namespace CVarUtils;
+
+////////////////////////////////////////////////////////////////////////////////
+// Buffered, indented output of JSON tokens.
+class JSONWriter
+{
+public:
+    JSONWriter( std::ostream& stream, int nIndentIncr )
+        : m_Stream( stream ), m_nIndent( 0 ), m_nIndentIncr( nIndentIncr > 0 ? nIndentIncr : 2 ) {
+        m_sBuf.reserve( 2 * FLUSH_SIZE );
+    }
+    ~JSONWriter() { Flush(); }
+
+    void Indent()   { m_nIndent += m_nIndentIncr; }
+    void UnIndent() { m_nIndent -= m_nIndentIncr; }
+
+    void NewLine() {
+        m_sBuf += '\n';
+        m_sBuf.append( m_nIndent, ' ' );
+        if( m_sBuf.size() >= FLUSH_SIZE ) {
+            Flush();
+        }
+    }
+
+    void Write( const char* s, size_t nLength ) { m_sBuf.append( s, nLength ); }
+    void Write( char c ) { m_sBuf += c; }
+
+    // s quoted, with '"', '\' and the control characters escaped
+    void WriteString( const char* s, size_t nLength ) {
+        static const char sHex[] = "0123456789abcdef";
+        m_sBuf += '"';
+        size_t nFrom = 0;
+        for( size_t ii = 0; ii < nLength; ii++ ) {
+            const unsigned char c = s[ii];
+            if( c >= 0x20 && c != '"' && c != '\\' ) {
+                continue;
+            }
+            m_sBuf.append( s + nFrom, ii - nFrom );
+            nFrom = ii + 1;
+            m_sBuf += '\\';
+            switch( c ) {
+            case '"':  m_sBuf += '"';  break;
+            case '\\': m_sBuf += '\\'; break;
+            case '\n': m_sBuf += 'n';  break;
+            case '\r': m_sBuf += 'r';  break;
+            case '\t': m_sBuf += 't';  break;
+            default:
+                m_sBuf += "u00";
+                m_sBuf += sHex[c >> 4];
+                m_sBuf += sHex[c & 0xf];
+            }
+        }
+        m_sBuf.append( s + nFrom, nLength - nFrom );
+        m_sBuf += '"';
+    }
+
+    // the number of binary type id nTypeId at p, in its shortest exact form
+    void WriteNumber( uint32_t nTypeId, const char* p ) {
+        char buf[32];
+        std::to_chars_result res = { buf, std::errc() };
+        switch( nTypeId >> 8 ) {
+        case 'b': {
+            bool bVal = false;
+            ReadBinaryNumber( nTypeId, p, bVal );
+            m_sBuf += bVal ? "true" : "false";
+            return;
+        }
+        case 'i': {
+            int64_t nVal = 0;
+            ReadBinaryNumber( nTypeId, p, nVal );
+            res = std::to_chars( buf, buf + sizeof( buf ), nVal );
+            break;
+        }
+        case 'u': {
+            uint64_t nVal = 0;
+            ReadBinaryNumber( nTypeId, p, nVal );
+            res = std::to_chars( buf, buf + sizeof( buf ), nVal );
+            break;
+        }
+        default: {
+            double dVal = 0;
+            ReadBinaryNumber( nTypeId, p, dVal );
+            if( !std::isfinite( dVal ) ) {
+                // not representable in JSON, the text form is parsed back
+                const char* sVal = std::isnan( dVal ) ? "nan" : dVal > 0 ? "inf" : "-inf";
+                WriteString( sVal, strlen( sVal ) );
+                return;
+            }
+            if( BinaryNumberSize( nTypeId ) == sizeof( float ) ) {
+                res = std::to_chars( buf, buf + sizeof( buf ), (float)dVal );
+            }
+            else {
+                res = std::to_chars( buf, buf + sizeof( buf ), dVal );
+            }
+        }
+        }
+        m_sBuf.append( buf, res.ptr - buf );
+    }
+
+    void Flush() {
+        m_Stream.write( m_sBuf.data(), m_sBuf.size() );
+        m_sBuf.clear();
+    }
+
+private:
+    static const size_t FLUSH_SIZE = 65536;
+
+    std::ostream& m_Stream;
+    std::string   m_sBuf;
+    int           m_nIndent;
+    int           m_nIndentIncr;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+struct JSONSaveContext
+{
+    const CVarSaveSet&         m_SaveSet;
+    // the names with their m_SaveSet index, sorted
+    const std::vector< std::pair<std::string_view, size_t> >& m_vOrder;
+    JSONWriter&                m_Writer;
+    std::string                m_sValue;
+
+    std::string_view Name( size_t ii ) const { return m_vOrder[ii].first; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes the ii-th CVar (in name order) as a member with key sKey, nothing if
+// it has no value to save.
+static void WriteJSONMember( JSONSaveContext& ctx, size_t ii, const char* sKey, size_t nKeyLength,
+                             bool& bFirst )
+{
+    const size_t nIndex = ctx.m_vOrder[ii].second;
+    CVar<int>* pCVar = (CVar<int>*)ctx.m_SaveSet.m_vCVars[ nIndex ];
+    void* pValue = ctx.m_SaveSet.m_vValues[ nIndex ];
+    std::string& sValue = ctx.m_sValue;
+    sValue.clear();
+    const uint32_t nTypeId = pCVar->FormatValueAsBinary( pValue, sValue );
+    const bool bStrings = pCVar->TypeInfo() == typeid( std::vector<std::string> );
+    if( nTypeId == CVARS_BINARY_TEXT && !bStrings ) {
+        sValue = pCVar->FormatValue( pValue );
+        if( sValue.empty() ) {
+            return;
+        }
+    }
+    if( ctx.m_SaveSet.m_bVerbose ) {
+        printf( "Saving \"%-*s\" with value \"%s\".\n", ctx.m_SaveSet.m_nVerbosePaddingWidth,
+                pCVar->m_sVarName.c_str(), pCVar->FormatValue( pValue ).c_str() );
+    }
+
+    JSONWriter& writer = ctx.m_Writer;
+    if( !bFirst ) {
+        writer.Write( ',' );
+    }
+    bFirst = false;
+    writer.NewLine();
+    writer.WriteString( sKey, nKeyLength );
+    writer.Write( ": ", 2 );
+    if( bStrings ) {
+        const std::vector<std::string>& vStrings = *(const std::vector<std::string>*)pValue;
+        writer.Write( '[' );
+        for( size_t jj = 0; jj < vStrings.size(); jj++ ) {
+            if( jj > 0 ) {
+                writer.Write( ", ", 2 );
+            }
+            writer.WriteString( vStrings[jj].data(), vStrings[jj].size() );
+        }
+        writer.Write( ']' );
+    }
+    else if( nTypeId == CVARS_BINARY_TEXT || nTypeId == CVARS_BINARY_STRING ) {
+        writer.WriteString( sValue.data(), sValue.size() );
+    }
+    else if( nTypeId & CVARS_BINARY_ARRAY ) {
+        const uint32_t nElemId = nTypeId & ~CVARS_BINARY_ARRAY;
+        const size_t nElemSize = BinaryNumberSize( nElemId );
+        writer.Write( '[' );
+        for( size_t nAt = 0; nAt + nElemSize <= sValue.size(); nAt += nElemSize ) {
+            if( nAt > 0 ) {
+                writer.Write( ", ", 2 );
+            }
+            writer.WriteNumber( nElemId, sValue.data() + nAt );
+        }
+        writer.Write( ']' );
+    }
+    else {
+        writer.WriteNumber( nTypeId, sValue.data() );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes the CVars [nBegin, nEnd) (in name order), whose names all start with
+// the namespace of length nPrefix, as an object.
+static void WriteJSONObject( JSONSaveContext& ctx, size_t nBegin, size_t nEnd, size_t nPrefix )
+{
+    JSONWriter& writer = ctx.m_Writer;
+    writer.Write( '{' );
+    writer.Indent();
+    bool bFirst = true;
+    for( size_t ii = nBegin; ii < nEnd; ) {
+        const std::string_view sName = ctx.Name( ii );
+        const size_t nDot = sName.find( '.', nPrefix );
+        if( nDot == std::string_view::npos ) {
+            WriteJSONMember( ctx, ii, sName.data() + nPrefix, sName.size() - nPrefix, bFirst );
+            ii++;
+            continue;
+        }
+        // the names in the namespace, contiguous as they are sorted
+        size_t nGroupEnd = ii + 1;
+        while( nGroupEnd < nEnd && ctx.Name( nGroupEnd ).compare( 0, nDot + 1, sName, 0, nDot + 1 ) == 0 ) {
+            nGroupEnd++;
+        }
+        // a CVar named as the namespace takes its key, so its members keep
+        // dotted keys at this level
+        const std::string_view sGroupName = sName.substr( 0, nDot );
+        const std::pair<std::string_view, size_t>* pTaken = std::lower_bound(
+            ctx.m_vOrder.data() + nBegin, ctx.m_vOrder.data() + ii, std::make_pair( sGroupName, (size_t)0 ) );
+        const bool bNameTaken = pTaken != ctx.m_vOrder.data() + ii && pTaken->first == sGroupName;
+        if( bNameTaken ) {
+            for( ; ii < nGroupEnd; ii++ ) {
+                const std::string_view sMember = ctx.Name( ii );
+                WriteJSONMember( ctx, ii, sMember.data() + nPrefix, sMember.size() - nPrefix, bFirst );
+            }
+            continue;
+        }
+        if( !bFirst ) {
+            writer.Write( ',' );
+        }
+        bFirst = false;
+        writer.NewLine();
+        writer.WriteString( sName.data() + nPrefix, nDot - nPrefix );
+        writer.Write( ": ", 2 );
+        WriteJSONObject( ctx, ii, nGroupEnd, nDot + 1 );
+        ii = nGroupEnd;
+    }
+    writer.UnIndent();
+    if( !bFirst ) {
+        writer.NewLine();
+    }
+    writer.Write( '}' );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::ostream &SaveSetToJSON( std::ostream &stream, const CVarSaveSet &saveSet )
+{
+    // sorting views of the names avoids going through the CVars
+    std::vector< std::pair<std::string_view, size_t> > vOrder( saveSet.m_vCVars.size() );
+    for( size_t ii = 0; ii < vOrder.size(); ii++ ) {
+        vOrder[ii].first = ((CVar<int>*)saveSet.m_vCVars[ii])->m_sVarName;
+        vOrder[ii].second = ii;
+    }
+    std::sort( vOrder.begin(), vOrder.end() );
+
+    JSONWriter writer( stream, saveSet.m_nIndentIncr );
+    JSONSaveContext ctx = { saveSet, vOrder, writer, std::string() };
+    WriteJSONObject( ctx, 0, vOrder.size(), 0 );
+    writer.Write( '\n' );
+    return stream;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pull parser: Next returns the tokens one at a time.  The ',' and ':'
+// separators are skipped rather than checked.
+class JSONReader
+{
+public:
+    enum Token {
+        JSON_END, JSON_ERROR, JSON_BEGIN_OBJECT, JSON_END_OBJECT, JSON_BEGIN_ARRAY, JSON_END_ARRAY,
+        JSON_STRING, JSON_NUMBER, JSON_TRUE, JSON_FALSE, JSON_NULL
+    };
+
+    JSONReader( const char* pData, size_t nBytes ) : m_pBegin( pData ), m_p( pData ), m_pEnd( pData + nBytes ) {}
+
+    Token Next() {
+        while( m_p < m_pEnd && ( *m_p == ' ' || *m_p == '\n' || *m_p == '\r' || *m_p == '\t' ||
+                                 *m_p == ',' || *m_p == ':' ) ) {
+            m_p++;
+        }
+        if( m_p == m_pEnd ) {
+            return JSON_END;
+        }
+        switch( *m_p ) {
+        case '{': m_p++; return JSON_BEGIN_OBJECT;
+        case '}': m_p++; return JSON_END_OBJECT;
+        case '[': m_p++; return JSON_BEGIN_ARRAY;
+        case ']': m_p++; return JSON_END_ARRAY;
+        case '"': return ReadString() ? JSON_STRING : JSON_ERROR;
+        case 't': return ReadLiteral( "true", JSON_TRUE );
+        case 'f': return ReadLiteral( "false", JSON_FALSE );
+        case 'n': return ReadLiteral( "null", JSON_NULL );
+        default: {
+            const char* pStart = m_p;
+            while( m_p < m_pEnd && ( ( *m_p >= '0' && *m_p <= '9' ) || *m_p == '-' || *m_p == '+' ||
+                                     *m_p == '.' || *m_p == 'e' || *m_p == 'E' ) ) {
+                m_p++;
+            }
+            if( m_p == pStart ) {
+                return JSON_ERROR;
+            }
+            m_Value = std::string_view( pStart, m_p - pStart );
+            return JSON_NUMBER;
+        }
+        }
+    }
+
+    // text of the last JSON_STRING (unescaped) or JSON_NUMBER
+    std::string_view Value() const { return m_Value; }
+
+    size_t Offset() const { return m_p - m_pBegin; }
+
+private:
+    Token ReadLiteral( const char* sLiteral, Token token ) {
+        const size_t nLength = strlen( sLiteral );
+        if( (size_t)( m_pEnd - m_p ) < nLength || memcmp( m_p, sLiteral, nLength ) != 0 ) {
+            return JSON_ERROR;
+        }
+        m_Value = std::string_view( m_p, nLength );
+        m_p += nLength;
+        return token;
+    }
+
+    // points m_Value into the buffer, or into m_sUnescaped if there are escapes
+    bool ReadString() {
+        const char* pStart = ++m_p;
+        while( m_p < m_pEnd && *m_p != '"' && *m_p != '\\' ) {
+            m_p++;
+        }
+        if( m_p == m_pEnd ) {
+            return false;
+        }
+        if( *m_p == '"' ) {
+            m_Value = std::string_view( pStart, m_p++ - pStart );
+            return true;
+        }
+        m_sUnescaped.assign( pStart, m_p - pStart );
+        while( m_p < m_pEnd && *m_p != '"' ) {
+            if( *m_p != '\\' ) {
+                m_sUnescaped += *m_p++;
+                continue;
+            }
+            if( ++m_p == m_pEnd ) {
+                return false;
+            }
+            switch( *m_p++ ) {
+            case '"':  m_sUnescaped += '"';  break;
+            case '\\': m_sUnescaped += '\\'; break;
+            case '/':  m_sUnescaped += '/';  break;
+            case 'b':  m_sUnescaped += '\b'; break;
+            case 'f':  m_sUnescaped += '\f'; break;
+            case 'n':  m_sUnescaped += '\n'; break;
+            case 'r':  m_sUnescaped += '\r'; break;
+            case 't':  m_sUnescaped += '\t'; break;
+            case 'u': {
+                uint32_t nCode;
+                if( !ReadHex4( nCode ) ) {
+                    return false;
+                }
+                // surrogate pair
+                if( nCode >= 0xd800 && nCode < 0xdc00 && m_pEnd - m_p >= 6 && m_p[0] == '\\' && m_p[1] == 'u' ) {
+                    m_p += 2;
+                    uint32_t nLow;
+                    if( !ReadHex4( nLow ) ) {
+                        return false;
+                    }
+                    nCode = 0x10000 + ( ( nCode - 0xd800 ) << 10 ) + ( nLow - 0xdc00 );
+                }
+                AppendUTF8( nCode );
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        if( m_p == m_pEnd ) {
+            return false;
+        }
+        m_p++;
+        m_Value = m_sUnescaped;
+        return true;
+    }
+
+    bool ReadHex4( uint32_t& nCode ) {
+        if( m_pEnd - m_p < 4 ) {
+            return false;
+        }
+        const std::from_chars_result res = std::from_chars( m_p, m_p + 4, nCode, 16 );
+        if( res.ptr != m_p + 4 ) {
+            return false;
+        }
+        m_p += 4;
+        return true;
+    }
+
+    void AppendUTF8( uint32_t nCode ) {
+        if( nCode < 0x80 ) {
+            m_sUnescaped += (char)nCode;
+        }
+        else if( nCode < 0x800 ) {
+            m_sUnescaped += (char)( 0xc0 | ( nCode >> 6 ) );
+            m_sUnescaped += (char)( 0x80 | ( nCode & 0x3f ) );
+        }
+        else if( nCode < 0x10000 ) {
+            m_sUnescaped += (char)( 0xe0 | ( nCode >> 12 ) );
+            m_sUnescaped += (char)( 0x80 | ( ( nCode >> 6 ) & 0x3f ) );
+            m_sUnescaped += (char)( 0x80 | ( nCode & 0x3f ) );
+        }
+        else {
+            m_sUnescaped += (char)( 0xf0 | ( nCode >> 18 ) );
+            m_sUnescaped += (char)( 0x80 | ( ( nCode >> 12 ) & 0x3f ) );
+            m_sUnescaped += (char)( 0x80 | ( ( nCode >> 6 ) & 0x3f ) );
+            m_sUnescaped += (char)( 0x80 | ( nCode & 0x3f ) );
+        }
+    }
+
+    const char*      m_pBegin;
+    const char*      m_p;
+    const char*      m_pEnd;
+    std::string_view m_Value;
+    std::string      m_sUnescaped;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Appends the binary form of a JSON number: int64, uint64 if too large, or
+// double.  Returns its type id, CVARS_BINARY_TEXT if it does not parse.
+static uint32_t ParseJSONNumber( std::string_view sNumber, std::string& sOut )
+{
+    const char* pEnd = sNumber.data() + sNumber.size();
+    if( sNumber.find_first_of( ".eE" ) == std::string_view::npos ) {
+        int64_t nVal;
+        std::from_chars_result res = std::from_chars( sNumber.data(), pEnd, nVal );
+        if( res.ptr == pEnd && res.ec == std::errc() ) {
+            sOut.append( (const char*)&nVal, sizeof( nVal ) );
+            return BinaryNumberTypeId<int64_t>();
+        }
+        uint64_t nUVal;
+        res = std::from_chars( sNumber.data(), pEnd, nUVal );
+        if( res.ptr == pEnd && res.ec == std::errc() ) {
+            sOut.append( (const char*)&nUVal, sizeof( nUVal ) );
+            return BinaryNumberTypeId<uint64_t>();
+        }
+    }
+    double dVal;
+    const std::from_chars_result res = std::from_chars( sNumber.data(), pEnd, dVal );
+    if( res.ptr != pEnd || res.ec != std::errc() ) {
+        return CVARS_BINARY_TEXT;
+    }
+    sOut.append( (const char*)&dVal, sizeof( dVal ) );
+    return BinaryNumberTypeId<double>();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// A value read from JSON: its binary form and, for types without one, the
+// text the CVar parses.
+struct JSONValue
+{
+    uint32_t    m_nTypeId;
+    std::string m_sBinary;
+    std::string m_sText;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Reads the value starting with token into value, false on a syntax error.
+static bool ReadJSONValue( JSONReader& reader, JSONReader::Token token, JSONValue& value )
+{
+    value.m_sBinary.clear();
+    value.m_sText.clear();
+    switch( token ) {
+    case JSONReader::JSON_STRING:
+        value.m_nTypeId = CVARS_BINARY_STRING;
+        value.m_sBinary.assign( reader.Value() );
+        value.m_sText = value.m_sBinary;
+        return true;
+    case JSONReader::JSON_NUMBER:
+        value.m_nTypeId = ParseJSONNumber( reader.Value(), value.m_sBinary );
+        value.m_sText.assign( reader.Value() );
+        return true;
+    case JSONReader::JSON_TRUE:
+    case JSONReader::JSON_FALSE:
+        value.m_nTypeId = BinaryNumberTypeId<bool>();
+        value.m_sBinary += (char)( token == JSONReader::JSON_TRUE );
+        value.m_sText = token == JSONReader::JSON_TRUE ? "1" : "0";
+        return true;
+    case JSONReader::JSON_BEGIN_ARRAY:
+        break;
+    default:
+        return false;
+    }
+
+    // Arrays of numbers are read as int64, or double once a non integer is
+    // met; the text form "[ a b ]" is kept for the other vectors, with the
+    // strings quoted as needed so "a b" stays one element.
+    std::vector<int64_t> vIntegers;
+    std::vector<double> vDoubles;
+    bool bNumbers = true;
+    value.m_sText = "[";
+    for( ;; ) {
+        token = reader.Next();
+        if( token == JSONReader::JSON_END_ARRAY ) {
+            break;
+        }
+        if( token != JSONReader::JSON_NUMBER && token != JSONReader::JSON_STRING &&
+            token != JSONReader::JSON_TRUE && token != JSONReader::JSON_FALSE ) {
+            return false;
+        }
+        value.m_sText += ' ';
+        if( token == JSONReader::JSON_STRING ) {
+            AppendVectorString( value.m_sText, reader.Value() );
+        }
+        else {
+            value.m_sText.append( token == JSONReader::JSON_TRUE ? "1" :
+                                  token == JSONReader::JSON_FALSE ? "0" : reader.Value() );
+        }
+        if( !bNumbers ) {
+            continue;
+        }
+        std::string sNumber;
+        uint32_t nElemId = token == JSONReader::JSON_NUMBER ? ParseJSONNumber( reader.Value(), sNumber ) :
+            token == JSONReader::JSON_STRING ? CVARS_BINARY_TEXT : BinaryNumberTypeId<int64_t>();
+        if( nElemId == CVARS_BINARY_TEXT ) {
+            bNumbers = false;
+            continue;
+        }
+        if( token != JSONReader::JSON_NUMBER ) {
+            const int64_t nVal = token == JSONReader::JSON_TRUE;
+            sNumber.assign( (const char*)&nVal, sizeof( nVal ) );
+        }
+        double dVal = 0;
+        ReadBinaryNumber( nElemId, sNumber.data(), dVal );
+        vDoubles.push_back( dVal );
+        if( nElemId == BinaryNumberTypeId<int64_t>() && vIntegers.size() + 1 == vDoubles.size() ) {
+            int64_t nVal;
+            memcpy( &nVal, sNumber.data(), sizeof( nVal ) );
+            vIntegers.push_back( nVal );
+        }
+    }
+    value.m_sText += " ]";
+    if( !bNumbers ) {
+        value.m_nTypeId = CVARS_BINARY_TEXT;
+    }
+    else if( vIntegers.size() == vDoubles.size() ) {
+        value.m_nTypeId = CVARS_BINARY_ARRAY | BinaryNumberTypeId<int64_t>();
+        value.m_sBinary.assign( (const char*)vIntegers.data(), vIntegers.size() * sizeof( int64_t ) );
+    }
+    else {
+        value.m_nTypeId = CVARS_BINARY_ARRAY | BinaryNumberTypeId<double>();
+        value.m_sBinary.assign( (const char*)vDoubles.data(), vDoubles.size() * sizeof( double ) );
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sets the CVar sName (hash nHash) to value, or keeps it until it is created.
+static void ApplyJSONValue( const std::string& sName, uint64_t nHash, const JSONValue& value, Trie &rTrie )
+{
+    CVar<int>* pCVar = (CVar<int>*)rTrie.FindDataByHash( nHash, sName.data(), sName.size() );
+    if( !rTrie.IsNameAcceptable( sName ) ) {
+        if( rTrie.IsVerbose() ) {
+            printf( "NOT loading %s (not in acceptable name list).\n", sName.c_str() );
+        }
+        return;
+    }
+    if( pCVar == NULL ) {
+        if( rTrie.IsVerbose() ) {
+            printf( "Keeping %s until it is created (not in Trie).\n", sName.c_str() );
+        }
+        if( value.m_nTypeId == CVARS_BINARY_TEXT ) {
+            rTrie.SetPendingValue( sName, CVARS_BINARY_TEXT, value.m_sText.data(), value.m_sText.size() );
+        }
+        else {
+            rTrie.SetPendingValue( sName, value.m_nTypeId, value.m_sBinary.data(), value.m_sBinary.size() );
+        }
+        return;
+    }
+    if( pCVar->IsDerived() ) {
+        if( rTrie.IsVerbose() ) {
+            printf( "NOT loading %s (derived, read only).\n", sName.c_str() );
+        }
+        return;
+    }
+    // the binary form converts between numeric types, the text form is for
+    // the types without one
+    if( value.m_nTypeId == CVARS_BINARY_TEXT ||
+        !pCVar->SetValueFromBinary( value.m_nTypeId, value.m_sBinary.data(), value.m_sBinary.size() ) ) {
+        pCVar->SetValueFromString( value.m_sText );
+    }
+    if( rTrie.IsVerbose() ) {
+        printf( "Loading \"%-*s\" with value \"%.40s... \".\n", *rTrie.m_pVerboseCVarNamePaddingWidth,
+                sName.c_str(), value.m_sText.c_str() );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ApplyJSONBuffer( const char* pData, size_t nBytes, Trie &rTrie )
+{
+    JSONReader reader( pData, nBytes );
+    if( reader.Next() != JSONReader::JSON_BEGIN_OBJECT ) {
+        std::cerr << "ERROR: CVars JSON does not start with an object." << std::endl;
+        return false;
+    }
+    // the enclosing namespaces, where each starts in sName and their hashes
+    std::string sName;
+    std::vector<size_t> vStarts;
+    std::vector<uint64_t> vHashes( 1, HashCVarName( "", 0 ) );
+    JSONValue value;
+    for( ;; ) {
+        JSONReader::Token token = reader.Next();
+        if( token == JSONReader::JSON_END_OBJECT ) {
+            if( vStarts.empty() ) {
+                return true;
+            }
+            sName.resize( vStarts.back() );
+            vStarts.pop_back();
+            vHashes.pop_back();
+            continue;
+        }
+        if( token != JSONReader::JSON_STRING ) {
+            break;
+        }
+        const size_t nStart = sName.size();
+        const std::string_view sKey = reader.Value();
+        sName.append( sKey.data(), sKey.size() );
+        const uint64_t nHash = HashCVarName( sKey.data(), sKey.size(), vHashes.back() );
+
+        token = reader.Next();
+        if( token == JSONReader::JSON_BEGIN_OBJECT ) {
+            sName += '.';
+            vStarts.push_back( nStart );
+            vHashes.push_back( HashCVarName( ".", 1, nHash ) );
+            continue;
+        }
+        if( token == JSONReader::JSON_NULL ) {
+            sName.resize( nStart );
+            continue;
+        }
+        if( !ReadJSONValue( reader, token, value ) ) {
+            break;
+        }
+        ApplyJSONValue( sName, nHash, value, rTrie );
+        sName.resize( nStart );
+    }
+    std::cerr << "ERROR: invalid CVars JSON near byte " << reader.Offset() << "." << std::endl;
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool LoadJSONFile( const std::string& sFileName, Trie &rTrie )
+{
+    return ApplyMappedFile( sFileName, rTrie, ApplyJSONBuffer );
+}
@@ -0,0 +1,414 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Journal mode: every change notified to a saved CVar is appended to
+// "<file>.journal" as a binary record and flushed (once per Load or
+// RestoreSnapshot, see BeginJournalBatch), "<file>" being a binary
+// snapshot.  Once the journal is large enough it is renamed to
+// "<file>.journal.1", a new journal is started and SaveAsync writes the new
+// snapshot in the background; "<file>.journal.1" is removed once the
+// snapshot is written.  OpenJournal replays the snapshot, then
+// "<file>.journal.1" if a compaction did not complete, then the journal.
+//
+// A journal is laid out as (host byte order):
+//   - a CVarJournalHeader,
+//   - records, each a CVarJournalRecord followed by m_nLength bytes: the name
+//     for CVARS_JOURNAL_NAME records, the value (as in binary snapshots) for
+//     CVARS_JOURNAL_VALUE ones.  A CVar name is written once per journal,
+//     values only refer to its hash.
+// Replay stops at the first incomplete or corrupted record (e.g. the process
+// died while appending it), which is then cut off.
+
+#include <cvars/CVar.h>
+#include <cvars/Trie.h>
+#include <cvars/CVarBinaryIO.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <cstdio>
+
+using namespace CVarUtils;
+
+#define CVARS_JOURNAL_SUFFIX ".journal"
+#define CVARS_JOURNAL_OLD_SUFFIX ".journal.1"
+
+const char     CVARS_JOURNAL_MAGIC[8] = { 'C', 'V', 'A', 'R', 'J', 'R', 'N', '\0' };
+const uint32_t CVARS_JOURNAL_VERSION = 1;
+const uint32_t CVARS_JOURNAL_NAME = 1;
+const uint32_t CVARS_JOURNAL_VALUE = 2;
+
+////////////////////////////////////////////////////////////////////////////////
+struct CVarJournalHeader
+{
+    char     m_sMagic[8];
+    uint32_t m_nVersion;
+    uint32_t m_nByteOrder;  ///< CVARS_BINARY_BYTE_ORDER as written by the host
+};
+
+////////////////////////////////////////////////////////////////////////////////
+struct CVarJournalRecord
+{
+    uint64_t m_nNameHash;   ///< HashCVarName of the name
+    uint32_t m_nKind;       ///< CVARS_JOURNAL_NAME or CVARS_JOURNAL_VALUE
+    uint32_t m_nTypeId;     ///< binary snapshot type id of a value
+    uint32_t m_nLength;
+    uint32_t m_nChecksum;   ///< of the other fields and the payload
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static uint32_t RecordChecksum( const CVarJournalRecord& record, const char* pData )
+{
+    uint64_t nHash = HashCVarName( pData, record.m_nLength, record.m_nNameHash );
+    nHash = HashCVarName( (const char*)&record.m_nKind, 3 * sizeof( uint32_t ), nHash );
+    return (uint32_t)( nHash ^ ( nHash >> 32 ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void AppendRecord( std::string& sOut, uint32_t nKind, uint64_t nNameHash, uint32_t nTypeId,
+                          const std::string& sData )
+{
+    CVarJournalRecord record;
+    record.m_nNameHash = nNameHash;
+    record.m_nKind = nKind;
+    record.m_nTypeId = nTypeId;
+    record.m_nLength = (uint32_t)sData.size();
+    record.m_nChecksum = RecordChecksum( record, sData.data() );
+    sOut.append( (const char*)&record, sizeof( record ) );
+    sOut.append( sData );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Applies the records of a journal and sets nValid to the size of its valid
+// part, 0 if it is missing.  False if it is not a journal of this host.
+static bool ReplayJournal( const std::string& sFileName, Trie &rTrie, size_t& nValid )
+{
+    nValid = 0;
+    std::ifstream sIn( sFileName.c_str(), std::ios::in | std::ios::binary );
+    if( !sIn.is_open() ) {
+        return true;
+    }
+    std::string sBuf( ( std::istreambuf_iterator<char>( sIn ) ), std::istreambuf_iterator<char>() );
+    CVarJournalHeader header;
+    if( sBuf.size() < sizeof( header ) ) {
+        // died while starting it
+        return true;
+    }
+    memcpy( &header, sBuf.data(), sizeof( header ) );
+    if( memcmp( header.m_sMagic, CVARS_JOURNAL_MAGIC, sizeof( header.m_sMagic ) ) != 0 ||
+        header.m_nVersion != CVARS_JOURNAL_VERSION || header.m_nByteOrder != CVARS_BINARY_BYTE_ORDER ) {
+        std::cerr << "ERROR: \"" << sFileName << "\" is not a CVars journal of this host." << std::endl;
+        return false;
+    }
+
+    std::unordered_map< uint64_t, std::string > mNames;
+    size_t nPos = sizeof( header );
+    while( nPos + sizeof( CVarJournalRecord ) <= sBuf.size() ) {
+        CVarJournalRecord record;
+        memcpy( &record, sBuf.data() + nPos, sizeof( record ) );
+        const char* pData = sBuf.data() + nPos + sizeof( record );
+        if( record.m_nLength > sBuf.size() - nPos - sizeof( record ) ||
+            RecordChecksum( record, pData ) != record.m_nChecksum ) {
+            break;
+        }
+        nPos += sizeof( record ) + record.m_nLength;
+
+        if( record.m_nKind == CVARS_JOURNAL_NAME ) {
+            mNames[ record.m_nNameHash ].assign( pData, record.m_nLength );
+            continue;
+        }
+        std::unordered_map< uint64_t, std::string >::iterator it = mNames.find( record.m_nNameHash );
+        if( record.m_nKind != CVARS_JOURNAL_VALUE || it == mNames.end() ) {
+            continue;
+        }
+        const std::string& sName = it->second;
+        CVar<int>* pCVar = (CVar<int>*)rTrie.FindDataByHash( record.m_nNameHash, sName.data(), sName.size() );
+        if( pCVar == NULL ) {
+            rTrie.SetPendingValue( sName, record.m_nTypeId, pData, record.m_nLength );
+        }
+        else if( pCVar->IsDerived() ) {
+            // read only, never journaled
+        }
+        else if( record.m_nTypeId == CVARS_BINARY_TEXT ) {
+            pCVar->SetValueFromString( std::string( pData, record.m_nLength ) );
+        }
+        else if( !pCVar->SetValueFromBinary( record.m_nTypeId, pData, record.m_nLength ) ) {
+            std::cerr << "WARNING: " << sName << " in CVars journal has type 0x" << std::hex
+                      << record.m_nTypeId << std::dec << " not matching the CVar, ignoring." << std::endl;
+        }
+    }
+    if( nPos < sBuf.size() ) {
+        std::cerr << "WARNING: ignoring " << sBuf.size() - nPos << " bytes of incomplete records at the end of \""
+                  << sFileName << "\"." << std::endl;
+    }
+    nValid = nPos;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The journal being appended to.
+class CVarJournal
+{
+public:
+    CVarJournal() : m_nCompactBytes( 0 ), m_nBytes( 0 ), m_nBatch( 0 ) {}
+
+    bool Open( const std::string& sFileName, size_t nCompactBytes ) {
+        Trie& trie = TrieInstance();
+        Close();
+        WaitForAsyncSaves();
+        trie.SetVerbose( false );
+        trie.SetAcceptedSubstrings( std::vector<std::string>() );
+        LoadBinarySnapshot( sFileName, trie );
+        const std::string sJournal = sFileName + CVARS_JOURNAL_SUFFIX;
+        size_t nValid;
+        if( !ReplayJournal( sFileName + CVARS_JOURNAL_OLD_SUFFIX, trie, nValid ) ||
+            !ReplayJournal( sJournal, trie, nValid ) ) {
+            // left untouched
+            return false;
+        }
+
+        std::error_code error;
+        if( nValid == 0 ) {
+            std::filesystem::remove( sJournal, error );
+        }
+        else if( nValid < std::filesystem::file_size( sJournal, error ) ) {
+            std::filesystem::resize_file( sJournal, nValid, error );
+        }
+        m_sFileName = sFileName;
+        m_nCompactBytes = nCompactBytes;
+        if( !Start() ) {
+            return false;
+        }
+        trie.m_bJournaling = true;
+        return true;
+    }
+
+    void Close() {
+        TrieInstance().m_bJournaling = false;
+        if( m_Out.is_open() ) {
+            m_Out.close();
+        }
+        m_mNamed.clear();
+    }
+
+    void Append( CVar<int>* pCVar ) {
+        const uint64_t nHash = HashCVarName( pCVar->m_sVarName );
+        m_sRecords.clear();
+        std::unordered_map< uint64_t, void* >::iterator it = m_mNamed.find( nHash );
+        if( it == m_mNamed.end() || it->second != pCVar ) {
+            AppendRecord( m_sRecords, CVARS_JOURNAL_NAME, nHash, 0, pCVar->m_sVarName );
+            m_mNamed[ nHash ] = pCVar;
+        }
+        m_sValue.clear();
+        uint32_t nTypeId = pCVar->GetValueAsBinary( m_sValue );
+        if( nTypeId == CVARS_BINARY_TEXT ) {
+            m_sValue = pCVar->GetValueAsString();
+        }
+        AppendRecord( m_sRecords, CVARS_JOURNAL_VALUE, nHash, nTypeId, m_sValue );
+
+        m_Out.write( m_sRecords.data(), m_sRecords.size() );
+        if( m_nBatch == 0 ) {
+            m_Out.flush();
+        }
+        if( !m_Out ) {
+            std::cerr << "ERROR writing to the CVars journal \"" << m_sFileName << CVARS_JOURNAL_SUFFIX
+                      << "\", journaling stopped." << std::endl;
+            Close();
+            return;
+        }
+        m_nBytes += m_sRecords.size();
+        if( m_nBatch == 0 && m_nBytes > m_nCompactBytes ) {
+            Compact();
+        }
+    }
+
+    void BeginBatch() {
+        m_nBatch++;
+    }
+
+    void EndBatch() {
+        if( --m_nBatch > 0 || !m_Out.is_open() ) {
+            return;
+        }
+        m_Out.flush();
+        if( !m_Out ) {
+            std::cerr << "ERROR writing to the CVars journal \"" << m_sFileName << CVARS_JOURNAL_SUFFIX
+                      << "\", journaling stopped." << std::endl;
+            Close();
+            return;
+        }
+        if( m_nBytes > m_nCompactBytes ) {
+            Compact();
+        }
+    }
+
+    // Starts a new journal and writes the snapshot in the background, false
+    // if a compaction is still running or a batch is open (SaveAsync sets
+    // the filters of the Trie, which a Load in progress uses).
+    bool Compact() {
+        if( m_nBatch > 0 ) {
+            return false;
+        }
+        if( m_Compaction.valid() ) {
+            if( m_Compaction.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready ) {
+                return false;
+            }
+            m_Compaction.get();
+        }
+        Trie& trie = TrieInstance();
+        const std::string sJournal = m_sFileName + CVARS_JOURNAL_SUFFIX;
+        const std::string sOldJournal = m_sFileName + CVARS_JOURNAL_OLD_SUFFIX;
+        m_Out.close();
+        std::ifstream sOld( sOldJournal.c_str() );
+        if( sOld.is_open() ) {
+            // the previous compaction failed, its records still count
+            sOld.close();
+            std::ifstream sIn( sJournal.c_str(), std::ios::in | std::ios::binary );
+            std::ofstream sOut( sOldJournal.c_str(), std::ios::out | std::ios::binary | std::ios::app );
+            sIn.seekg( sizeof( CVarJournalHeader ) );
+            sOut << sIn.rdbuf();
+            sOut.close();
+            if( !sOut ) {
+                std::cerr << "ERROR compacting the CVars journal \"" << sJournal << "\"." << std::endl;
+                return Reopen();
+            }
+            std::remove( sJournal.c_str() );
+        }
+        else if( std::rename( sJournal.c_str(), sOldJournal.c_str() ) != 0 ) {
+            std::cerr << "ERROR compacting the CVars journal \"" << sJournal << "\"." << std::endl;
+            return Reopen();
+        }
+        if( !Start() ) {
+            return false;
+        }
+        // values of CVars not created yet are not in the snapshot
+        const std::unordered_map< std::string, CVarPendingValue >& mPending = trie.GetPendingValues();
+        for( std::unordered_map< std::string, CVarPendingValue >::const_iterator it = mPending.begin();
+             it != mPending.end(); ++it ) {
+            const uint64_t nHash = HashCVarName( it->first );
+            m_sRecords.clear();
+            AppendRecord( m_sRecords, CVARS_JOURNAL_NAME, nHash, 0, it->first );
+            AppendRecord( m_sRecords, CVARS_JOURNAL_VALUE, nHash, it->second.m_nTypeId, it->second.m_sValue );
+            m_Out.write( m_sRecords.data(), m_sRecords.size() );
+            m_nBytes += m_sRecords.size();
+        }
+        m_Out.flush();
+
+        // the snapshot holds every value journaled so far
+        const CVARS_STREAM_TYPE streamType = trie.GetStreamType();
+        trie.SetStreamType( CVARS_BINARY_STREAM );
+        m_Compaction = SaveAsync( m_sFileName, std::vector<std::string>(),
+                                  [sOldJournal]( bool bSaved, const std::string& ) {
+                                      if( bSaved ) {
+                                          std::remove( sOldJournal.c_str() );
+                                      }
+                                  } );
+        trie.SetStreamType( streamType );
+        return true;
+    }
+
+private:
+    // opens a new, empty journal
+    bool Start() {
+        m_Out.open( ( m_sFileName + CVARS_JOURNAL_SUFFIX ).c_str(), std::ios::out | std::ios::binary | std::ios::app );
+        if( !m_Out.is_open() ) {
+            std::cerr << "ERROR opening the CVars journal \"" << m_sFileName << CVARS_JOURNAL_SUFFIX << "\"." << std::endl;
+            Close();
+            return false;
+        }
+        m_mNamed.clear();
+        m_Out.seekp( 0, std::ios::end );
+        m_nBytes = m_Out.tellp();
+        if( m_nBytes == 0 ) {
+            CVarJournalHeader header;
+            memcpy( header.m_sMagic, CVARS_JOURNAL_MAGIC, sizeof( header.m_sMagic ) );
+            header.m_nVersion = CVARS_JOURNAL_VERSION;
+            header.m_nByteOrder = CVARS_BINARY_BYTE_ORDER;
+            m_Out.write( (const char*)&header, sizeof( header ) );
+            m_Out.flush();
+            m_nBytes = sizeof( header );
+        }
+        return true;
+    }
+
+    // keeps appending to the current journal after a failed compaction
+    bool Reopen() {
+        const size_t nBytes = m_nBytes;
+        std::unordered_map< uint64_t, void* > mNamed;
+        mNamed.swap( m_mNamed );
+        if( !Start() ) {
+            return false;
+        }
+        m_mNamed.swap( mNamed );
+        m_nBytes = nBytes;
+        return false;
+    }
+
+    std::string                           m_sFileName;
+    std::ofstream                         m_Out;
+    size_t                                m_nCompactBytes;
+    size_t                                m_nBytes;
+    int                                   m_nBatch;   // open BeginJournalBatch calls
+    std::unordered_map< uint64_t, void* > m_mNamed;   // CVars named in this journal, by name hash
+    std::string                           m_sRecords;
+    std::string                           m_sValue;
+    std::future<bool>                     m_Compaction;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static CVarJournal& JournalInstance()
+{
+    static CVarJournal journal;
+    return journal;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AppendToJournal( void* pCVar )
+{
+    CVar<int>* pChanged = (CVar<int>*)pCVar;
+    if( pChanged->m_bSerialise ) {
+        JournalInstance().Append( pChanged );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BeginJournalBatch()
+{
+    JournalInstance().BeginBatch();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void EndJournalBatch()
+{
+    JournalInstance().EndBatch();
+}
+
+namespace CVarUtils
+{
+    ////////////////////////////////////////////////////////////////////////////////
+    bool OpenJournal( const std::string& sFileName, size_t nCompactBytes )
+    {
+        return JournalInstance().Open( sFileName, nCompactBytes );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    bool CompactJournal()
+    {
+        if( !TrieInstance().m_bJournaling ) {
+            return false;
+        }
+        return JournalInstance().Compact();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void CloseJournal()
+    {
+        JournalInstance().Close();
+    }
+}
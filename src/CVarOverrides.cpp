@@ -0,0 +1,181 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Overrides given at startup: ApplyArgs and ApplyEnvironment collect all the
+// "name=value" pairs first, then set the CVars in one pass, by name hash
+// rather than through ProcessCommand.
+
+#include <cvars/config.h>
+#include <cvars/CVar.h>
+#include <cvars/Trie.h>
+
+#include <cctype>
+#include <cstring>
+#include <unordered_map>
+
+#ifdef _WIN_
+#include <stdlib.h>
+#elif defined( __APPLE__ )
+#include <crt_externs.h>
+#else
+extern char** environ;
+#endif
+
+using namespace CVarUtils;
+
+////////////////////////////////////////////////////////////////////////////////
+struct CVarOverride
+{
+    std::string m_sName;
+    std::string m_sValue;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static std::string TrimSpaces( const char* pBegin, const char* pEnd )
+{
+    while( pBegin < pEnd && isspace( (unsigned char)*pBegin ) ) {
+        pBegin++;
+    }
+    while( pEnd > pBegin && isspace( (unsigned char)pEnd[-1] ) ) {
+        pEnd--;
+    }
+    return std::string( pBegin, pEnd );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Splits "name=value", false if there is no '=' or no name.
+static bool ParseOverride( const char* sArg, CVarOverride& override )
+{
+    const char* pEqual = strchr( sArg, '=' );
+    if( pEqual == NULL ) {
+        return false;
+    }
+    override.m_sName = TrimSpaces( sArg, pEqual );
+    override.m_sValue = TrimSpaces( pEqual + 1, pEqual + strlen( pEqual ) );
+    return !override.m_sName.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sets pCVar from an override, false (with a warning) for console functions,
+// typed commands and derived CVars.
+static bool ApplyOverride( CVar<int>* pCVar, const std::string& sValue )
+{
+    if( IsConsoleFunc( pCVar ) ) {
+        std::cerr << "WARNING: " << pCVar->m_sVarName << " is a function, ignoring its override." << std::endl;
+        return false;
+    }
+    if( pCVar->IsDerived() ) {
+        std::cerr << "WARNING: " << pCVar->m_sVarName << " is derived, ignoring its override." << std::endl;
+        return false;
+    }
+    pCVar->SetValueFromString( sValue );
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static char** GetEnvironment()
+{
+#ifdef _WIN_
+    return _environ;
+#elif defined( __APPLE__ )
+    return *_NSGetEnviron();
+#else
+    return environ;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string EnvironmentName( const std::string& sCVarName )
+{
+    std::string sName( sCVarName );
+    for( size_t ii = 0; ii < sName.size(); ii++ ) {
+        sName[ii] = sName[ii] == '.' ? '_' : (char)toupper( (unsigned char)sName[ii] );
+    }
+    return sName;
+}
+
+namespace CVarUtils
+{
+    ////////////////////////////////////////////////////////////////////////////////
+    size_t ApplyArgs( int argc, const char* const* argv )
+    {
+        std::vector<CVarOverride> vOverrides;
+        CVarOverride override;
+        for( int ii = 1; ii < argc; ii++ ) {
+            const char* sArg = argv[ii];
+            if( sArg[0] == '+' ) {
+                sArg++;
+            }
+            else if( strncmp( sArg, "--cvar=", 7 ) == 0 ) {
+                sArg += 7;
+            }
+            else if( strcmp( sArg, "--cvar" ) == 0 && ii + 1 < argc ) {
+                sArg = argv[++ii];
+            }
+            else {
+                continue;
+            }
+            if( ParseOverride( sArg, override ) ) {
+                vOverrides.push_back( override );
+            }
+            else {
+                std::cerr << "WARNING: ignoring CVar override \"" << sArg << "\", expected name=value." << std::endl;
+            }
+        }
+
+        Trie& trie = TrieInstance();
+        for( size_t ii = 0; ii < vOverrides.size(); ii++ ) {
+            const std::string& sName = vOverrides[ii].m_sName;
+            CVar<int>* pCVar = (CVar<int>*)trie.FindDataByHash( HashCVarName( sName ), sName.data(), sName.size() );
+            if( pCVar != NULL ) {
+                ApplyOverride( pCVar, vOverrides[ii].m_sValue );
+            }
+            else {
+                trie.SetPendingArgValue( sName, vOverrides[ii].m_sValue );
+            }
+        }
+        return vOverrides.size();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    size_t ApplyEnvironment( const std::string& sPrefix )
+    {
+        std::vector<CVarOverride> vOverrides;
+        CVarOverride override;
+        for( char** pVar = GetEnvironment(); pVar != NULL && *pVar != NULL; pVar++ ) {
+            if( strncmp( *pVar, sPrefix.c_str(), sPrefix.size() ) == 0 &&
+                ParseOverride( *pVar + sPrefix.size(), override ) ) {
+                override.m_sName = EnvironmentName( override.m_sName );
+                vOverrides.push_back( override );
+            }
+        }
+        if( vOverrides.empty() ) {
+            return 0;
+        }
+
+        // the CVars by environment name, the first created wins
+        Trie& trie = TrieInstance();
+        const std::vector<void*>& vCVars = trie.GetAllCVars();
+        std::unordered_map< std::string, void* > mCVars;
+        mCVars.reserve( vCVars.size() );
+        for( size_t ii = 0; ii < vCVars.size(); ii++ ) {
+            mCVars.insert( std::make_pair( EnvironmentName( ((CVar<int>*)vCVars[ii])->m_sVarName ), vCVars[ii] ) );
+        }
+
+        for( size_t ii = 0; ii < vOverrides.size(); ii++ ) {
+            std::unordered_map< std::string, void* >::const_iterator it = mCVars.find( vOverrides[ii].m_sName );
+            if( it != mCVars.end() ) {
+                ApplyOverride( (CVar<int>*)it->second, vOverrides[ii].m_sValue );
+            }
+            else {
+                trie.SetPendingEnvironmentValue( vOverrides[ii].m_sName, vOverrides[ii].m_sValue );
+            }
+        }
+        return vOverrides.size();
+    }
+}
@@ -9,6 +9,11 @@
  */
 
 #include <cvars/CVar.h>
+#include <cvars/CVarBinaryIO.h>
+#include <cvars/CVarCommand.h>
+
+#include <algorithm>
+#include <typeinfo>
 
 using namespace CVarUtils;
 
@@ -27,167 +32,344 @@ std::string& _RemoveSpaces( std::string &str )
 namespace CVarUtils 
 {
     ////////////////////////////////////////////////////////////////////////////////
-    bool ProcessCommand( 
-            const std::string& sCommand, 
+    static inline bool _IsBlank( char c )
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    static std::string_view _TrimBlanks( std::string_view s )
+    {
+        while( !s.empty() && _IsBlank( s.front() ) ) {
+            s.remove_prefix( 1 );
+        }
+        while( !s.empty() && _IsBlank( s.back() ) ) {
+            s.remove_suffix( 1 );
+        }
+        return s;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    bool NextCommand( std::string_view& sLine, std::string_view& sCommand )
+    {
+        size_t nBegin = 0;
+        while( nBegin < sLine.size() && _IsBlank( sLine[nBegin] ) ) {
+            nBegin++;
+        }
+        if( nBegin == sLine.size() ) {
+            sLine = std::string_view();
+            return false;
+        }
+        char cQuote = 0;
+        size_t nEnd = nBegin;
+        for( ; nEnd < sLine.size(); nEnd++ ) {
+            const char c = sLine[nEnd];
+            if( c == '\\' && cQuote == '"' ) {
+                nEnd++;
+            }
+            else if( cQuote ) {
+                cQuote = c == cQuote ? 0 : cQuote;
+            }
+            else if( c == '"' || c == '\'' ) {
+                cQuote = c;
+            }
+            else if( c == ';' ) {
+                break;
+            }
+        }
+        nEnd = std::min( nEnd, sLine.size() );
+        sCommand = _TrimBlanks( sLine.substr( nBegin, nEnd - nBegin ) );
+        sLine.remove_prefix( nEnd < sLine.size() ? nEnd + 1 : nEnd );
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    bool NextCommandWord( std::string_view& sText, std::string_view& sWord, std::string& sUnescaped )
+    {
+        size_t nBegin = 0;
+        while( nBegin < sText.size() && _IsBlank( sText[nBegin] ) ) {
+            nBegin++;
+        }
+        if( nBegin == sText.size() ) {
+            sText = std::string_view();
+            return false;
+        }
+        char cQuote = 0;
+        size_t nQuoted = 0;
+        bool bEscaped = false;
+        size_t nEnd = nBegin;
+        for( ; nEnd < sText.size(); nEnd++ ) {
+            const char c = sText[nEnd];
+            if( c == '\\' && cQuote == '"' ) {
+                bEscaped = true;
+                nEnd++;
+            }
+            else if( cQuote ) {
+                cQuote = c == cQuote ? 0 : cQuote;
+            }
+            else if( c == '"' || c == '\'' ) {
+                cQuote = c;
+                nQuoted++;
+            }
+            else if( _IsBlank( c ) ) {
+                break;
+            }
+        }
+        nEnd = std::min( nEnd, sText.size() );
+        const std::string_view sRaw = sText.substr( nBegin, nEnd - nBegin );
+        sText.remove_prefix( nEnd );
+
+        if( !bEscaped && nQuoted == 0 ) {
+            sWord = sRaw;
+            return true;
+        }
+        if( !bEscaped && nQuoted == 1 && sRaw.size() >= 2 &&
+            ( sRaw.front() == '"' || sRaw.front() == '\'' ) && sRaw.back() == sRaw.front() ) {
+            sWord = sRaw.substr( 1, sRaw.size() - 2 );
+            return true;
+        }
+
+        // room for all the words left, so the ones taken before stay valid
+        if( sUnescaped.capacity() < sUnescaped.size() + sRaw.size() + sText.size() ) {
+            sUnescaped.reserve( sUnescaped.size() + sRaw.size() + sText.size() );
+        }
+        const size_t nStart = sUnescaped.size();
+        cQuote = 0;
+        for( size_t ii = 0; ii < sRaw.size(); ii++ ) {
+            const char c = sRaw[ii];
+            if( c == '\\' && cQuote == '"' && ii + 1 < sRaw.size() ) {
+                const char e = sRaw[++ii];
+                sUnescaped += e == 'n' ? '\n' : e == 't' ? '\t' : e;
+            }
+            else if( cQuote && c == cQuote ) {
+                cQuote = 0;
+            }
+            else if( !cQuote && ( c == '"' || c == '\'' ) ) {
+                cQuote = c;
+            }
+            else {
+                sUnescaped += c;
+            }
+        }
+        sWord = std::string_view( sUnescaped ).substr( nStart );
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    size_t SplitCommandArgs( std::string_view sArgs, std::string_view* pArgs, size_t nMaxArgs,
+                             std::string& sUnescaped )
+    {
+        size_t nArgs = 0;
+        std::string_view sWord;
+        while( NextCommandWord( sArgs, sWord, sUnescaped ) ) {
+            if( nArgs < nMaxArgs ) {
+                pArgs[ nArgs ] = sWord;
+            }
+            nArgs++;
+        }
+        return nArgs;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Calls the function cvar with the arguments following its name.
+    static bool _ExecuteFunctionArgs(
+            CVarUtils::CVar<ConsoleFunc> *cvar,
+            std::string_view sArgs,
             std::string& sResult,
-            bool bExecute                       //< Input:
+            bool bExecute
             )
     {
-        Trie& trie = TrieInstance();
+        if( cvar->TypeInfo() == typeid( CVarCommand ) ) {
+            if( !bExecute ) {
+                return true;
+            }
+            const CVarCommand& command = *(CVarCommand*)cvar->m_pVarData;
+            std::string sError;
+            if( !(*command.m_pInvoke)( command.m_pFunc, sArgs, sError ) ) {
+                if( !sError.empty() ) {
+                    sResult = cvar->m_sVarName + ": " + sError + " (usage: " + command.m_sUsage + ")";
+                }
+                return false;
+            }
+            return true;
+        }
 
-        TrieNode*node;
         bool bSuccess = true;
-        std::string sCmd = sCommand;
+        ConsoleFunc func = *(cvar->m_pVarData);
 
-        // remove leading and trailing spaces
-        int pos = sCmd.find_first_not_of( " ", 0 );
-        if( pos >= 0 ) {
-            sCmd = sCmd.substr( pos );
+        //parse arguments into a list of strings
+        std::vector<std::string> argslist;
+        std::string sUnescaped;
+        std::string_view sWord;
+        while( NextCommandWord( sArgs, sWord, sUnescaped ) ) {
+            argslist.push_back( std::string( sWord ) );
         }
-        pos = sCmd.find_last_not_of( " " );
-        if( pos >= 0 ) {
-            sCmd= sCmd.substr( 0, pos+1 );
+
+        if( bExecute ) {
+            const bool res = (*func)( &argslist );
+            if( !res ) {
+                bSuccess = false;
+            }
         }
 
+        return bSuccess;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // One command of a console line: "name", "name = value" or "name args".
+    static bool _ProcessSingleCommand(
+            Trie& trie,
+            std::string_view sCmd,
+            std::string& sResult,
+            bool bExecute
+            )
+    {
+        bool bSuccess = true;
+
+        // the name runs up to a blank or '='
+        size_t nName = 0;
+        while( nName < sCmd.size() && !_IsBlank( sCmd[nName] ) && sCmd[nName] != '=' ) {
+            nName++;
+        }
+        const std::string_view sName = sCmd.substr( 0, nName );
+        const std::string_view sRest = _TrimBlanks( sCmd.substr( nName ) );
+        CVar<int>* pCVar = (CVar<int>*)trie.FindDataByHash( HashCVarName( sName.data(), sName.size() ),
+                                                            sName.data(), sName.size() );
+
         // Simply print value if the command is just a variable
-        if( ( node = trie.Find( sCmd ) ) ) {
+        if( sRest.empty() ) {
+            if( pCVar == NULL ) {
+                if( bExecute ) {
+                    sResult = std::string( sName ) + ": command not found";
+                }
+                bSuccess = false;
+            }
             //execute function if this is a function cvar
-            if( IsConsoleFunc( node ) ) {
-                bSuccess &= ExecuteFunction( 
-                        sCmd,
-                        (CVarUtils::CVar<ConsoleFunc>*)node->m_pNodeData,
-                        sResult,
-                        bExecute
-                        );
+            else if( IsConsoleFunc( pCVar ) ) {
+                bSuccess &= _ExecuteFunctionArgs( (CVar<ConsoleFunc>*)pCVar, sRest, sResult, bExecute );
             }
             else { //print value associated with this cvar
-                sResult = GetValueAsString(node->m_pNodeData).c_str();
+                sResult = pCVar->GetValueAsString();
             }
         }
-        //see if it is an assignment or a function execution (with arguments)
-        else{
-            int eq_pos; //get the position of the equal sign
-            //see if this an assignment
-            if( ( eq_pos = sCmd.find( "=" ) ) != -1 ) {
-                std::string command, value;
-                std::string tmp = sCmd.substr(0, eq_pos ) ;
-                command = _RemoveSpaces( tmp );
-                value = sCmd.substr( eq_pos+1, sCmd.length() );
-                if( !value.empty() ) {
-                    value = _RemoveSpaces( value );
-                    if( ( node = trie.Find(command) ) ) {
-                        if( bExecute ) {
-                            SetValueFromString( node->m_pNodeData, value );
-                        }
-                        sResult = GetValueAsString(node->m_pNodeData).c_str();
-                    }
-                    else {
-                        sResult = command + ": variable not found";
-                        bSuccess = false;
-                    }
-                }
-                else {
-                    if( bExecute ) {
-                        sResult = command + ": command not found";
-                    }
-                    bSuccess = false;
+        //see if this an assignment
+        else if( sRest[0] == '=' ) {
+            std::string_view sValue = _TrimBlanks( sRest.substr( 1 ) );
+            if( sValue.empty() ) {
+                if( bExecute ) {
+                    sResult = std::string( sName ) + ": command not found";
                 }
+                bSuccess = false;
             }
-            //check if this is a function
-            else if( ( eq_pos = sCmd.find(" ") ) != -1 ) {
-                std::string function;
-                std::string args;
-                function = sCmd.substr( 0, eq_pos );
-                //check if this is a valid function name
-                if( ( node = trie.Find( function ) ) && IsConsoleFunc( node ) ) {
-                    bSuccess &= ExecuteFunction( 
-                            sCmd,
-                            ( CVar<ConsoleFunc>*)node->m_pNodeData,
-                            sResult,
-                            bExecute
-                            );
-                }
-                else {
-                    if( bExecute ) {
-                        sResult = function + ": function not found";
-                    }
-                    bSuccess = false;
-                }
+            else if( pCVar == NULL ) {
+                sResult = std::string( sName ) + ": variable not found";
+                bSuccess = false;
             }
-            else if( !sCmd.empty() ) {
+            else if( pCVar->IsDerived() ) {
+                sResult = std::string( sName ) + ": derived variable, read only";
+                bSuccess = false;
+            }
+            else {
+                // a single quoted word is unquoted, anything else (e.g.
+                // "1 2 3" or C:\data) is the value as typed
+                std::string sUnescaped;
+                std::string_view sText = sValue, sWord;
+                if( NextCommandWord( sText, sWord, sUnescaped ) && _TrimBlanks( sText ).empty() ) {
+                    sValue = sWord;
+                }
                 if( bExecute ) {
-                    sResult = sCmd + ": command not found";
+                    pCVar->SetValueFromString( std::string( sValue ) );
                 }
-                bSuccess = false;
+                sResult = pCVar->GetValueAsString();
             }
         }
+        //check if this is a function
+        else if( pCVar != NULL && IsConsoleFunc( pCVar ) ) {
+            bSuccess &= _ExecuteFunctionArgs( (CVar<ConsoleFunc>*)pCVar, sRest, sResult, bExecute );
+        }
+        else {
+            if( bExecute ) {
+                sResult = std::string( sName ) + ": function not found";
+            }
+            bSuccess = false;
+        }
+
         if( sResult == "" && bSuccess == false ){
-            sResult = sCmd + ": command not found";
+            sResult = std::string( sCmd ) + ": command not found";
         }
         return bSuccess;
     }
 
-
     ////////////////////////////////////////////////////////////////////////////////
-    /// Parses the argument list and calls the function object associated with the
-    //  provided variable.
-    bool ExecuteFunction( 
-            const std::string& sCommand,         //< Input:
-            CVarUtils::CVar<ConsoleFunc> *cvar,  //< Input:
-            std::string& ,                //< Output:
-            bool bExecute                        //< Input:
+    bool ProcessCommand( 
+            const std::string& sCommand, 
+            std::string& sResult,
+            bool bExecute                       //< Input:
             )
     {
-        std::vector<std::string> argslist;
-        std::string args;
-        bool bSuccess = true;
-        ConsoleFunc func = *(cvar->m_pVarData);
-        std::string sCmd = sCommand;
+        Trie& trie = TrieInstance();
 
-        //extract arguments string
-        int pos = sCmd.find( " " );
-        if( pos != -1 ) {
-            args = sCmd.substr(pos+1, sCmd.length() - pos);
-        }
-        //parse arguments into a list of strings
-        if( args.length() > 0 ) {
-            while( ( pos = args.find(" ") ) != -1 ) {
-                argslist.push_back(args.substr(0, pos));
-                args = args.substr(pos+1, args.length() - pos);
+        bool bSuccess = true;
+        bool bFirst = true;
+        std::string_view sLine( sCommand ), sCmd;
+        std::string sCmdResult;
+        while( NextCommand( sLine, sCmd ) ) {
+            if( sCmd.empty() ) {
+                continue;
             }
-            if( args.length() > 0 ) {
-                argslist.push_back(args);
+            if( bFirst ) {
+                bSuccess &= _ProcessSingleCommand( trie, sCmd, sResult, bExecute );
+                bFirst = false;
+                continue;
             }
-        }
-
-        if( bExecute ) {
-            const bool res = (*func)( &argslist );
-            if( !res ) {
-                bSuccess = false;
+            // the results of the following commands go on lines of their own
+            sCmdResult.clear();
+            bSuccess &= _ProcessSingleCommand( trie, sCmd, sCmdResult, bExecute );
+            if( !sCmdResult.empty() ) {
+                if( !sResult.empty() ) {
+                    sResult += '\n';
+                }
+                sResult += sCmdResult;
             }
         }
-
         return bSuccess;
     }
 
+    ////////////////////////////////////////////////////////////////////////////////
+    /// Parses the argument list and calls the function object associated with the
+    //  provided variable (a ConsoleFunc or a CVarCommand).
+    bool ExecuteFunction( 
+            const std::string& sCommand,         //< Input:
+            CVarUtils::CVar<ConsoleFunc> *cvar,  //< Input:
+            std::string& sResult,                //< Output:
+            bool bExecute                        //< Input:
+            )
+    {
+        // skip the function name
+        std::string_view sArgs( sCommand ), sName;
+        std::string sUnescaped;
+        NextCommandWord( sArgs, sName, sUnescaped );
+        return _ExecuteFunctionArgs( cvar, sArgs, sResult, bExecute );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    bool IsConsoleFunc( CVar<int>* pCVar )
+    {
+        const std::type_info& type = pCVar->TypeInfo();
+        return type == typeid( ConsoleFunc ) || type == typeid( CVarCommand );
+    }
 
     ////////////////////////////////////////////////////////////////////////////////
     bool IsConsoleFunc( TrieNode *node )
     {
-        if( typeid( ConsoleFunc ).name() == ((CVar<int>*)node->m_pNodeData)->type() ) {
-            return true;
-        }
-        return false; 
+        return IsConsoleFunc( (CVar<int>*)node->m_pNodeData );
     }
 
     ////////////////////////////////////////////////////////////////////////////////
     bool IsConsoleFunc( const std::string sCmd ) {
         TrieNode* pNode = TrieInstance().Find( sCmd );
         if( pNode == NULL ) { return false; }
-        if( typeid( ConsoleFunc ).name() == ((CVar<int>*)pNode->m_pNodeData)->type() ) {
-            return true;
-        }
-        return false; 
+        return IsConsoleFunc( pNode );
     }
 
     ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,151 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Named presets: the values a settings file sets, read once into a snapshot
+// (see CVarSnapshot.cpp).  Switching to a preset only writes the CVars whose
+// value differs from it, without reading the file again.  Every CVar of the
+// preset is compared: a CVar may have been written through its reference
+// since the previous switch without being notified.
+
+#include <cvars/CVar.h>
+#include <cvars/Trie.h>
+
+#include <algorithm>
+#include <map>
+
+using namespace CVarUtils;
+
+////////////////////////////////////////////////////////////////////////////////
+struct CVarPresets
+{
+    std::map< std::string, CVarSnapshot > m_mPresets;
+    std::string                           m_sActive;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static CVarPresets& PresetsInstance()
+{
+    static CVarPresets presets;
+    return presets;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reads sFileName into the CVars as Load does, without the delta and the
+// file records: the values only stay until the preset is copied.
+static bool ReadPresetFile( const std::string& sFileName, Trie& trie )
+{
+    switch( trie.GetStreamType() ) {
+        case CVARS_BINARY_STREAM:
+            return LoadBinarySnapshot( sFileName, trie );
+        case CVARS_TXT_STREAM:
+            return LoadTXTFile( sFileName, trie );
+        case CVARS_JSON_STREAM:
+            return LoadJSONFile( sFileName, trie );
+        default:
+            break;
+    }
+    std::ifstream sIn( sFileName.c_str() );
+    if( !sIn.is_open() ) {
+        return false;
+    }
+    sIn >> trie;
+    return true;
+}
+
+namespace CVarUtils
+{
+    ////////////////////////////////////////////////////////////////////////////////
+    bool RegisterPreset( const std::string& sName, const std::string& sFileName,
+                         std::vector<std::string> vAcceptedSubstrings )
+    {
+        Trie& trie = TrieInstance();
+        // the file may still be being written by a SaveAsync
+        WaitForAsyncSaves();
+        // the values to put back once the file set the preset ones
+        CVarSnapshot current;
+        const std::vector<void*>& vAllCVars = trie.GetAllCVars();
+        for( size_t ii = 0; ii < vAllCVars.size(); ii++ ) {
+            current.Add( vAllCVars[ii] );
+        }
+
+        std::vector<void*> vSet;
+        trie.SetVerbose( false );
+        trie.SetAcceptedSubstrings( vAcceptedSubstrings );
+        trie.m_bHoldNotifications = true;
+        trie.m_pChangeLog = &vSet;
+        bool bRead = false;
+        try {
+            bRead = ReadPresetFile( sFileName, trie );
+        }
+        catch( ... ) {
+            trie.m_pChangeLog = NULL;
+            RestoreSnapshot( current );
+            trie.m_bHoldNotifications = false;
+            throw;
+        }
+        trie.m_pChangeLog = NULL;
+
+        CVarSnapshot preset;
+        std::sort( vSet.begin(), vSet.end() );
+        vSet.erase( std::unique( vSet.begin(), vSet.end() ), vSet.end() );
+        for( size_t ii = 0; ii < vSet.size(); ii++ ) {
+            preset.Add( vSet[ii] );
+        }
+        RestoreSnapshot( current );
+        trie.m_bHoldNotifications = false;
+
+        if( !bRead ) {
+            std::cerr << "ERROR: could not read preset \"" << sName << "\" from \""
+                      << sFileName << "\"." << std::endl;
+            return false;
+        }
+        RegisterPreset( sName, std::move( preset ) );
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void RegisterPreset( const std::string& sName, CVarSnapshot&& snapshot )
+    {
+        CVarPresets& presets = PresetsInstance();
+        if( presets.m_sActive == sName ) {
+            presets.m_sActive.clear();
+        }
+        presets.m_mPresets[ sName ] = std::move( snapshot );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    int ApplyPreset( const std::string& sName )
+    {
+        CVarPresets& presets = PresetsInstance();
+        std::map< std::string, CVarSnapshot >::const_iterator it = presets.m_mPresets.find( sName );
+        if( it == presets.m_mPresets.end() ) {
+            return -1;
+        }
+        const size_t nChanged = RestoreSnapshot( it->second );
+        presets.m_sActive = sName;
+        return (int)nChanged;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    std::vector<std::string> GetPresetNames()
+    {
+        const std::map< std::string, CVarSnapshot >& mPresets = PresetsInstance().m_mPresets;
+        std::vector<std::string> vNames;
+        for( std::map< std::string, CVarSnapshot >::const_iterator it = mPresets.begin();
+             it != mPresets.end(); ++it ) {
+            vNames.push_back( it->first );
+        }
+        return vNames;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    const std::string& GetActivePreset()
+    {
+        return PresetsInstance().m_sActive;
+    }
+}
@@ -0,0 +1,187 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// In memory snapshots: TakeSnapshot copies the CVar values in their native
+// form, RestoreSnapshot writes them back, with no formatting or parsing.
+
+#include <cvars/CVar.h>
+#include <cvars/Trie.h>
+
+#include <cstring>
+#include <unordered_map>
+
+namespace CVarUtils
+{
+    ////////////////////////////////////////////////////////////////////////////////
+    CVarSnapshot::CVarSnapshot( CVarSnapshot&& rOther )
+    {
+        *this = std::move( rOther );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    CVarSnapshot& CVarSnapshot::operator=( CVarSnapshot&& rOther )
+    {
+        if( this != &rOther ) {
+            clear();
+            m_vTrivialCVars.swap( rOther.m_vTrivialCVars );
+            m_vOffsets.swap( rOther.m_vOffsets );
+            m_vBytes.swap( rOther.m_vBytes );
+            m_vCopiedCVars.swap( rOther.m_vCopiedCVars );
+            m_vCopies.swap( rOther.m_vCopies );
+            m_vCopyStates.swap( rOther.m_vCopyStates );
+        }
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    CVarSnapshot::~CVarSnapshot()
+    {
+        clear();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void CVarSnapshot::clear()
+    {
+        for( size_t ii = 0; ii < m_vCopies.size(); ii++ ) {
+            ((CVar<int>*)m_vCopiedCVars[ii])->DestroyValueCopy( m_vCopies[ii] );
+        }
+        m_vTrivialCVars.clear();
+        m_vOffsets.clear();
+        m_vBytes.clear();
+        m_vCopiedCVars.clear();
+        m_vCopies.clear();
+        m_vCopyStates.clear();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // State compared by RestoreSnapshot: the type id then the binary form of
+    // the value, empty if the type has none.
+    static void GetCopyState( CVar<int>* pCVar, void* pValue, std::string& sState )
+    {
+        uint32_t nTypeId = 0;
+        sState.assign( (const char*)&nTypeId, sizeof( nTypeId ) );
+        nTypeId = pCVar->FormatValueAsBinary( pValue, sState );
+        if( nTypeId == CVARS_BINARY_TEXT ) {
+            sState.clear();
+        }
+        else {
+            memcpy( &sState[0], &nTypeId, sizeof( nTypeId ) );
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void CVarSnapshot::Add( void* pVoid )
+    {
+        CVar<int>* pCVar = (CVar<int>*)pVoid;
+        const size_t nSize = pCVar->TrivialValueSize();
+        if( nSize > 0 ) {
+            m_vTrivialCVars.push_back( pCVar );
+            m_vOffsets.push_back( m_vBytes.size() );
+            m_vBytes.resize( m_vBytes.size() + nSize );
+            memcpy( &m_vBytes[ m_vOffsets.back() ], pCVar->m_pVarData, nSize );
+        }
+        else {
+            m_vCopiedCVars.push_back( pCVar );
+            m_vCopies.push_back( pCVar->CloneValue() );
+            m_vCopyStates.push_back( std::string() );
+            GetCopyState( pCVar, m_vCopies.back(), m_vCopyStates.back() );
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    CVarSnapshot CVarSnapshot::Difference( const CVarSnapshot& rFrom, const CVarSnapshot& rTo )
+    {
+        std::unordered_map<void*, size_t> mTrivial, mCopied;
+        for( size_t ii = 0; ii < rFrom.m_vTrivialCVars.size(); ii++ ) {
+            mTrivial[ rFrom.m_vTrivialCVars[ii] ] = ii;
+        }
+        for( size_t ii = 0; ii < rFrom.m_vCopiedCVars.size(); ii++ ) {
+            mCopied[ rFrom.m_vCopiedCVars[ii] ] = ii;
+        }
+
+        CVarSnapshot diff;
+        for( size_t ii = 0; ii < rTo.m_vTrivialCVars.size(); ii++ ) {
+            CVar<int>* pCVar = (CVar<int>*)rTo.m_vTrivialCVars[ii];
+            const char* pValue = &rTo.m_vBytes[ rTo.m_vOffsets[ii] ];
+            const size_t nSize = pCVar->TrivialValueSize();
+            std::unordered_map<void*, size_t>::const_iterator it = mTrivial.find( pCVar );
+            if( it != mTrivial.end() &&
+                memcmp( &rFrom.m_vBytes[ rFrom.m_vOffsets[ it->second ] ], pValue, nSize ) == 0 ) {
+                continue;
+            }
+            diff.m_vTrivialCVars.push_back( pCVar );
+            diff.m_vOffsets.push_back( diff.m_vBytes.size() );
+            diff.m_vBytes.insert( diff.m_vBytes.end(), pValue, pValue + nSize );
+        }
+        for( size_t ii = 0; ii < rTo.m_vCopiedCVars.size(); ii++ ) {
+            CVar<int>* pCVar = (CVar<int>*)rTo.m_vCopiedCVars[ii];
+            std::unordered_map<void*, size_t>::const_iterator it = mCopied.find( pCVar );
+            if( it != mCopied.end() && !rTo.m_vCopyStates[ii].empty() &&
+                rFrom.m_vCopyStates[ it->second ] == rTo.m_vCopyStates[ii] ) {
+                continue;
+            }
+            diff.m_vCopiedCVars.push_back( pCVar );
+            diff.m_vCopies.push_back( pCVar->CloneValueCopy( rTo.m_vCopies[ii] ) );
+            diff.m_vCopyStates.push_back( rTo.m_vCopyStates[ii] );
+        }
+        return diff;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    CVarSnapshot TakeSnapshot( std::vector<std::string> vAcceptedSubstrings )
+    {
+        Trie& trie = TrieInstance();
+        trie.SetAcceptedSubstrings( vAcceptedSubstrings );
+        std::vector<void*> vCVars;
+        trie.CollectAcceptedCVars( vCVars );
+
+        CVarSnapshot snapshot;
+        for( size_t ii = 0; ii < vCVars.size(); ii++ ) {
+            CVar<int>* pCVar = (CVar<int>*)vCVars[ii];
+            // the CVars Save would write, derived CVars are never saved
+            if( pCVar->m_bSerialise && trie.IsNameAcceptable( pCVar->m_sVarName ) ) {
+                snapshot.Add( pCVar );
+            }
+        }
+        return snapshot;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    size_t RestoreSnapshot( const CVarSnapshot& snapshot )
+    {
+        // all the values are written before the first notification, so
+        // nothing notified sees a partly restored snapshot
+        std::vector<void*> vChanged;
+        for( size_t ii = 0; ii < snapshot.m_vTrivialCVars.size(); ii++ ) {
+            CVar<int>* pCVar = (CVar<int>*)snapshot.m_vTrivialCVars[ii];
+            const char* pValue = &snapshot.m_vBytes[ snapshot.m_vOffsets[ii] ];
+            const size_t nSize = pCVar->TrivialValueSize();
+            if( memcmp( pCVar->m_pVarData, pValue, nSize ) != 0 ) {
+                memcpy( pCVar->m_pVarData, pValue, nSize );
+                vChanged.push_back( pCVar );
+            }
+        }
+        std::string sState;
+        for( size_t ii = 0; ii < snapshot.m_vCopiedCVars.size(); ii++ ) {
+            CVar<int>* pCVar = (CVar<int>*)snapshot.m_vCopiedCVars[ii];
+            if( !snapshot.m_vCopyStates[ii].empty() ) {
+                GetCopyState( pCVar, pCVar->m_pVarData, sState );
+                if( sState == snapshot.m_vCopyStates[ii] ) {
+                    continue;
+                }
+            }
+            pCVar->AssignValueCopy( snapshot.m_vCopies[ii] );
+            vChanged.push_back( pCVar );
+        }
+        if( !vChanged.empty() ) {
+            CVarJournalBatch journalBatch;
+            NotifyCVarsChanged( vChanged.data(), vChanged.size() );
+        }
+        return vChanged.size();
+    }
+}
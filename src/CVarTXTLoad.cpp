@@ -0,0 +1,267 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Loading of TXT settings, "name = value" per line, lines starting with '#'
+// or '/' are comments and a "[section]" line makes the following names
+// relative to the "section." namespace ("[]" goes back to the top level).
+// Large files are split in chunks that are tokenised, and their names
+// resolved to CVars, on several threads; the values are then applied in file
+// order on the calling thread.
+
+#include <cvars/CVar.h>
+#include <cvars/Trie.h>
+
+#include <atomic>
+#include <string_view>
+#include <thread>
+#include <cstring>
+
+using namespace CVarUtils;
+
+// below this size a file is parsed on the calling thread only
+#define CVARS_PARALLEL_LOAD_MIN_BYTES ( 1 << 20 )
+// chunks per thread, to even out the load
+#define CVARS_PARALLEL_LOAD_CHUNKS 4
+
+////////////////////////////////////////////////////////////////////////////////
+// A "name = value" line, pointing into the loaded buffer.
+struct CVarTXTEntry
+{
+    CVar<int>*       m_pCVar;     // NULL if the name is not in the Trie (yet)
+    std::string_view m_Name;      // relative to the section
+    std::string_view m_Value;
+    uint32_t         m_nSection;  // index in CVarTXTChunk::m_vSections
+    bool             m_bAccepted; // passes the Load filters
+};
+
+////////////////////////////////////////////////////////////////////////////////
+struct CVarTXTChunk
+{
+    std::vector<CVarTXTEntry> m_vEntries;
+    std::vector<std::string>  m_vSections; // namespaces, "" or ending with '.'
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static std::string_view TrimSpaces( std::string_view s )
+{
+    const size_t nBegin = s.find_first_not_of( ' ' );
+    if( nBegin == std::string_view::npos ) {
+        return std::string_view();
+    }
+    return s.substr( nBegin, s.find_last_not_of( ' ' ) + 1 - nBegin );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// If sLine (without leading blanks) is a "[section]" line sets sSection to its
+// namespace.
+static bool ParseTXTSection( std::string_view sLine, std::string& sSection )
+{
+    while( !sLine.empty() && ( sLine.back() == ' ' || sLine.back() == '\r' ) ) {
+        sLine.remove_suffix( 1 );
+    }
+    if( sLine.size() < 2 || sLine.front() != '[' || sLine.back() != ']' ||
+        sLine.find( '=' ) != std::string_view::npos ) {
+        return false;
+    }
+    const std::string_view sName = TrimSpaces( sLine.substr( 1, sLine.size() - 2 ) );
+    sSection.assign( sName.data(), sName.size() );
+    if( !sSection.empty() ) {
+        sSection += '.';
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Looks up the CVar of entry, named relative to sSection.
+static void ResolveTXTEntry( CVarTXTEntry& entry, const std::string& sSection, uint64_t nSectionHash,
+                             Trie &rTrie, std::string& sFullName )
+{
+    const uint64_t nHash = HashCVarName( entry.m_Name.data(), entry.m_Name.size(), nSectionHash );
+    if( sSection.empty() ) {
+        entry.m_pCVar = (CVar<int>*)rTrie.FindDataByHash( nHash, entry.m_Name.data(), entry.m_Name.size() );
+    }
+    else {
+        sFullName.assign( sSection ).append( entry.m_Name.data(), entry.m_Name.size() );
+        entry.m_pCVar = (CVar<int>*)rTrie.FindDataByHash( nHash, sFullName.data(), sFullName.size() );
+    }
+    entry.m_bAccepted = entry.m_pCVar != NULL && rTrie.IsNameAcceptable( entry.m_pCVar->m_sVarName );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Tokenises the lines in [p, pEnd), starting in namespace sSection, and
+// resolves their names; only reads rTrie so chunks can be parsed concurrently.
+// The tokens point into the buffer, nothing is copied.
+static void ParseTXTChunk( const char* p, const char* pEnd, const std::string& sSection,
+                           Trie &rTrie, CVarTXTChunk& chunk )
+{
+    chunk.m_vSections.push_back( sSection );
+    uint64_t nSectionHash = HashCVarName( sSection );
+    std::string sNewSection, sFullName;
+    while( p < pEnd ) {
+        const char* pEol = (const char*)memchr( p, '\n', pEnd - p );
+        if( pEol == NULL ) {
+            pEol = pEnd;
+        }
+        std::string_view sLine( p, pEol - p );
+        p = pEol + 1;
+
+        sLine.remove_prefix( std::min( sLine.find_first_not_of( ' ' ), sLine.size() ) );
+        if( sLine.empty() || sLine.front() == '#' || sLine.front() == '/' ) {
+            continue;
+        }
+        if( sLine.front() == '[' && ParseTXTSection( sLine, sNewSection ) ) {
+            chunk.m_vSections.push_back( sNewSection );
+            nSectionHash = HashCVarName( sNewSection );
+            continue;
+        }
+        const size_t nEq = sLine.find( '=' );
+        if( nEq == std::string_view::npos || nEq == sLine.size() - 1 ) {
+            continue;
+        }
+
+        CVarTXTEntry entry;
+        entry.m_Name = TrimSpaces( sLine.substr( 0, nEq ) );
+        entry.m_Value = TrimSpaces( sLine.substr( nEq + 1 ) );
+        entry.m_nSection = (uint32_t)( chunk.m_vSections.size() - 1 );
+        ResolveTXTEntry( entry, chunk.m_vSections.back(), nSectionHash, rTrie, sFullName );
+        chunk.m_vEntries.push_back( entry );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Resolves again the entries before the first section line of a chunk parsed
+// from the top level, once its first section was set to the one it starts in.
+static void ResolveTXTChunkStart( Trie &rTrie, CVarTXTChunk& chunk )
+{
+    const std::string& sSection = chunk.m_vSections[0];
+    const uint64_t nSectionHash = HashCVarName( sSection );
+    std::string sFullName;
+    for( size_t ii = 0; ii < chunk.m_vEntries.size() && chunk.m_vEntries[ii].m_nSection == 0; ii++ ) {
+        ResolveTXTEntry( chunk.m_vEntries[ii], sSection, nSectionHash, rTrie, sFullName );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Calls func( ii ) for ii in [0, nTasks) on nThreads threads (counting the
+// calling one).
+template <class Func>
+static void RunOnThreads( unsigned int nThreads, size_t nTasks, Func func )
+{
+    std::atomic<size_t> nNextTask( 0 );
+    auto runTasks = [&]() {
+        for( size_t ii; ( ii = nNextTask++ ) < nTasks; ) {
+            func( ii );
+        }
+    };
+    std::vector<std::thread> vThreads;
+    for( unsigned int ii = 1; ii < nThreads && ii < nTasks; ii++ ) {
+        vThreads.push_back( std::thread( runTasks ) );
+    }
+    runTasks();
+    for( size_t ii = 0; ii < vThreads.size(); ii++ ) {
+        vThreads[ii].join();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void ApplyTXTEntries( const CVarTXTChunk& chunk, Trie &rTrie )
+{
+    const std::vector<CVarTXTEntry>& vEntries = chunk.m_vEntries;
+    for( size_t ii = 0; ii < vEntries.size(); ii++ ) {
+        const CVarTXTEntry& entry = vEntries[ii];
+        if( entry.m_pCVar == NULL ) {
+            const std::string sCVarName = chunk.m_vSections[ entry.m_nSection ] + std::string( entry.m_Name );
+            if( !rTrie.IsNameAcceptable( sCVarName ) ) {
+                if( rTrie.IsVerbose() ) {
+                    printf( "NOT loading %s (not in acceptable name list).\n", sCVarName.c_str() );
+                }
+                continue;
+            }
+            if( rTrie.IsVerbose() ) {
+                printf( "Keeping %s until it is created (not in Trie).\n", sCVarName.c_str() );
+            }
+            rTrie.SetPendingValue( sCVarName, CVARS_BINARY_TEXT, entry.m_Value.data(), entry.m_Value.size() );
+            continue;
+        }
+        if( !entry.m_bAccepted ) {
+            if( rTrie.IsVerbose() ) {
+                printf( "NOT loading %s (not in acceptable name list).\n", entry.m_pCVar->m_sVarName.c_str() );
+            }
+            continue;
+        }
+        if( entry.m_pCVar->IsDerived() ) {
+            if( rTrie.IsVerbose() ) {
+                printf( "NOT loading %s (derived, read only).\n", entry.m_pCVar->m_sVarName.c_str() );
+            }
+            continue;
+        }
+        // the only copy: the CVars parse their value from a std::string
+        entry.m_pCVar->SetValueFromString( std::string( entry.m_Value ) );
+        if( rTrie.IsVerbose() ) {
+            printf( "Loading \"%-*s\" with value \"%.*s... \".\n", *rTrie.m_pVerboseCVarNamePaddingWidth,
+                    entry.m_pCVar->m_sVarName.c_str(), (int)std::min<size_t>( entry.m_Value.size(), 40 ),
+                    entry.m_Value.data() );
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ApplyTXTBuffer( const char* pData, size_t nBytes, Trie &rTrie )
+{
+    unsigned int nThreads = rTrie.GetLoadThreads();
+    if( nThreads == 0 ) {
+        nThreads = std::max( 1u, std::thread::hardware_concurrency() );
+    }
+    if( nThreads == 1 || nBytes < CVARS_PARALLEL_LOAD_MIN_BYTES ) {
+        CVarTXTChunk chunk;
+        ParseTXTChunk( pData, pData + nBytes, std::string(), rTrie, chunk );
+        ApplyTXTEntries( chunk, rTrie );
+        return true;
+    }
+
+    // chunks start after a line end
+    const size_t nChunks = nThreads * CVARS_PARALLEL_LOAD_CHUNKS;
+    std::vector<const char*> vBounds( nChunks + 1, pData + nBytes );
+    vBounds[0] = pData;
+    for( size_t ii = 1; ii < nChunks; ii++ ) {
+        const char* p = std::max( pData + nBytes * ii / nChunks, vBounds[ii-1] );
+        const char* pEol = (const char*)memchr( p, '\n', pData + nBytes - p );
+        vBounds[ii] = pEol == NULL ? pData + nBytes : pEol + 1;
+    }
+
+    // every chunk is parsed as if it started at the top level
+    std::vector<CVarTXTChunk> vChunks( nChunks );
+    RunOnThreads( nThreads, nChunks, [&]( size_t ii ) {
+            ParseTXTChunk( vBounds[ii], vBounds[ii+1], std::string(), rTrie, vChunks[ii] );
+        } );
+
+    // then the chunks starting inside a section have their first entries
+    // resolved again in it
+    std::vector<size_t> vInSection;
+    for( size_t ii = 1; ii < nChunks; ii++ ) {
+        const std::string& sPrevious = vChunks[ii-1].m_vSections.back();
+        if( !sPrevious.empty() ) {
+            vInSection.push_back( ii );
+            vChunks[ii].m_vSections[0] = sPrevious;
+        }
+    }
+    RunOnThreads( nThreads, vInSection.size(), [&]( size_t ii ) {
+            ResolveTXTChunkStart( rTrie, vChunks[ vInSection[ii] ] );
+        } );
+
+    for( size_t ii = 0; ii < nChunks; ii++ ) {
+        ApplyTXTEntries( vChunks[ii], rTrie );
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool LoadTXTFile( const std::string& sFileName, Trie &rTrie )
+{
+    return ApplyMappedFile( sFileName, rTrie, ApplyTXTBuffer );
+}
@@ -0,0 +1,98 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Base64 encoding of binary CVar payloads.
+
+#include <cvars/CVarValueIO.h>
+
+namespace CVarUtils
+{
+    static const char g_sBase64Chars[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    ////////////////////////////////////////////////////////////////////////////////
+    void Base64Encode( std::ostream& stream, const void* pData, size_t nBytes )
+    {
+        const unsigned char* p = (const unsigned char*)pData;
+        char sBuf[4096];
+        size_t nBuf = 0;
+        size_t ii = 0;
+        for( ; ii + 3 <= nBytes; ii += 3 ) {
+            if( nBuf + 4 > sizeof( sBuf ) ) {
+                stream.write( sBuf, nBuf );
+                nBuf = 0;
+            }
+            const uint32_t n = ( p[ii] << 16 ) | ( p[ii+1] << 8 ) | p[ii+2];
+            sBuf[nBuf++] = g_sBase64Chars[ ( n >> 18 ) & 63 ];
+            sBuf[nBuf++] = g_sBase64Chars[ ( n >> 12 ) & 63 ];
+            sBuf[nBuf++] = g_sBase64Chars[ ( n >> 6 ) & 63 ];
+            sBuf[nBuf++] = g_sBase64Chars[ n & 63 ];
+        }
+        stream.write( sBuf, nBuf );
+
+        const size_t nLeft = nBytes - ii;
+        if( nLeft > 0 ) {
+            uint32_t n = p[ii] << 16;
+            if( nLeft == 2 ) {
+                n |= p[ii+1] << 8;
+            }
+            char sTail[4];
+            sTail[0] = g_sBase64Chars[ ( n >> 18 ) & 63 ];
+            sTail[1] = g_sBase64Chars[ ( n >> 12 ) & 63 ];
+            sTail[2] = nLeft == 2 ? g_sBase64Chars[ ( n >> 6 ) & 63 ] : '=';
+            sTail[3] = '=';
+            stream.write( sTail, 4 );
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // Reverse lookup, -1 for characters outside the alphabet.
+    struct Base64Table {
+        Base64Table() {
+            memset( m_vValues, -1, sizeof( m_vValues ) );
+            for( int ii = 0; ii < 64; ii++ ) {
+                m_vValues[ (unsigned char)g_sBase64Chars[ii] ] = (signed char)ii;
+            }
+        }
+        signed char operator[]( unsigned char c ) const { return m_vValues[c]; }
+        signed char m_vValues[256];
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    long Base64Decode( const char* pBegin, const char* pEnd, void* pOut, size_t nMaxBytes )
+    {
+        static const Base64Table table;
+
+        unsigned char* pDst = (unsigned char*)pOut;
+        size_t nOut = 0;
+        uint32_t nAcc = 0;
+        int nBits = 0;
+        for( const char* p = pBegin; p != pEnd; ++p ) {
+            const signed char v = table[ (unsigned char)*p ];
+            if( v < 0 ) {
+                if( *p == '=' ) {
+                    break;
+                }
+                if( *p == ' ' || *p == '\n' || *p == '\r' || *p == '\t' ) {
+                    continue;
+                }
+                return -1;
+            }
+            nAcc = ( nAcc << 6 ) | v;
+            nBits += 6;
+            if( nBits >= 8 ) {
+                nBits -= 8;
+                if( nOut == nMaxBytes ) {
+                    return -1;
+                }
+                pDst[nOut++] = (unsigned char)( nAcc >> nBits );
+            }
+        }
+        return (long)nOut;
+    }
+}
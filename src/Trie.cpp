@@ -13,16 +13,28 @@
 #include "cvars/CVar.h"
 #include "cvars/Trie.h"
 #include "cvars/TrieNode.h"
+#include "cvars/XMLCVarReader.h"
 
-#include <tinyxml2.h>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <cstring>
+
+#ifndef _WIN_
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
 
 using namespace std;
 
 ////////////////////////////////////////////////////////////////////////////////
-Trie::Trie() : root( NULL ), m_bVerbose( false ), m_StreamType( CVARS_XML_STREAM )
+Trie::Trie() : m_pVerboseCVarNamePaddingWidth( NULL ), m_pCVarIndent( NULL ), m_pCVarIndentIncr( NULL ),
+               m_nChangeCount( 0 ), m_bHoldNotifications( false ), m_bJournaling( false ), m_pChangeLog( NULL ), root( NULL ), m_bVerbose( false ), m_StreamType( CVARS_XML_STREAM ),
+               m_ArrayEncoding( CVARS_ARRAY_TEXT ), m_nArrayEncodingMinElements( 0 ), m_nLoadThreads( 0 ),
+               m_bGroupedNames( false ), m_UnchangedLoads( CVARS_ALWAYS_LOAD )
 {
 }
 
@@ -43,12 +55,12 @@ void Trie::Init()
         //////
         sVarName = "console.CVarIndent";
         CVarUtils::CVar<int> *pCVar2 = new CVarUtils::CVar<int>( sVarName, 0 );
-        m_pVerboseCVarNamePaddingWidth = pCVar2->m_pVarData;
+        m_pCVarIndent = pCVar2->m_pVarData;
         Insert( sVarName, (void *) pCVar2 );
         //////
         sVarName = "console.CVarIndentIncr";
         CVarUtils::CVar<int> *pCVar3 = new CVarUtils::CVar<int>( sVarName, 4 );
-        m_pVerboseCVarNamePaddingWidth = pCVar3->m_pVarData;
+        m_pCVarIndentIncr = pCVar3->m_pVarData;
         Insert( sVarName, (void *) pCVar3 );
         //////
     }
@@ -68,17 +80,137 @@ void Trie::Insert( std::string s, void *dataPtr )
         return;
     }
 
-    m_vCVarNames.push_back( s );
+    InsertLeaf( InsertPath( root, s ), s, dataPtr );
+}
 
-    TrieNode *traverseNode = root;
+////////////////////////////////////////////////////////////////////////////////
+TrieNode* Trie::InsertPath( TrieNode* pFrom, const std::string& s )
+{
+    TrieNode *traverseNode = pFrom;
     for( unsigned int i = 0 ; i < s.length() ; i++ ) {
         traverseNode = traverseNode->TraverseInsert( s[i] );
     }
+    return traverseNode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Trie::InsertLeaf( TrieNode* pNode, const std::string& sFullName, void *dataPtr )
+{
+    m_vCVarNames.push_back( sFullName );
+    m_vCVarData.push_back( dataPtr );
+    m_mNameHashIndex[ CVarUtils::HashCVarName( sFullName ) ] = dataPtr;
 
     //add leaf node
-    TrieNode* newNode = new TrieNode( s );
+    TrieNode* newNode = new TrieNode( sFullName );
     newNode->m_pNodeData = dataPtr;
-    traverseNode->m_children.push_back(newNode); //create leaf node at end of chain
+    pNode->m_children.push_back(newNode); //create leaf node at end of chain
+
+    // value loaded before the CVar was created
+    if( !m_mPendingValues.empty() ) {
+        std::unordered_map< std::string, CVarPendingValue >::iterator it = m_mPendingValues.find( sFullName );
+        if( it != m_mPendingValues.end() ) {
+            CVarUtils::CVar<int>* pCVar = (CVarUtils::CVar<int>*)dataPtr;
+            const CVarPendingValue& value = it->second;
+            if( value.m_nTypeId == CVarUtils::CVARS_BINARY_TEXT ) {
+                pCVar->SetValueFromString( value.m_sValue );
+            }
+            else if( !pCVar->SetValueFromBinary( value.m_nTypeId, value.m_sValue.data(), value.m_sValue.size() ) ) {
+                if( value.m_nTypeId == CVarUtils::CVARS_BINARY_STRING ) {
+                    // a string holding the text of a type without binary form
+                    pCVar->SetValueFromString( value.m_sValue );
+                }
+                else {
+                    cerr << "WARNING: loaded value of " << sFullName << " does not match its type, ignoring." << endl;
+                }
+            }
+            m_mPendingValues.erase( it );
+        }
+    }
+    // then overrides, which take precedence over loaded values
+    if( !m_mPendingEnvironmentValues.empty() ) {
+        std::unordered_map< std::string, std::string >::iterator it =
+            m_mPendingEnvironmentValues.find( EnvironmentName( sFullName ) );
+        if( it != m_mPendingEnvironmentValues.end() ) {
+            if( CVarUtils::IsConsoleFunc( newNode ) ) {
+                cerr << "WARNING: " << sFullName << " is a function, ignoring its override." << endl;
+            }
+            else {
+                ((CVarUtils::CVar<int>*)dataPtr)->SetValueFromString( it->second );
+            }
+            m_mPendingEnvironmentValues.erase( it );
+        }
+    }
+    if( !m_mPendingArgValues.empty() ) {
+        std::unordered_map< std::string, std::string >::iterator it = m_mPendingArgValues.find( sFullName );
+        if( it != m_mPendingArgValues.end() ) {
+            if( CVarUtils::IsConsoleFunc( newNode ) ) {
+                cerr << "WARNING: " << sFullName << " is a function, ignoring its override." << endl;
+            }
+            else {
+                ((CVarUtils::CVar<int>*)dataPtr)->SetValueFromString( it->second );
+            }
+            m_mPendingArgValues.erase( it );
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Trie::SetPendingValue( const std::string& sName, uint32_t nTypeId, const char* pValue, size_t nBytes )
+{
+    if( m_pChangeLog != NULL ) {
+        return;
+    }
+    CVarPendingValue& value = m_mPendingValues[ sName ];
+    value.m_nTypeId = nTypeId;
+    value.m_sValue.assign( pValue, nBytes );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Trie::SetPendingEnvironmentValue( const std::string& sEnvironmentName, const std::string& sValue )
+{
+    m_mPendingEnvironmentValues[ sEnvironmentName ] = sValue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Trie::SetPendingArgValue( const std::string& sName, const std::string& sValue )
+{
+    m_mPendingArgValues[ sName ] = sValue;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Trie::ErasePendingValues( const std::string& sName )
+{
+    size_t nErased = m_mPendingValues.erase( sName ) + m_mPendingArgValues.erase( sName );
+    if( !m_mPendingEnvironmentValues.empty() ) {
+        nErased += m_mPendingEnvironmentValues.erase( EnvironmentName( sName ) );
+    }
+    return nErased > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TrieNode* Trie::FindPath( TrieNode* pFrom, const std::string& s )
+{
+    TrieNode *traverseNode = pFrom;
+    for( unsigned int i = 0 ; i < s.length() && traverseNode != NULL ; i++ ) {
+        traverseNode = traverseNode->TraverseFind( s[i] );
+    }
+    return traverseNode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TrieNode* Trie::FindFrom( TrieNode* pFrom, const std::string& s )
+{
+    TrieNode *traverseNode = FindPath( pFrom, s );
+    if( traverseNode == NULL ) {
+        return NULL;
+    }
+    std::list<TrieNode*>::iterator it;
+    for( it = traverseNode->m_children.begin() ; it != traverseNode->m_children.end() ; it++ ) {
+        if( (*it)->m_nNodeType == TRIE_LEAF ) {
+            return (*it);
+        }
+    }
+    return NULL;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -98,6 +230,21 @@ void* Trie::FindData( const std::string& s )
     return Find( s )->m_pNodeData;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void* Trie::FindDataByHash( uint64_t nHash, const char* sName, size_t nLength )
+{
+    std::unordered_map< uint64_t, void* >::iterator it = m_mNameHashIndex.find( nHash );
+    if( it != m_mNameHashIndex.end() ) {
+        const std::string& sVarName = ((CVarUtils::CVar<int>*)it->second)->m_sVarName;
+        if( sVarName.size() == nLength && memcmp( sVarName.data(), sName, nLength ) == 0 ) {
+            return it->second;
+        }
+    }
+    // hash collision (or unknown name)
+    TrieNode* pNode = Find( std::string( sName, nLength ) );
+    return pNode == NULL ? NULL : pNode->m_pNodeData;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool Trie::Exists( const std::string& s )
 {
@@ -160,7 +307,10 @@ TrieNode* Trie::FindSubStr( const std::string& s )
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Chris, please comment this guy for me.  GTS
+// Sets the Save/Load filters: names starting with one of the substrings before
+// "not" are accepted (all names if there are none), names starting with one of
+// the substrings after it are rejected.  A trailing "true"/"false" sets the
+// verbosity.  The prefixes are compiled into m_vFilterNodes.
 void Trie::SetAcceptedSubstrings( std::vector< std::string > vFilterSubstrings )
 {
     m_vAcceptedSubstrings.clear();
@@ -190,36 +340,110 @@ void Trie::SetAcceptedSubstrings( std::vector< std::string > vFilterSubstrings )
     for( int nNotAccIndex=nAccIndex; nNotAccIndex<int(vFilterSubstrings.size()); nNotAccIndex++ ) {
         m_vNotAcceptedSubstrings.push_back( vFilterSubstrings[nNotAccIndex] );
     }
+
+    m_vFilterNodes.assign( 1, FilterNode() );
+    for( size_t ii = 0; ii < m_vAcceptedSubstrings.size(); ii++ ) {
+        m_vFilterNodes[ AddFilterPrefix( m_vAcceptedSubstrings[ii] ) ].m_bAccept = true;
+    }
+    for( size_t ii = 0; ii < m_vNotAcceptedSubstrings.size(); ii++ ) {
+        m_vFilterNodes[ AddFilterPrefix( m_vNotAcceptedSubstrings[ii] ) ].m_bReject = true;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Adds the path of sPrefix to the filter trie, returns its last node.
+int Trie::AddFilterPrefix( const std::string& sPrefix )
+{
+    int nNode = 0;
+    for( size_t ii = 0; ii < sPrefix.size(); ii++ ) {
+        int nChild = FindFilterChild( nNode, sPrefix[ii] );
+        if( nChild < 0 ) {
+            nChild = (int)m_vFilterNodes.size();
+            m_vFilterNodes[nNode].m_vChildren.push_back( std::make_pair( sPrefix[ii], nChild ) );
+            m_vFilterNodes.push_back( FilterNode() );
+        }
+        nNode = nChild;
+    }
+    return nNode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Trie::FindFilterChild( int nNode, char c ) const
+{
+    const std::vector< std::pair<char,int> >& vChildren = m_vFilterNodes[nNode].m_vChildren;
+    for( size_t ii = 0; ii < vChildren.size(); ii++ ) {
+        if( vChildren[ii].first == c ) {
+            return vChildren[ii].second;
+        }
+    }
+    return -1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool Trie::IsNameAcceptable( const std::string& sVarName )
+// Walks the name down the filter trie, only as far as some prefix goes.
+bool Trie::IsNameAcceptable( const char* sVarName, size_t nLength ) const
 {
-    if( m_vAcceptedSubstrings.size() == 0 &&
-        m_vNotAcceptedSubstrings.size() == 0 ) {
+    if( m_vAcceptedSubstrings.empty() && m_vNotAcceptedSubstrings.empty() ) {
         return true;
     }
-    bool bAcceptable;
-    if( m_vAcceptedSubstrings.size() == 0 ) {
-        bAcceptable = true;
+    bool bAccepted = m_vAcceptedSubstrings.empty();
+    int nNode = 0;
+    for( size_t ii = 0; ; ii++ ) {
+        const FilterNode& node = m_vFilterNodes[nNode];
+        if( node.m_bReject ) {
+            return false;
+        }
+        bAccepted = bAccepted || node.m_bAccept;
+        if( ii == nLength || ( nNode = FindFilterChild( nNode, sVarName[ii] ) ) < 0 ) {
+            return bAccepted;
+        }
     }
-    else {
-        bAcceptable = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Trie::IsNameAcceptable( const std::string& sVarName ) const
+{
+    return IsNameAcceptable( sVarName.data(), sVarName.size() );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// With accepted prefixes only their subtrees are visited; the CVars are in
+// creation order when all of them have to be checked.
+void Trie::CollectAcceptedCVars( std::vector<void*>& vCVars )
+{
+    vCVars.clear();
+    if( m_vAcceptedSubstrings.empty() || m_bVerbose ) {
+        // verbose filtering reports every rejected name
+        vCVars.reserve( m_vCVarData.size() );
+        for( size_t ii = 0; ii < m_vCVarData.size(); ii++ ) {
+            if( m_bVerbose || IsNameAcceptable( ((CVarUtils::CVar<int>*)m_vCVarData[ii])->m_sVarName ) ) {
+                vCVars.push_back( m_vCVarData[ii] );
+            }
+        }
+        return;
     }
 
-    for( size_t i=0; i<m_vAcceptedSubstrings.size(); i++ ) {
-        if( sVarName.find( m_vAcceptedSubstrings[i] ) == 0 ) {
-            bAcceptable = true;
-            break;
+    // skip the prefixes extending another one, their subtree is already
+    // visited (the shorter prefix is carried over to compare with the next)
+    std::vector<std::string> vPrefixes( m_vAcceptedSubstrings );
+    std::sort( vPrefixes.begin(), vPrefixes.end() );
+    std::vector<TrieNode*> vNodes;
+    for( size_t ii = 0; ii < vPrefixes.size(); ii++ ) {
+        if( ii > 0 && vPrefixes[ii].compare( 0, vPrefixes[ii-1].size(), vPrefixes[ii-1] ) == 0 ) {
+            vPrefixes[ii] = vPrefixes[ii-1];
+            continue;
+        }
+        TrieNode* pNode = FindPath( root, vPrefixes[ii] );
+        if( pNode != NULL ) {
+            pNode->PrintNodeToVector( vNodes );
         }
     }
-    for( size_t i=0; i<m_vNotAcceptedSubstrings.size(); i++ ) {
-        if( sVarName.find( m_vNotAcceptedSubstrings[i] ) == 0 ) {
-            bAcceptable = false;
-            break;
+    for( size_t ii = 0; ii < vNodes.size(); ii++ ) {
+        void* pCVar = vNodes[ii]->m_pNodeData;
+        if( m_vNotAcceptedSubstrings.empty() || IsNameAcceptable( ((CVarUtils::CVar<int>*)pCVar)->m_sVarName ) ) {
+            vCVars.push_back( pCVar );
         }
     }
-    return bAcceptable;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -254,85 +478,284 @@ std::vector<TrieNode*> Trie::CollectAllNodes( TrieNode* node )
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-static std::ostream &TrieToTXT( std::ostream &stream, Trie &rTrie )
+// Output state of a serialisation: the indentation level and a buffer written
+// to the stream in large blocks.
+class CVarWriter
 {
-    std::vector<TrieNode*> vNodes = rTrie.CollectAllNodes( rTrie.GetRoot() );
-    for( size_t ii = 0; ii < vNodes.size(); ii++ ){
-        std::string sVal = ((CVarUtils::CVar<int>*)vNodes[ii]->m_pNodeData)->GetValueAsString();
+public:
+    CVarWriter( std::ostream& stream, int nIndent, int nIndentIncr )
+        : m_Stream( stream ), m_nIndent( nIndent ), m_nIndentIncr( nIndentIncr ) {
+        m_sBuf.reserve( 2 * FLUSH_SIZE );
+    }
+    ~CVarWriter() { Flush(); }
 
-        if( !sVal.empty() ) {
-            std::string sCVarName = ((CVarUtils::CVar<int>*)vNodes[ii]->m_pNodeData)->m_sVarName;
-            if( !rTrie.IsNameAcceptable( sCVarName ) ) {
-                if( rTrie.IsVerbose() ) {
-                    printf( "NOT saving %s (not in acceptable name list).\n", sCVarName.c_str() );
-                }
-                continue;
-            }
-            if( !((CVarUtils::CVar<int>*)vNodes[ii]->m_pNodeData)->m_bSerialise ) {
-                if( rTrie.IsVerbose() ) {
-                    printf( "NOT saving %s (set as not savable at construction time).\n", sCVarName.c_str() );
-                }
-                continue;
+    void Indent()   { m_nIndent += m_nIndentIncr; }
+    void UnIndent() { m_nIndent -= m_nIndentIncr; }
+
+    void WriteIndent() {
+        if( m_nIndent > 0 ) {
+            m_sBuf.append( m_nIndent, ' ' );
+        }
+    }
+
+    void Write( const char* s, size_t nLength ) {
+        m_sBuf.append( s, nLength );
+        if( m_sBuf.size() >= FLUSH_SIZE ) {
+            Flush();
+        }
+    }
+    void Write( const char* s )        { Write( s, strlen( s ) ); }
+    void Write( const std::string& s ) { Write( s.data(), s.size() ); }
+
+    // Writes s with the characters that cannot appear in XML text escaped.
+    void WriteXMLText( const std::string& s ) {
+        AppendXMLText( m_sBuf, s.data(), s.size() );
+        if( m_sBuf.size() >= FLUSH_SIZE ) {
+            Flush();
+        }
+    }
+
+    void Flush() {
+        m_Stream.write( m_sBuf.data(), m_sBuf.size() );
+        m_sBuf.clear();
+    }
+
+private:
+    static const size_t FLUSH_SIZE = 65536;
+
+    std::ostream& m_Stream;
+    std::string   m_sBuf;
+    int           m_nIndent;
+    int           m_nIndentIncr;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+CVarSaveSet::CVarSaveSet() : m_StreamType( CVARS_XML_STREAM ), m_ArrayEncoding( CVARS_ARRAY_TEXT ),
+                             m_nArrayEncodingMinElements( 0 ), m_nIndent( 0 ), m_nIndentIncr( 0 ),
+                             m_nVerbosePaddingWidth( 0 ), m_bVerbose( false ), m_bCopies( false ),
+                             m_bGroupedNames( false )
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CVarSaveSet::~CVarSaveSet()
+{
+    if( m_bCopies ) {
+        for( size_t ii = 0; ii < m_vCVars.size(); ii++ ) {
+            ((CVarUtils::CVar<int>*)m_vCVars[ii])->DestroyValueCopy( m_vValues[ii] );
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CollectSaveSet( Trie &rTrie, bool bCopyValues, CVarSaveSet &saveSet )
+{
+    saveSet.m_StreamType = rTrie.GetStreamType();
+    saveSet.m_ArrayEncoding = rTrie.GetArrayEncoding();
+    saveSet.m_nArrayEncodingMinElements = rTrie.GetArrayEncodingMinElements();
+    saveSet.m_nIndent = *rTrie.m_pCVarIndent;
+    saveSet.m_nIndentIncr = *rTrie.m_pCVarIndentIncr;
+    saveSet.m_nVerbosePaddingWidth = *rTrie.m_pVerboseCVarNamePaddingWidth;
+    saveSet.m_bVerbose = rTrie.IsVerbose();
+    saveSet.m_bCopies = bCopyValues;
+    saveSet.m_bGroupedNames = rTrie.GetGroupedNames();
+
+    std::vector<void*> vCVars;
+    rTrie.CollectAcceptedCVars( vCVars );
+    saveSet.m_vCVars.reserve( vCVars.size() );
+    saveSet.m_vValues.reserve( vCVars.size() );
+    for( size_t ii = 0; ii < vCVars.size(); ii++ ) {
+        CVarUtils::CVar<int>* pCVar = (CVarUtils::CVar<int>*)vCVars[ii];
+        const std::string& sCVarName = pCVar->m_sVarName;
+        if( !rTrie.IsNameAcceptable( sCVarName ) ) {
+            if( rTrie.IsVerbose() ) {
+                printf( "NOT saving %s (not in acceptable name list).\n", sCVarName.c_str() );
             }
+            continue;
+        }
+        if( !pCVar->m_bSerialise ) {
             if( rTrie.IsVerbose() ) {
-                printf( "Saving \"%-*s\" with value \"%s\".\n", *rTrie.m_pVerboseCVarNamePaddingWidth,
-                        sCVarName.c_str(), sVal.c_str() );
+                printf( "NOT saving %s (set as not savable at construction time).\n", sCVarName.c_str() );
             }
-            stream << sCVarName << " = " << sVal << std::endl;
+            continue;
         }
+        saveSet.m_vCVars.push_back( pCVar );
+        saveSet.m_vValues.push_back( bCopyValues ? pCVar->CloneValue() : (void*)pCVar->m_pVarData );
     }
-	return stream;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-static std::ostream &TrieToXML( std::ostream &stream, Trie &rTrie )
+// Value of the ii-th CVar of saveSet as saved, empty if there is nothing to save.
+static std::string GetSavedValue( const CVarSaveSet &saveSet, size_t ii )
 {
-    std::vector<TrieNode*> vNodes = rTrie.CollectAllNodes( rTrie.GetRoot() );
-    stream << CVarUtils::CVarSpc() << "<cvars>" << std::endl;
-    for( size_t ii = 0; ii < vNodes.size(); ii++ ){
-        std::string sVal = ((CVarUtils::CVar<int>*)vNodes[ii]->m_pNodeData)->GetValueAsString();
+    CVarUtils::CVar<int>* pCVar = (CVarUtils::CVar<int>*)saveSet.m_vCVars[ii];
+    std::string sVal = pCVar->FormatSavedValue( saveSet.m_vValues[ii], saveSet.m_ArrayEncoding,
+                                                saveSet.m_nArrayEncodingMinElements );
+    if( !sVal.empty() && saveSet.m_bVerbose ) {
+        printf( "Saving \"%-*s\" with value \"%s\".\n", saveSet.m_nVerbosePaddingWidth,
+                pCVar->m_sVarName.c_str(), sVal.c_str() );
+    }
+    return sVal;
+}
 
-        if( !sVal.empty() ) {
-            std::string sCVarName = ((CVarUtils::CVar<int>*)vNodes[ii]->m_pNodeData)->m_sVarName;
-            if( !rTrie.IsNameAcceptable( sCVarName ) ) {
-                if( rTrie.IsVerbose() ) {
-                    printf( "NOT saving %s (not in acceptable name list).\n", sCVarName.c_str() );
-                }
-                continue;
+////////////////////////////////////////////////////////////////////////////////
+static const std::string& SavedName( const CVarSaveSet &saveSet, size_t ii )
+{
+    return ((CVarUtils::CVar<int>*)saveSet.m_vCVars[ii])->m_sVarName;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Orders by name, so the CVars of each namespace are contiguous.
+struct CompareSavedNames
+{
+    const CVarSaveSet& m_SaveSet;
+    bool operator()( size_t a, size_t b ) const {
+        return SavedName( m_SaveSet, a ) < SavedName( m_SaveSet, b );
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Orders by namespace (the name up to its last '.') then name, so each TXT
+// section is written once.
+struct CompareSavedNamespaces
+{
+    const CVarSaveSet& m_SaveSet;
+    bool operator()( size_t a, size_t b ) const {
+        const std::string& sA = SavedName( m_SaveSet, a );
+        const std::string& sB = SavedName( m_SaveSet, b );
+        const size_t nA = sA.rfind( '.' ) + 1;
+        const size_t nB = sB.rfind( '.' ) + 1;
+        const int nCmp = sA.compare( 0, nA, sB, 0, nB );
+        return nCmp != 0 ? nCmp < 0 : sA.compare( nA, std::string::npos, sB, nB, std::string::npos ) < 0;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static std::ostream &SaveSetToTXT( std::ostream &stream, const CVarSaveSet &saveSet )
+{
+    std::vector<size_t> vOrder( saveSet.m_vCVars.size() );
+    for( size_t ii = 0; ii < vOrder.size(); ii++ ) {
+        vOrder[ii] = ii;
+    }
+    if( saveSet.m_bGroupedNames ) {
+        CompareSavedNamespaces compare = { saveSet };
+        std::sort( vOrder.begin(), vOrder.end(), compare );
+    }
+
+    CVarWriter writer( stream, 0, 0 );
+    std::string sSection;
+    for( size_t ii = 0; ii < vOrder.size(); ii++ ){
+        const std::string sVal = GetSavedValue( saveSet, vOrder[ii] );
+        if( sVal.empty() ) {
+            continue;
+        }
+        const std::string& sCVarName = SavedName( saveSet, vOrder[ii] );
+        size_t nLeaf = 0;
+        if( saveSet.m_bGroupedNames ) {
+            nLeaf = sCVarName.rfind( '.' ) + 1;
+            if( sSection.size() != nLeaf || sCVarName.compare( 0, nLeaf, sSection ) != 0 ) {
+                sSection.assign( sCVarName, 0, nLeaf );
+                writer.Write( "[", 1 );
+                writer.Write( sSection.data(), nLeaf > 0 ? nLeaf - 1 : 0 );
+                writer.Write( "]\n", 2 );
             }
-            if( !((CVarUtils::CVar<int>*)vNodes[ii]->m_pNodeData)->m_bSerialise ) {
-                if( rTrie.IsVerbose() ) {
-                    printf( "NOT saving %s (set as not savable at construction time).\n", sCVarName.c_str() );
-                }
-                continue;
+        }
+        writer.Write( sCVarName.data() + nLeaf, sCVarName.size() - nLeaf );
+        writer.Write( " = ", 3 );
+        writer.Write( sVal );
+        writer.Write( "\n", 1 );
+    }
+    return stream;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Closes the innermost namespace element of sGroup.
+static void CloseXMLGroup( CVarWriter& writer, std::string& sGroup, std::vector<size_t>& vGroupStarts )
+{
+    writer.UnIndent();
+    writer.WriteIndent();
+    writer.Write( "</", 2 );
+    writer.Write( sGroup.data() + vGroupStarts.back(), sGroup.size() - vGroupStarts.back() );
+    writer.Write( ">\n", 2 );
+    sGroup.resize( vGroupStarts.back() );
+    vGroupStarts.pop_back();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static std::ostream &SaveSetToXML( std::ostream &stream, const CVarSaveSet &saveSet )
+{
+    std::vector<size_t> vOrder( saveSet.m_vCVars.size() );
+    for( size_t ii = 0; ii < vOrder.size(); ii++ ) {
+        vOrder[ii] = ii;
+    }
+    if( saveSet.m_bGroupedNames ) {
+        CompareSavedNames compare = { saveSet };
+        std::sort( vOrder.begin(), vOrder.end(), compare );
+    }
+
+    CVarWriter writer( stream, saveSet.m_nIndent, saveSet.m_nIndentIncr );
+    writer.WriteIndent();
+    writer.Write( "<cvars>\n" );
+    writer.Indent();
+    // open namespace elements, as the prefix they add up to and where each starts
+    std::string sGroup;
+    std::vector<size_t> vGroupStarts;
+    for( size_t ii = 0; ii < vOrder.size(); ii++ ){
+        const std::string sVal = GetSavedValue( saveSet, vOrder[ii] );
+        if( sVal.empty() ) {
+            continue;
+        }
+        const std::string& sCVarName = SavedName( saveSet, vOrder[ii] );
+        if( saveSet.m_bGroupedNames ) {
+            while( !vGroupStarts.empty() && sCVarName.compare( 0, sGroup.size(), sGroup ) != 0 ) {
+                CloseXMLGroup( writer, sGroup, vGroupStarts );
             }
-            if( rTrie.IsVerbose() ) {
-                printf( "Saving \"%-*s\" with value \"%s\".\n", *rTrie.m_pVerboseCVarNamePaddingWidth,
-                        sCVarName.c_str(), sVal.c_str() );
+            for( size_t nDot; ( nDot = sCVarName.find( '.', sGroup.size() ) ) != std::string::npos; ) {
+                vGroupStarts.push_back( sGroup.size() );
+                sGroup.assign( sCVarName, 0, nDot + 1 );
+                writer.WriteIndent();
+                writer.Write( "<", 1 );
+                writer.Write( sGroup.data() + vGroupStarts.back(), sGroup.size() - vGroupStarts.back() );
+                writer.Write( ">\n", 2 );
+                writer.Indent();
             }
-            CVarUtils::CVarIndent();
-            stream << CVarUtils::CVarSpc() << "<" << sCVarName << ">  ";
-            CVarUtils::CVarIndent();
-            stream << sVal;
-            CVarUtils::CVarUnIndent();
-            stream << CVarUtils::CVarSpc() << "</" << sCVarName << ">" << std::endl;
-            CVarUtils::CVarUnIndent();
         }
+        const char* sTag = sCVarName.data() + sGroup.size();
+        const size_t nTagLength = sCVarName.size() - sGroup.size();
+        writer.WriteIndent();
+        writer.Write( "<", 1 );
+        writer.Write( sTag, nTagLength );
+        writer.Write( ">  ", 3 );
+        writer.WriteXMLText( sVal );
+        writer.WriteIndent();
+        writer.Write( "</", 2 );
+        writer.Write( sTag, nTagLength );
+        writer.Write( ">\n", 2 );
     }
-    stream << CVarUtils::CVarSpc() << "</cvars>" << std::endl;
-
+    while( !vGroupStarts.empty() ) {
+        CloseXMLGroup( writer, sGroup, vGroupStarts );
+    }
+    writer.UnIndent();
+    writer.WriteIndent();
+    writer.Write( "</cvars>\n" );
     return stream;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-std::ostream &operator<<( std::ostream &stream, Trie &rTrie )
+std::ostream &WriteSaveSet( std::ostream &stream, const CVarSaveSet &saveSet )
 {
-  switch( rTrie.GetStreamType() ) {
+  switch( saveSet.m_StreamType ) {
   case CVARS_XML_STREAM:
-    return TrieToXML( stream, rTrie );
+    return SaveSetToXML( stream, saveSet );
     break;
   case CVARS_TXT_STREAM:
-    return TrieToTXT( stream, rTrie );
+    return SaveSetToTXT( stream, saveSet );
+    break;
+  case CVARS_BINARY_STREAM:
+    return SaveSetToBinary( stream, saveSet );
+    break;
+  case CVARS_JSON_STREAM:
+    return SaveSetToJSON( stream, saveSet );
     break;
   default:
     std::cerr << "ERROR: unknown stream type" << std::endl;
@@ -341,44 +764,52 @@ std::ostream &operator<<( std::ostream &stream, Trie &rTrie )
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-static std::istream &XMLToTrie( std::istream &stream, Trie &rTrie )
+std::ostream &operator<<( std::ostream &stream, Trie &rTrie )
 {
-    tinyxml2::XMLDocument doc;
-    std::string s;
-    stream >> s;
-    doc.Parse(s.c_str());
-
-    tinyxml2::XMLNode* pCVarsNode = doc.RootElement();
-
-    if( pCVarsNode == NULL ) {
-        cerr <<  "ERROR: Could not find <cvars> node." << endl;
-        return stream;
-    }
-
-    for( tinyxml2::XMLNode* pNode = pCVarsNode->FirstChild();
-         pNode != NULL;
-         pNode = pNode->NextSibling() ) {
-        std::string sCVarName( pNode->Value() );
+    CVarSaveSet saveSet;
+    CollectSaveSet( rTrie, false, saveSet );
+    return WriteSaveSet( stream, saveSet );
+}
 
-        if( !rTrie.Exists( sCVarName ) ) {
+////////////////////////////////////////////////////////////////////////////////
+static std::istream &XMLToTrie( std::istream &stream, Trie &rTrie )
+{
+    XMLCVarReader reader( stream );
+    std::string sCVarName, sCVarValue;
+    // Trie node of the current namespace element, names are looked up from it
+    std::string sGroup;
+    TrieNode* pGroupNode = rTrie.GetRoot();
+    while( reader.Next( sCVarName, sCVarValue ) ) {
+        if( !rTrie.IsNameAcceptable( sCVarName ) ) {
             if( rTrie.IsVerbose() ) {
-                printf( "NOT loading %s (not in Trie).\n", sCVarName.c_str() );
+                printf( "NOT loading %s (not in acceptable name list).\n", sCVarName.c_str() );
             }
             continue;
         }
 
-        if( !rTrie.IsNameAcceptable( sCVarName ) ) {
-            if( rTrie.IsVerbose() ) {
-                printf( "NOT loading %s (not in acceptable name list).\n", sCVarName.c_str() );
+        const size_t nGroup = reader.GroupLength();
+        if( sGroup.size() != nGroup || sCVarName.compare( 0, nGroup, sGroup ) != 0 ) {
+            sGroup.assign( sCVarName, 0, nGroup );
+            pGroupNode = rTrie.FindPath( rTrie.GetRoot(), sGroup );
+        }
+        TrieNode* pNode = pGroupNode == NULL ? NULL : rTrie.FindFrom( pGroupNode, sCVarName.substr( nGroup ) );
+        if( pNode == NULL ) {
+            if( !sCVarValue.empty() ) {
+                if( rTrie.IsVerbose() ) {
+                    printf( "Keeping %s until it is created (not in Trie).\n", sCVarName.c_str() );
+                }
+                rTrie.SetPendingValue( sCVarName, CVarUtils::CVARS_BINARY_TEXT, sCVarValue.data(), sCVarValue.size() );
             }
             continue;
         }
 
-        CVarUtils::CVar<int>* pCVar = (CVarUtils::CVar<int>*)rTrie.Find( sCVarName )->m_pNodeData;
-        tinyxml2::XMLNode* pChild = pNode->FirstChild();
-
-        if( pCVar != NULL && pChild != NULL ) {
-            std::string sCVarValue(pChild->ToText()->Value());
+        CVarUtils::CVar<int>* pCVar = (CVarUtils::CVar<int>*)pNode->m_pNodeData;
+        if( pCVar != NULL && pCVar->IsDerived() ) {
+            if( rTrie.IsVerbose() ) {
+                printf( "NOT loading %s (derived, read only).\n", sCVarName.c_str() );
+            }
+        }
+        else if( pCVar != NULL && !sCVarValue.empty() ) {
             pCVar->SetValueFromString( sCVarValue );
 
             if( rTrie.IsVerbose() ) {
@@ -390,88 +821,55 @@ static std::istream &XMLToTrie( std::istream &stream, Trie &rTrie )
             cerr << "WARNING: found a cvar in file with no value (name: " << sCVarName << ").\n" << endl;
         }
     }
+    if( !reader.FoundRoot() ) {
+        cerr <<  "ERROR: Could not find <cvars> node." << endl;
+    }
     return stream;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-static std::string remove_spaces( std::string str )
+// Reads what is left of stream.
+static void ReadAll( std::istream &stream, std::string& sBuf )
 {
-  str.erase( str.find_last_not_of( ' ' ) + 1 );
-  str.erase( 0, str.find_first_not_of( ' ' ) );
-  return str;
+    char buf[65536];
+    while( stream.read( buf, sizeof( buf ) ) || stream.gcount() > 0 ) {
+        sBuf.append( buf, stream.gcount() );
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-static bool get_not_comment_line( std::istream& iStream, std::string& sLineNoComment )
+bool ApplyMappedFile( const std::string& sFileName, Trie &rTrie,
+                      bool (*pApply)( const char*, size_t, Trie& ) )
 {
-  std::string sLine;
-  if( !iStream.good() ) { return false; }
-  while( !iStream.eof() ) {
-    getline( iStream, sLine );
-    sLine.erase( 0, sLine.find_first_not_of( ' ' ) );
-    if( sLine.empty() ) {
-      continue;
+#ifndef _WIN_
+    const int fd = open( sFileName.c_str(), O_RDONLY );
+    if( fd < 0 ) {
+        return false;
     }
-    else if( sLine[0] != '#' && sLine[0] != '/' ) {
-      sLineNoComment = sLine;
-      return true;
+    struct stat st;
+    if( fstat( fd, &st ) != 0 || st.st_size == 0 ) {
+        close( fd );
+        return pApply( "", 0, rTrie );
     }
-  }
-  return false;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-static bool get_name_val( const std::string& sLine,
-			  std::string& sName,
-			  std::string& sVal )
-{
-  size_t sEq = sLine.find( "=" );
-  if( sEq == std::string::npos || sEq == sLine.length()-1 ) { return false; }
-  sVal = sLine;
-  sVal.erase( 0, sEq+1 );
-  sVal = remove_spaces( sVal );
-  sName = sLine;
-  sName.erase( sEq );
-  sName = remove_spaces( sName );
-  return true;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-static std::istream &TXTToTrie( std::istream &stream, Trie &rTrie )
-{
-  std::string sLine, sCVarName, sCVarValue;
-  while( get_not_comment_line( stream, sLine ) )
-    {
-      if( get_name_val( sLine, sCVarName, sCVarValue ) )
-	{
-	  if( !rTrie.Exists( sCVarName ) ) {
-            if( rTrie.IsVerbose() ) {
-	      printf( "NOT loading %s (not in Trie).\n", sCVarName.c_str() );
-            }
-            continue;
-	  }
-	  if( !rTrie.IsNameAcceptable( sCVarName ) ) {
-            if( rTrie.IsVerbose() ) {
-	      printf( "NOT loading %s (not in acceptable name list).\n", sCVarName.c_str() );
-            }
-            continue;
-	  }
-
-	  CVarUtils::CVar<int>* pCVar = (CVarUtils::CVar<int>*)rTrie.Find( sCVarName )->m_pNodeData;
-
-	  if( pCVar != NULL ) {
-            pCVar->SetValueFromString( sCVarValue );
-            if( rTrie.IsVerbose() ) {
-	      printf( "Loading \"%-*s\" with value \"%s... \".\n", *rTrie.m_pVerboseCVarNamePaddingWidth,
-		      sCVarName.c_str(), sCVarValue.substr(0,40).c_str() );
-            }
-	  }
-	  else {
-            cerr << "WARNING: found a cvar in file with no value (name: " << sCVarName << ").\n" << endl;
-	  }
-	}
+    void* pMap = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if( pMap == MAP_FAILED ) {
+        std::cerr << "ERROR: could not map " << sFileName << "." << std::endl;
+        return false;
     }
-    return stream;
+    madvise( pMap, st.st_size, MADV_SEQUENTIAL );
+    const bool bRes = pApply( (const char*)pMap, st.st_size, rTrie );
+    munmap( pMap, st.st_size );
+    return bRes;
+#else
+    std::ifstream sIn( sFileName.c_str(), std::ios::in | std::ios::binary );
+    if( !sIn.is_open() ) {
+        return false;
+    }
+    std::string sBuf;
+    ReadAll( sIn, sBuf );
+    return pApply( sBuf.data(), sBuf.size(), rTrie );
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -482,7 +880,25 @@ std::istream &operator>>( std::istream &stream, Trie &rTrie )
     return XMLToTrie( stream, rTrie );
     break;
   case CVARS_TXT_STREAM:
-    return TXTToTrie( stream, rTrie );
+    {
+      std::string sBuf;
+      ReadAll( stream, sBuf );
+      ApplyTXTBuffer( sBuf.data(), sBuf.size(), rTrie );
+    }
+    break;
+  case CVARS_BINARY_STREAM:
+    {
+      std::string sBuf;
+      ReadAll( stream, sBuf );
+      ApplyBinarySnapshot( sBuf.data(), sBuf.size(), rTrie );
+    }
+    break;
+  case CVARS_JSON_STREAM:
+    {
+      std::string sBuf;
+      ReadAll( stream, sBuf );
+      ApplyJSONBuffer( sBuf.data(), sBuf.size(), rTrie );
+    }
     break;
   default:
     std::cerr << "ERROR: unknown stream type" << std::endl;
@@ -0,0 +1,196 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Streaming reader of the XML CVars document (see XMLCVarReader.h) and the
+// escaping of XML text shared with the writer in Trie.cpp.
+
+#include "cvars/XMLCVarReader.h"
+
+#include <cstdlib>
+#include <iostream>
+
+////////////////////////////////////////////////////////////////////////////////
+void AppendXMLText( std::string& sOut, const char* s, size_t nLength )
+{
+    size_t nFrom = 0;
+    for( size_t nAt = 0; nAt < nLength; nAt++ ) {
+        const char* sEntity = s[nAt] == '&' ? "&amp;" : s[nAt] == '<' ? "&lt;" : s[nAt] == '>' ? "&gt;" : NULL;
+        if( sEntity != NULL ) {
+            sOut.append( s + nFrom, nAt - nFrom );
+            sOut += sEntity;
+            nFrom = nAt + 1;
+        }
+    }
+    sOut.append( s + nFrom, nLength - nFrom );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Appends the UTF-8 encoding of code point n.
+static void AppendUTF8( std::string& s, unsigned long n )
+{
+    if( n < 0x80 ) {
+        s += (char)n;
+    }
+    else if( n < 0x800 ) {
+        s += (char)( 0xC0 | ( n >> 6 ) );
+        s += (char)( 0x80 | ( n & 0x3F ) );
+    }
+    else if( n < 0x10000 ) {
+        s += (char)( 0xE0 | ( n >> 12 ) );
+        s += (char)( 0x80 | ( ( n >> 6 ) & 0x3F ) );
+        s += (char)( 0x80 | ( n & 0x3F ) );
+    }
+    else {
+        s += (char)( 0xF0 | ( n >> 18 ) );
+        s += (char)( 0x80 | ( ( n >> 12 ) & 0x3F ) );
+        s += (char)( 0x80 | ( ( n >> 6 ) & 0x3F ) );
+        s += (char)( 0x80 | ( n & 0x3F ) );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Resolves the predefined and numeric entities of XML text in place.
+static void DecodeXMLEntities( std::string& s )
+{
+    size_t nAmp = s.find( '&' );
+    if( nAmp == std::string::npos ) {
+        return;
+    }
+    std::string sDecoded( s, 0, nAmp );
+    for( size_t ii = nAmp; ii < s.size(); ii++ ) {
+        const size_t nSemi = s[ii] == '&' ? s.find( ';', ii ) : std::string::npos;
+        if( nSemi == std::string::npos || nSemi - ii > 10 ) {
+            sDecoded += s[ii];
+            continue;
+        }
+        const std::string sEntity( s, ii + 1, nSemi - ii - 1 );
+        if( sEntity == "lt" )        { sDecoded += '<'; }
+        else if( sEntity == "gt" )   { sDecoded += '>'; }
+        else if( sEntity == "amp" )  { sDecoded += '&'; }
+        else if( sEntity == "quot" ) { sDecoded += '"'; }
+        else if( sEntity == "apos" ) { sDecoded += '\''; }
+        else if( sEntity.size() > 1 && sEntity[0] == '#' ) {
+            const bool bHex = sEntity[1] == 'x' || sEntity[1] == 'X';
+            AppendUTF8( sDecoded, strtoul( sEntity.c_str() + ( bHex ? 2 : 1 ), NULL, bHex ? 16 : 10 ) );
+        }
+        else {
+            sDecoded += s[ii];
+            continue;
+        }
+        ii = nSemi;
+    }
+    s.swap( sDecoded );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool XMLCVarReader::Next( std::string& sName, std::string& sValue )
+{
+    std::string sTag, sTagName;
+    bool bNested = false;
+    while( ReadText( m_nDepth >= 2 ? &sValue : NULL ) ) {
+        int c = Get();
+        if( c == '?' ) {
+            if( !SkipPast( "?>", NULL ) ) {
+                break;
+            }
+            continue;
+        }
+        if( c == '!' ) {
+            // comment, CDATA section or declaration (DOCTYPE)
+            std::string sStart;
+            c = Get();
+            if( c == '-' || c == '[' ) {
+                sStart += (char)c;
+                const size_t nLen = ( c == '-' ) ? 2 : 7;
+                while( sStart.size() < nLen && ( c = Get() ) != EOF ) {
+                    sStart += (char)c;
+                }
+            }
+            if( sStart == "--" ) {
+                if( !SkipPast( "-->", NULL ) ) {
+                    break;
+                }
+            }
+            else if( sStart == "[CDATA[" ) {
+                std::string sData;
+                if( !SkipPast( "]]>", &sData ) ) {
+                    break;
+                }
+                if( m_nDepth >= 2 ) {
+                    // kept escaped so that decoding the value restores it
+                    AppendXMLText( sValue, sData.data(), sData.size() );
+                }
+            }
+            else if( !SkipPast( ">", NULL ) ) {
+                break;
+            }
+            continue;
+        }
+
+        bool bEndTag, bEmptyTag;
+        if( !ReadTag( c, sTag, sTagName, bEndTag, bEmptyTag ) ) {
+            break;
+        }
+        if( bEndTag ) {
+            if( m_nDepth == 1 && !m_vGroupStarts.empty() ) {
+                m_sGroup.resize( m_vGroupStarts.back() );
+                m_vGroupStarts.pop_back();
+                continue;
+            }
+            m_nDepth--;
+            if( m_nDepth <= 0 ) {
+                return false;
+            }
+            if( m_nDepth == 1 ) {
+                if( !bNested ) {
+                    DecodeXMLEntities( sValue );
+                }
+                sValue.erase( sValue.find_last_not_of( " \t\n\r" ) + 1 );
+                sValue.erase( 0, sValue.find_first_not_of( " \t\n\r" ) );
+                return true;
+            }
+            sValue += sTag;
+        }
+        else if( m_nDepth == 0 ) {
+            m_bFoundRoot = true;
+            if( bEmptyTag ) {
+                return false;
+            }
+            m_nDepth = 1;
+        }
+        else if( m_nDepth == 1 ) {
+            if( !sTagName.empty() && sTagName[ sTagName.size()-1 ] == '.' ) {
+                // namespace element, its CVars are named relative to it
+                if( !bEmptyTag ) {
+                    m_vGroupStarts.push_back( m_sGroup.size() );
+                    m_sGroup += sTagName;
+                }
+                continue;
+            }
+            sName = m_sGroup + sTagName;
+            sValue.clear();
+            bNested = false;
+            if( bEmptyTag ) {
+                return true;
+            }
+            m_nDepth = 2;
+        }
+        else {
+            bNested = true;
+            sValue += sTag;
+            if( !bEmptyTag ) {
+                m_nDepth++;
+            }
+        }
+    }
+    if( m_nDepth > 0 ) {
+        std::cerr << "ERROR: unexpected end of XML CVars document." << std::endl;
+        m_bError = true;
+    }
+    return false;
+}
@@ -0,0 +1,88 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Typed console commands (CreateCommand): argument conversions, quoted
+// arguments, wrong arguments reported with the usage, void and bool
+// commands, and commands never being saved.
+
+#include <cvars/CVar.h>
+#include <cvars/CVarCommand.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+const char* FILE_NAME = "CommandTest.txt";
+
+static int nErrors = 0;
+static int nCalls = 0;
+static std::string sLastCall;
+
+////////////////////////////////////////////////////////////////////////////////
+static void Check( bool bOk, const std::string& sWhat )
+{
+    if( !bOk ) {
+        std::cerr << "ERROR: " << sWhat << std::endl;
+        nErrors++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool Teleport( float fX, int nY, std::string_view sZone, bool bFast )
+{
+    sLastCall = std::to_string( fX ) + " " + std::to_string( nY ) + " " + std::string( sZone ) +
+        ( bFast ? " fast" : " slow" );
+    return sZone != "nowhere";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void Count()
+{
+    nCalls++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+    CVarUtils::CreateCommand( "cmd.teleport", Teleport, "Moves the player" );
+    CVarUtils::CreateCommand( "cmd.count", Count );
+    std::string sResult;
+
+    Check( CVarUtils::ProcessCommand( "cmd.teleport 10 +2 north on", sResult ) &&
+           sLastCall == "10.000000 2 north fast", "arguments converted (" + sLastCall + ")" );
+    Check( CVarUtils::ProcessCommand( "cmd.teleport -0.5 3 \"far away\" no", sResult ) &&
+           sLastCall == "-0.500000 3 far away slow", "a quoted argument (" + sLastCall + ")" );
+    Check( !CVarUtils::ProcessCommand( "cmd.teleport 1 2 nowhere yes", sResult ),
+           "a command returning false fails" );
+
+    sLastCall.clear();
+    Check( !CVarUtils::ProcessCommand( "cmd.teleport 1 2.5 north on", sResult ) && sLastCall.empty(),
+           "an argument that does not convert" );
+    Check( sResult.find( "argument 2 \"2.5\" is not an integer" ) != std::string::npos,
+           "the error names the argument (" + sResult + ")" );
+    Check( sResult.find( "cmd.teleport <number> <integer> <string> <bool>" ) != std::string::npos,
+           "the error gives the usage (" + sResult + ")" );
+    CVarUtils::ProcessCommand( "cmd.teleport 1 2 north maybe", sResult );
+    Check( sResult.find( "\"maybe\" is not a bool" ) != std::string::npos, "the article of bool (" + sResult + ")" );
+    Check( !CVarUtils::ProcessCommand( "cmd.teleport 1 2", sResult ) && sLastCall.empty(), "too few arguments" );
+    Check( !CVarUtils::ProcessCommand( "cmd.teleport 1 2 north on extra", sResult ) && sLastCall.empty(),
+           "too many arguments" );
+
+    Check( CVarUtils::ProcessCommand( "cmd.count; cmd.count", sResult ) && nCalls == 2, "a void command" );
+    Check( !CVarUtils::ProcessCommand( "cmd.count 1", sResult ) && nCalls == 2, "arguments to a command without" );
+
+    CVarUtils::SetStreamType( CVARS_TXT_STREAM );
+    CVarUtils::Save( FILE_NAME );
+    std::ifstream sIn( FILE_NAME );
+    const std::string sContents( ( std::istreambuf_iterator<char>( sIn ) ), std::istreambuf_iterator<char>() );
+    Check( sContents.find( "cmd." ) == std::string::npos, "commands are not saved" );
+    sIn.close();
+    remove( FILE_NAME );
+    return nErrors == 0 ? 0 : 1;
+}
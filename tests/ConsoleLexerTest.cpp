@@ -0,0 +1,122 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Console line lexing (NextCommand, NextCommandWord) and ProcessCommand on
+// top of it: ';' separated commands, tabs, quoted arguments such as
+// save "my file.xml", escapes inside double quotes, backslashes kept
+// elsewhere, and string CVars taking the whole assigned value.
+
+#include <cvars/CVar.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+static int nErrors = 0;
+static std::vector<std::string> vSaveArgs;
+
+////////////////////////////////////////////////////////////////////////////////
+static void Check( bool bOk, const std::string& sWhat )
+{
+    if( !bOk ) {
+        std::cerr << "ERROR: " << sWhat << std::endl;
+        nErrors++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool Save( std::vector<std::string>* pArgs )
+{
+    vSaveArgs = *pArgs;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static std::vector<std::string> Words( const std::string& sText )
+{
+    std::vector<std::string> vWords;
+    std::string_view sRest( sText ), sWord;
+    std::string sUnescaped;
+    while( CVarUtils::NextCommandWord( sRest, sWord, sUnescaped ) ) {
+        vWords.push_back( std::string( sWord ) );
+    }
+    return vWords;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static std::vector<std::string> Commands( const std::string& sLine )
+{
+    std::vector<std::string> vCommands;
+    std::string_view sRest( sLine ), sCommand;
+    while( CVarUtils::NextCommand( sRest, sCommand ) ) {
+        vCommands.push_back( std::string( sCommand ) );
+    }
+    return vCommands;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestLexer()
+{
+    Check( Words( "a \t b\tc" ) == std::vector<std::string>( { "a", "b", "c" } ), "blanks and tabs split words" );
+    Check( Words( "\"my file.xml\" 'x y'" ) == std::vector<std::string>( { "my file.xml", "x y" } ),
+           "quoted words" );
+    Check( Words( "pre\"fix suf\"fix" ) == std::vector<std::string>( { "prefix suffix" } ),
+           "a word mixing quoted and unquoted parts" );
+    Check( Words( "\"a\\\"b\\n\\t\\\\\"" ) == std::vector<std::string>( { "a\"b\n\t\\" } ),
+           "escapes inside double quotes" );
+    Check( Words( "C:\\data\\x.xml '\\n'" ) == std::vector<std::string>( { "C:\\data\\x.xml", "\\n" } ),
+           "backslashes outside double quotes are kept" );
+    Check( Words( " \t " ).empty(), "a blank line has no words" );
+
+    Check( Commands( "a = 1; b = 2 ;;c" ) == std::vector<std::string>( { "a = 1", "b = 2", "", "c" } ),
+           "';' separates commands" );
+    Check( Commands( "echo \"x; y\"; z" ) == std::vector<std::string>( { "echo \"x; y\"", "z" } ),
+           "a quoted ';' does not" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestProcessCommand()
+{
+    int& nX = CVarUtils::CreateCVar( "lex.x", 0 );
+    int& nY = CVarUtils::CreateCVar( "lex.y", 0 );
+    std::string& sStr = CVarUtils::CreateCVar( "lex.str", std::string() );
+    std::vector<int>& vInts = CVarUtils::CreateCVar( "lex.ints", std::vector<int>() );
+    CVarUtils::CreateCVar( "save", Save, "records its arguments" );
+    std::string sResult;
+
+    Check( CVarUtils::ProcessCommand( "save \"my file.xml\" filter", sResult ) &&
+           vSaveArgs == std::vector<std::string>( { "my file.xml", "filter" } ), "save \"my file.xml\"" );
+    Check( CVarUtils::ProcessCommand( "save\tC:\\data\\x.xml", sResult ) &&
+           vSaveArgs == std::vector<std::string>( { "C:\\data\\x.xml" } ), "save of a Windows path" );
+
+    Check( CVarUtils::ProcessCommand( "lex.x = 1; lex.y=2", sResult ) && nX == 1 && nY == 2,
+           "two assignments separated by ';'" );
+    Check( sResult == "1\n2", "one result line per command (" + sResult + ")" );
+    Check( CVarUtils::ProcessCommand( "lex.x\t=\t3", sResult ) && nX == 3, "tabs around '='" );
+    Check( !CVarUtils::ProcessCommand( "lex.x = 4; lex.none = 1", sResult ) && nX == 4,
+           "a failing command does not stop the others" );
+
+    CVarUtils::ProcessCommand( "lex.str = \"two words\"", sResult );
+    Check( sStr == "two words", "quoted string value (" + sStr + ")" );
+    CVarUtils::ProcessCommand( "lex.str = two  words", sResult );
+    Check( sStr == "two  words", "unquoted string value (" + sStr + ")" );
+    CVarUtils::ProcessCommand( "lex.str = \"say \\\"hi\\\"\"", sResult );
+    Check( sStr == "say \"hi\"", "escaped quotes (" + sStr + ")" );
+    CVarUtils::ProcessCommand( "lex.str = 'a;b'; lex.x = 5", sResult );
+    Check( sStr == "a;b" && nX == 5, "quoted ';' in a value (" + sStr + ")" );
+    CVarUtils::ProcessCommand( "lex.ints = [ 1 2 3 ]", sResult );
+    Check( vInts == std::vector<int>( { 1, 2, 3 } ), "a vector value is kept as typed" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+    TestLexer();
+    TestProcessCommand();
+    return nErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Derived CVars: evaluation, propagation through SetCVar, the console and
+// Load, diamond shaped dependencies, release of derived CVars and of their
+// inputs, and writes to derived CVars being refused.
+
+#include <cvars/CVar.h>
+#include <cvars/CVarExpression.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+const size_t NUM_DIAMONDS = 25;
+const char*  FILE_NAME    = "DerivedCVarTest.txt";
+
+static int nErrors = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+static void Check( bool bOk, const std::string& sWhat )
+{
+    if( !bOk ) {
+        std::cerr << "ERROR: " << sWhat << std::endl;
+        nErrors++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void WriteFile( const std::string& sContents )
+{
+    std::ofstream sOut( FILE_NAME );
+    sOut << sContents;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestEvaluation()
+{
+    CVarUtils::CreateCVar( "eval.a", 2 );
+    CVarUtils::CreateCVar( "eval.b", 1.5 );
+    const double& dValue = CVarUtils::CreateDerivedCVar<double>(
+            "eval.value", "-eval.a * 10 + max( eval.b, 1 ) ^ 2 - clamp( 7, 0, 5 ) % 3" );
+    Check( dValue == -20 + 2.25 - 2, "evaluation of eval.value" );
+    const int& nRounded = CVarUtils::CreateDerivedCVar<int>( "eval.rounded", "eval.b * 3" );
+    Check( nRounded == 5, "eval.rounded is rounded to the nearest integer" );
+
+    bool bThrown = false;
+    try {
+        CVarUtils::CreateDerivedCVar<int>( "eval.bad", "eval.a + eval.unknown" );
+    }
+    catch( CVarUtils::CVarException e ) {
+        bThrown = e == CVarUtils::InvalidExpression;
+    }
+    Check( bThrown, "an unknown input throws InvalidExpression" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestPropagation()
+{
+    CVarUtils::CreateCVar( "prop.scale", 1 );
+    const int& nSize = CVarUtils::CreateDerivedCVar<int>( "prop.size", "1024 * prop.scale" );
+    const int& nHalf = CVarUtils::CreateDerivedCVar<int>( "prop.half", "prop.size / 2" );
+
+    CVarUtils::SetCVar( "prop.scale", 2 );
+    Check( nSize == 2048 && nHalf == 1024, "SetCVar propagates to prop.size and prop.half" );
+
+    std::string sResult;
+    CVarUtils::ProcessCommand( "prop.scale = 3", sResult );
+    Check( nSize == 3072 && nHalf == 1536, "the console propagates" );
+
+    WriteFile( "prop.scale = 4\n" );
+    CVarUtils::SetStreamType( CVARS_TXT_STREAM );
+    CVarUtils::Load( FILE_NAME );
+    Check( nSize == 4096 && nHalf == 2048, "Load propagates" );
+
+    CVarUtils::GetCVarRef<int>( "prop.scale" ) = 5;
+    CVarUtils::NotifyChanged( "prop.scale" );
+    Check( nSize == 5120 && nHalf == 2560, "NotifyChanged propagates" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// p(i+1) = l(i) + r(i) - p(i) with l(i) = p(i) + 1 and r(i) = p(i) + 2, so
+// p(i) = p(0) + 3i: every level doubles the paths from p(0).
+static void TestDiamonds()
+{
+    CVarUtils::CreateCVar( "diamond.p0", 0 );
+    const int* pLast = NULL;
+    for( size_t ii = 0; ii < NUM_DIAMONDS; ii++ ) {
+        const std::string sP = "diamond.p" + std::to_string( ii );
+        const std::string sL = "diamond.l" + std::to_string( ii );
+        const std::string sR = "diamond.r" + std::to_string( ii );
+        CVarUtils::CreateDerivedCVar<int>( sL, sP + " + 1" );
+        CVarUtils::CreateDerivedCVar<int>( sR, sP + " + 2" );
+        pLast = &CVarUtils::CreateDerivedCVar<int>( "diamond.p" + std::to_string( ii + 1 ),
+                                                    sL + " + " + sR + " - " + sP );
+    }
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    CVarUtils::SetCVar( "diamond.p0", 10 );
+    const double dMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start ).count();
+    Check( *pLast == 10 + 3 * (int)NUM_DIAMONDS, "value at the end of the diamond chain" );
+    Check( dMs < 100, "the diamond chain took " + std::to_string( dMs ) + " ms" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// A derived CVar outside the Trie, released before or after its input.
+static CVarUtils::CVar<int>* CreateLooseDerivedCVar( const std::string& sExpression )
+{
+    CVarUtils::CVar<int>* pCVar = new CVarUtils::CVar<int>( "release.loose", 0, "", false );
+    CVarUtils::CVarDerivation* pDerivation = new CVarUtils::CVarDerivation;
+    std::string sError;
+    pDerivation->m_Expression.Compile( sExpression, sError );
+    pDerivation->m_pCVar = pCVar;
+    pDerivation->m_pAssignFuncPtr = CVarUtils::CVarNumeric<int>::Assign;
+    CVarUtils::AttachCVarDerivation( pCVar, pDerivation );
+    return pCVar;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestRelease()
+{
+    CVarUtils::CreateCVar( "release.in", 3 );
+    CVarUtils::CVar<int>* pInput = (CVarUtils::CVar<int>*)CVarUtils::TrieInstance().Find( "release.in" )->m_pNodeData;
+
+    // the derived CVar goes first: its input no longer refers to it
+    CVarUtils::CVar<int>* pDerived = CreateLooseDerivedCVar( "release.in * 2" );
+    Check( *pDerived->m_pVarData == 6 && pInput->m_vDependents.size() == 1, "loose derived CVar attached" );
+    delete pDerived;
+    Check( pInput->m_vDependents.empty(), "a released derived CVar is removed from its input" );
+    CVarUtils::SetCVar( "release.in", 4 );
+
+    // the input goes first (as in ~CVar): the derived CVar keeps its value
+    pDerived = CreateLooseDerivedCVar( "release.in * 2 + 1" );
+    CVarUtils::DetachCVarDependents( pInput );
+    CVarUtils::SetCVar( "release.in", 5 );
+    Check( *pDerived->m_pVarData == 9, "a derived CVar keeps the value of a released input" );
+    CVarUtils::RefreshDerivedCVar( pDerived );
+    Check( *pDerived->m_pVarData == 9, "a released input is replaced by its last value" );
+    delete pDerived;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestReadOnly()
+{
+    CVarUtils::CreateCVar( "ro.in", 2 );
+    const int& nTwice = CVarUtils::CreateDerivedCVar<int>( "ro.twice", "ro.in * 2" );
+
+    std::string sResult;
+    Check( !CVarUtils::ProcessCommand( "ro.twice = 100", sResult ) && nTwice == 4,
+           "the console refuses to write ro.twice (" + sResult + ")" );
+
+    bool bThrown = false;
+    try {
+        CVarUtils::SetCVar( "ro.twice", 100 );
+    }
+    catch( CVarUtils::CVarException e ) {
+        bThrown = e == CVarUtils::ReadOnlyCVar;
+    }
+    Check( bThrown && nTwice == 4, "SetCVar throws ReadOnlyCVar for ro.twice" );
+
+    const char* argv[] = { "test", "+ro.twice=3", "+ro.later=3" };
+    CVarUtils::ApplyArgs( 3, argv );
+    Check( nTwice == 4, "ApplyArgs leaves ro.twice" );
+
+    WriteFile( "ro.twice = 7\nro.later = 7\n" );
+    CVarUtils::SetStreamType( CVARS_TXT_STREAM );
+    CVarUtils::Load( FILE_NAME );
+    Check( nTwice == 4, "Load leaves ro.twice" );
+    Check( !((CVarUtils::CVar<int>*)CVarUtils::TrieInstance().Find( "ro.twice" )->m_pNodeData)
+           ->SetValueFromString( "8" ) && nTwice == 4, "SetValueFromString leaves ro.twice" );
+
+    // values kept for a derived CVar created later are dropped
+    const int& nLater = CVarUtils::CreateDerivedCVar<int>( "ro.later", "ro.in + 1" );
+    Check( nLater == 3, "ro.later ignores the values kept for it" );
+    CVarUtils::SetCVar( "ro.in", 5 );
+    Check( nTwice == 10 && nLater == 6, "read only CVars still follow their input" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+    TestEvaluation();
+    TestPropagation();
+    TestDiamonds();
+    TestRelease();
+    TestReadOnly();
+    remove( FILE_NAME );
+    return nErrors == 0 ? 0 : 1;
+}
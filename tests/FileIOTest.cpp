@@ -0,0 +1,222 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Save and Load round trips in every stream type (XML, TXT, JSON, binary,
+// grouped XML and TXT), SaveDelta and its compaction into a full save,
+// SaveAsync, and Load skipping unchanged files (SetUnchangedLoads).
+
+#include <cvars/CVar.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const char* FILE_NAME  = "FileIOTest.out";
+const char* DELTA_NAME = "FileIOTest.out.delta";
+
+static int nErrors = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+static void Check( bool bOk, const std::string& sWhat )
+{
+    if( !bOk ) {
+        std::cerr << "ERROR: " << sWhat << std::endl;
+        nErrors++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct TestCVars
+{
+    int*                      m_pInt;
+    double*                   m_pDouble;
+    bool*                     m_pBool;
+    std::string*              m_pString;
+    std::vector<int>*         m_pInts;
+    std::vector<std::string>* m_pStrings;
+    int*                      m_pNested;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static void SetValues( TestCVars& cvars, bool bExpected )
+{
+    *cvars.m_pInt = bExpected ? -42 : 0;
+    *cvars.m_pDouble = bExpected ? 2.5 : 0;
+    *cvars.m_pBool = bExpected;
+    *cvars.m_pString = bExpected ? "a <b> & \"c\"" : "";
+    *cvars.m_pInts = bExpected ? std::vector<int>( { 1, -2, 3 } ) : std::vector<int>();
+    *cvars.m_pStrings = bExpected ? std::vector<std::string>( { "one", "two" } ) : std::vector<std::string>();
+    *cvars.m_pNested = bExpected ? 7 : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool HasValues( const TestCVars& cvars )
+{
+    return *cvars.m_pInt == -42 && *cvars.m_pDouble == 2.5 && *cvars.m_pBool &&
+        *cvars.m_pString == "a <b> & \"c\"" && *cvars.m_pInts == std::vector<int>( { 1, -2, 3 } ) &&
+        *cvars.m_pStrings == std::vector<std::string>( { "one", "two" } ) && *cvars.m_pNested == 7;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool FileExists( const char* sFileName )
+{
+    return std::ifstream( sFileName ).is_open();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestRoundTrips( TestCVars& cvars )
+{
+    const CVARS_STREAM_TYPE streamTypes[] = { CVARS_XML_STREAM, CVARS_TXT_STREAM, CVARS_JSON_STREAM,
+                                              CVARS_BINARY_STREAM, CVARS_XML_STREAM, CVARS_TXT_STREAM };
+    const char* sFormats[] = { "XML", "TXT", "JSON", "binary", "grouped XML", "grouped TXT" };
+    for( int nFormat = 0; nFormat < 6; nFormat++ ) {
+        CVarUtils::SetStreamType( streamTypes[nFormat] );
+        CVarUtils::SetGroupedNames( nFormat >= 4 );
+        SetValues( cvars, true );
+        Check( CVarUtils::Save( FILE_NAME ), std::string( "saving " ) + sFormats[nFormat] );
+        SetValues( cvars, false );
+        Check( CVarUtils::Load( FILE_NAME ) && HasValues( cvars ),
+               std::string( "values loaded back from " ) + sFormats[nFormat] );
+    }
+    CVarUtils::SetGroupedNames( false );
+
+    // a filter keeps the other CVars as they are
+    CVarUtils::SetStreamType( CVARS_TXT_STREAM );
+    CVarUtils::Save( FILE_NAME );
+    SetValues( cvars, false );
+    CVarUtils::Load( FILE_NAME, { "io.nested." } );
+    Check( *cvars.m_pNested == 7 && *cvars.m_pInt == 0, "a filtered Load" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestSaveDelta( TestCVars& cvars )
+{
+    CVarUtils::SetStreamType( CVARS_XML_STREAM );
+    SetValues( cvars, true );
+    // the first SaveDelta of a file is a full save
+    Check( CVarUtils::SaveDelta( FILE_NAME ) && !FileExists( DELTA_NAME ), "first SaveDelta" );
+
+    *cvars.m_pInt = 5;
+    Check( CVarUtils::SaveDelta( FILE_NAME ) && FileExists( DELTA_NAME ), "SaveDelta of one change" );
+    std::ifstream sDelta( DELTA_NAME );
+    const std::string sContents( ( std::istreambuf_iterator<char>( sDelta ) ), std::istreambuf_iterator<char>() );
+    sDelta.close();
+    Check( sContents == "io.int = 5\n", "the delta holds the change only (" + sContents + ")" );
+
+    SetValues( cvars, false );
+    CVarUtils::Load( FILE_NAME );
+    Check( *cvars.m_pInt == 5 && *cvars.m_pNested == 7, "Load applies the delta after the file" );
+
+    // once the delta outgrows half of the file it is folded into a full save
+    for( int nRep = 0; nRep < 100 && FileExists( DELTA_NAME ); nRep++ ) {
+        *cvars.m_pString = "changed " + std::to_string( nRep );
+        CVarUtils::SaveDelta( FILE_NAME );
+    }
+    Check( !FileExists( DELTA_NAME ), "the delta is compacted into a full save" );
+    const std::string sLast = *cvars.m_pString;
+    SetValues( cvars, false );
+    CVarUtils::Load( FILE_NAME );
+    Check( *cvars.m_pInt == 5 && *cvars.m_pString == sLast, "values after the compaction" );
+
+    CVarUtils::Save( FILE_NAME );
+    Check( !FileExists( DELTA_NAME ), "Save removes the delta" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestSaveAsync( TestCVars& cvars )
+{
+    CVarUtils::SetStreamType( CVARS_XML_STREAM );
+    SetValues( cvars, true );
+    std::future<bool> result = CVarUtils::SaveAsync( FILE_NAME );
+    // the values are copied by SaveAsync, later writes are not saved
+    SetValues( cvars, false );
+    Check( result.get(), "SaveAsync result" );
+    Check( CVarUtils::Load( FILE_NAME ) && HasValues( cvars ), "values saved by SaveAsync" );
+
+    // Load waits for the pending saves of the file
+    *cvars.m_pInt = 1;
+    for( int nRep = 0; nRep < 10; nRep++ ) {
+        CVarUtils::SaveAsync( FILE_NAME );
+    }
+    *cvars.m_pInt = 2;
+    CVarUtils::Load( FILE_NAME );
+    Check( *cvars.m_pInt == 1, "Load after SaveAsync reads the saved file" );
+
+    bool bCalled = false, bCallbackOk = false;
+    CVarUtils::SaveAsync( FILE_NAME, std::vector<std::string>(),
+                          [&]( bool bOk, const std::string& ) { bCalled = true; bCallbackOk = bOk; } );
+    CVarUtils::WaitForAsyncSaves();
+    Check( bCalled && bCallbackOk, "SaveAsync callback" );
+    Check( !FileExists( ( std::string( FILE_NAME ) + ".tmp" ).c_str() ), "no temporary file left" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Rewrites the file keeping its size and modification time.
+static void RewriteKeepingStamp( const std::string& sFrom, const std::string& sTo )
+{
+    const std::filesystem::file_time_type mtime = std::filesystem::last_write_time( FILE_NAME );
+    std::ifstream sIn( FILE_NAME );
+    std::string sContents( ( std::istreambuf_iterator<char>( sIn ) ), std::istreambuf_iterator<char>() );
+    sIn.close();
+    sContents.replace( sContents.find( sFrom ), sFrom.size(), sTo );
+    std::ofstream( FILE_NAME ) << sContents;
+    std::filesystem::last_write_time( FILE_NAME, mtime );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestUnchangedLoads( TestCVars& cvars )
+{
+    CVarUtils::SetStreamType( CVARS_TXT_STREAM );
+    SetValues( cvars, true );
+    CVarUtils::SetUnchangedLoads( CVARS_SKIP_SAME_MTIME );
+    CVarUtils::Save( FILE_NAME );
+
+    // same size and mtime: the file is trusted to be the one saved
+    RewriteKeepingStamp( "io.int = -42", "io.int = -43" );
+    Check( CVarUtils::Load( FILE_NAME ) && *cvars.m_pInt == -42, "SKIP_SAME_MTIME skips the file" );
+
+    // the content hash tells it changed
+    CVarUtils::SetUnchangedLoads( CVARS_SKIP_SAME_CONTENT );
+    Check( CVarUtils::Load( FILE_NAME ) && *cvars.m_pInt == -43, "SKIP_SAME_CONTENT loads the new content" );
+
+    // writes through references are seen
+    RewriteKeepingStamp( "io.int = -43", "io.int = -44" );
+    CVarUtils::SetUnchangedLoads( CVARS_SKIP_SAME_MTIME );
+    *cvars.m_pInt = 0;
+    Check( CVarUtils::Load( FILE_NAME ) && *cvars.m_pInt == -44, "a changed CVar is loaded again" );
+
+    // as are other filters
+    RewriteKeepingStamp( "io.int = -44", "io.int = -45" );
+    CVarUtils::Load( FILE_NAME, { "io." } );
+    Check( *cvars.m_pInt == -45, "a Load with other filters is not skipped" );
+    CVarUtils::SetUnchangedLoads( CVARS_ALWAYS_LOAD );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+    TestCVars cvars;
+    cvars.m_pInt = &CVarUtils::CreateCVar( "io.int", 0 );
+    cvars.m_pDouble = &CVarUtils::CreateCVar( "io.double", 0.0 );
+    cvars.m_pBool = &CVarUtils::CreateCVar( "io.bool", false );
+    cvars.m_pString = &CVarUtils::CreateCVar( "io.string", std::string() );
+    cvars.m_pInts = &CVarUtils::CreateCVar( "io.ints", std::vector<int>() );
+    cvars.m_pStrings = &CVarUtils::CreateCVar( "io.strings", std::vector<std::string>() );
+    cvars.m_pNested = &CVarUtils::CreateCVar( "io.nested.value", 0 );
+
+    TestRoundTrips( cvars );
+    TestSaveDelta( cvars );
+    TestSaveAsync( cvars );
+    TestUnchangedLoads( cvars );
+    remove( FILE_NAME );
+    remove( DELTA_NAME );
+    return nErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Journal mode: changes replayed by OpenJournal, incomplete or corrupted
+// records cut off, compaction into the snapshot, and a filtered Load while
+// every change triggers a compaction.
+
+#include <cvars/CVar.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const char* FILE_NAME    = "JournalTest.bin";
+const char* JOURNAL_NAME = "JournalTest.bin.journal";
+const char* OLD_NAME     = "JournalTest.bin.journal.1";
+const char* TXT_NAME     = "JournalTest.txt";
+const size_t HEADER_SIZE  = 16; // CVarJournalHeader
+
+static int nErrors = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+static void Check( bool bOk, const std::string& sWhat )
+{
+    if( !bOk ) {
+        std::cerr << "ERROR: " << sWhat << std::endl;
+        nErrors++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void RemoveFiles()
+{
+    remove( FILE_NAME );
+    remove( JOURNAL_NAME );
+    remove( OLD_NAME );
+    remove( TXT_NAME );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static size_t JournalSize()
+{
+    std::error_code error;
+    return std::filesystem::file_size( JOURNAL_NAME, error );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestReplay()
+{
+    int& nInt = CVarUtils::CreateCVar( "journal.int", 0 );
+    std::string& sString = CVarUtils::CreateCVar( "journal.string", std::string() );
+    std::vector<int>& vInts = CVarUtils::CreateCVar( "journal.ints", std::vector<int>() );
+
+    Check( CVarUtils::OpenJournal( FILE_NAME ), "OpenJournal without snapshot nor journal" );
+    CVarUtils::SetCVar( "journal.int", 3 );
+    std::string sResult;
+    CVarUtils::ProcessCommand( "journal.string = two words; journal.ints = [ 1 2 ]", sResult );
+    CVarUtils::CloseJournal();
+
+    nInt = 0;
+    sString.clear();
+    vInts.clear();
+    Check( CVarUtils::OpenJournal( FILE_NAME ), "OpenJournal of the journal" );
+    Check( nInt == 3 && sString == "two words" && vInts == std::vector<int>( { 1, 2 } ),
+           "values replayed from the journal" );
+
+    // a record for the same CVar is appended again after reopening
+    CVarUtils::SetCVar( "journal.int", 4 );
+    CVarUtils::CloseJournal();
+    nInt = 0;
+    CVarUtils::OpenJournal( FILE_NAME );
+    Check( nInt == 4, "the last value journaled wins" );
+    CVarUtils::CloseJournal();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestTruncation()
+{
+    int& nInt = CVarUtils::GetCVarRef<int>( "journal.int" );
+    CVarUtils::OpenJournal( FILE_NAME );
+    CVarUtils::SetCVar( "journal.int", 5 );
+    CVarUtils::CloseJournal();
+    const size_t nValid = JournalSize();
+
+    // the process died while appending a record
+    std::ofstream( JOURNAL_NAME, std::ios::out | std::ios::binary | std::ios::app ) << "partial";
+    nInt = 0;
+    Check( CVarUtils::OpenJournal( FILE_NAME ) && nInt == 5, "replay up to an incomplete record" );
+    Check( JournalSize() == nValid, "the incomplete record is cut off" );
+
+    // a corrupted record and the ones following it are ignored
+    CVarUtils::SetCVar( "journal.int", 6 );
+    CVarUtils::SetCVar( "journal.int", 7 );
+    CVarUtils::CloseJournal();
+    {
+        std::fstream sJournal( JOURNAL_NAME, std::ios::in | std::ios::out | std::ios::binary );
+        // the last byte of the value 7
+        sJournal.seekp( -1, std::ios::end );
+        sJournal.put( 'X' );
+    }
+    nInt = 0;
+    CVarUtils::OpenJournal( FILE_NAME );
+    Check( nInt == 6, "replay stops at a corrupted record (" + std::to_string( nInt ) + ")" );
+    CVarUtils::CloseJournal();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestCompaction()
+{
+    int& nInt = CVarUtils::GetCVarRef<int>( "journal.int" );
+    std::string& sString = CVarUtils::GetCVarRef<std::string>( "journal.string" );
+    CVarUtils::OpenJournal( FILE_NAME );
+    CVarUtils::SetCVar( "journal.int", 8 );
+    Check( CVarUtils::CompactJournal(), "CompactJournal" );
+    CVarUtils::WaitForAsyncSaves();
+    Check( !std::ifstream( OLD_NAME ).is_open(), "the old journal is removed once the snapshot is written" );
+    Check( JournalSize() == HEADER_SIZE, "the journal starts again" );
+    CVarUtils::CloseJournal();
+
+    nInt = 0;
+    sString.clear();
+    CVarUtils::OpenJournal( FILE_NAME );
+    Check( nInt == 8 && sString == "two words", "values loaded from the compacted snapshot" );
+    CVarUtils::CloseJournal();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Every change goes over nCompactBytes: the compaction waits for the end of
+// the Load, whose filters must not be replaced by the ones of the snapshot.
+static void TestFilteredLoad()
+{
+    int& nKeep = CVarUtils::CreateCVar( "keep.a", 0 );
+    int& nDrop = CVarUtils::CreateCVar( "drop.b", 0 );
+    std::ofstream( TXT_NAME ) << "keep.a = 5\ndrop.b = 6\n";
+
+    CVarUtils::OpenJournal( FILE_NAME, 1 );
+    CVarUtils::SetStreamType( CVARS_TXT_STREAM );
+    CVarUtils::Load( TXT_NAME, { "keep." } );
+    Check( nKeep == 5 && nDrop == 0, "filtered Load while journaling (drop.b = " + std::to_string( nDrop ) + ")" );
+    CVarUtils::WaitForAsyncSaves();
+    CVarUtils::CloseJournal();
+
+    nKeep = 0;
+    CVarUtils::OpenJournal( FILE_NAME );
+    Check( nKeep == 5 && nDrop == 0, "values journaled by the filtered Load" );
+    CVarUtils::CloseJournal();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+    RemoveFiles();
+    TestReplay();
+    TestTruncation();
+    TestCompaction();
+    TestFilteredLoad();
+    RemoveFiles();
+    return nErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Values of CVars not created yet: kept by Load, ApplyEnvironment and
+// ApplyArgs, applied in that order when the CVar is created, dropped by
+// ClearPendingValues; and the overrides of existing CVars.
+
+#include <cvars/CVar.h>
+#include <cvars/Trie.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+const char* FILE_NAME = "PendingValuesTest.txt";
+
+static int nErrors = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+static void Check( bool bOk, const std::string& sWhat )
+{
+    if( !bOk ) {
+        std::cerr << "ERROR: " << sWhat << std::endl;
+        nErrors++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void SetEnvironment( const char* sName, const char* sValue )
+{
+#ifdef _WIN32
+    _putenv_s( sName, sValue );
+#else
+    setenv( sName, sValue, 1 );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestLoad()
+{
+    std::ofstream( FILE_NAME ) << "late.int = 3\nlate.string = two words\nlate.dropped = 4\n";
+    CVarUtils::SetStreamType( CVARS_TXT_STREAM );
+    CVarUtils::Load( FILE_NAME );
+    Check( CVarUtils::TrieInstance().GetPendingValues().size() == 3, "Load keeps the values of unknown CVars" );
+
+    Check( CVarUtils::CreateCVar( "late.int", 0 ) == 3, "a kept value is applied when the CVar is created" );
+    Check( CVarUtils::CreateCVar( "late.string", std::string() ) == "two words", "a kept string value" );
+    Check( CVarUtils::TrieInstance().GetPendingValues().size() == 1, "applied values are no longer kept" );
+
+    CVarUtils::ClearPendingValues();
+    Check( CVarUtils::TrieInstance().GetNumPendingValues() == 0, "ClearPendingValues" );
+    Check( CVarUtils::CreateCVar( "late.dropped", 0 ) == 0, "a cleared value is not applied" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestApplyArgs()
+{
+    int& nNow = CVarUtils::CreateCVar( "args.now", 0 );
+    const char* argv[] = { "test", "+args.now=1", "--cvar", "args.string=a = b", "--cvar=args.later=2",
+                           "args.ignored=3", "+malformed" };
+    Check( CVarUtils::ApplyArgs( 7, argv ) == 3, "ApplyArgs counts the overrides" );
+    Check( nNow == 1, "+name=value" );
+    Check( CVarUtils::CreateCVar( "args.string", std::string() ) == "a = b", "--cvar name=value" );
+    Check( CVarUtils::CreateCVar( "args.later", 0 ) == 2, "--cvar=name=value, applied on creation" );
+    Check( CVarUtils::CreateCVar( "args.ignored", 0 ) == 0, "arguments without prefix are ignored" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestApplyEnvironment()
+{
+    int& nNow = CVarUtils::CreateCVar( "env.now", 0 );
+    SetEnvironment( "CVARSTEST_ENV_NOW", "1" );
+    SetEnvironment( "CVARSTEST_ENV_LATER_VALUE", "2" );
+    SetEnvironment( "OTHER_ENV_NOW", "3" );
+    Check( CVarUtils::ApplyEnvironment( "CVARSTEST_" ) == 2, "ApplyEnvironment counts the overrides" );
+    Check( nNow == 1, "the variable of env.now" );
+    Check( CVarUtils::CreateCVar( "env.later.value", 0 ) == 2, "an environment value applied on creation" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void TestPrecedence()
+{
+    std::ofstream( FILE_NAME ) << "order.all = 1\norder.load = 1\norder.env = 1\n";
+    CVarUtils::Load( FILE_NAME );
+    SetEnvironment( "CVARSTEST_ORDER_ALL", "2" );
+    SetEnvironment( "CVARSTEST_ORDER_ENV", "2" );
+    CVarUtils::ApplyEnvironment( "CVARSTEST_" );
+    const char* argv[] = { "test", "+order.all=3" };
+    CVarUtils::ApplyArgs( 2, argv );
+
+    Check( CVarUtils::CreateCVar( "order.all", 0 ) == 3, "arguments win over the environment and Load" );
+    Check( CVarUtils::CreateCVar( "order.env", 0 ) == 2, "the environment wins over Load" );
+    Check( CVarUtils::CreateCVar( "order.load", 0 ) == 1, "the value of Load" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+    TestLoad();
+    TestApplyArgs();
+    TestApplyEnvironment();
+    TestPrecedence();
+    remove( FILE_NAME );
+    return nErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Snapshots: TakeSnapshot with filters, RestoreSnapshot of trivially
+// copyable and copied values notifying the changed CVars only, derived CVars
+// following a restore, and CVarSnapshot::Difference.
+
+#include <cvars/CVar.h>
+#include <cvars/CVarExpression.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+static int nErrors = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+static void Check( bool bOk, const std::string& sWhat )
+{
+    if( !bOk ) {
+        std::cerr << "ERROR: " << sWhat << std::endl;
+        nErrors++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+    int& nInt = CVarUtils::CreateCVar( "snap.int", 1 );
+    double& dDouble = CVarUtils::CreateCVar( "snap.double", 1.5 );
+    std::string& sString = CVarUtils::CreateCVar( "snap.string", std::string( "one" ) );
+    std::vector<int>& vInts = CVarUtils::CreateCVar( "snap.ints", std::vector<int>( { 1, 2 } ) );
+    int& nOther = CVarUtils::CreateCVar( "other.int", 1 );
+    const int& nTwice = CVarUtils::CreateDerivedCVar<int>( "snap.twice", "snap.int * 2" );
+
+    CVarUtils::CVarSnapshot first = CVarUtils::TakeSnapshot( { "snap." } );
+    Check( first.size() == 4, "the snapshot holds the filtered CVars but the derived one ("
+           + std::to_string( first.size() ) + ")" );
+
+    nInt = 2;
+    sString = "two";
+    nOther = 2;
+    Check( CVarUtils::RestoreSnapshot( first ) == 2, "the changed CVars are counted" );
+    Check( nInt == 1 && sString == "one" && dDouble == 1.5 && vInts == std::vector<int>( { 1, 2 } ),
+           "values restored" );
+    Check( nOther == 2, "CVars outside the snapshot are left" );
+    Check( nTwice == 2, "a derived CVar follows the restore" );
+    Check( CVarUtils::RestoreSnapshot( first ) == 0, "restoring the same values notifies nothing" );
+
+    // a snapshot can be moved
+    CVarUtils::SetCVar( "snap.int", 3 );
+    vInts.push_back( 3 );
+    CVarUtils::CVarSnapshot second( CVarUtils::TakeSnapshot( { "snap." } ) );
+    CVarUtils::CVarSnapshot moved;
+    moved = std::move( second );
+    CVarUtils::RestoreSnapshot( first );
+    Check( CVarUtils::RestoreSnapshot( moved ) == 2 && nInt == 3 && nTwice == 6 &&
+           vInts == std::vector<int>( { 1, 2, 3 } ), "restoring a moved snapshot" );
+
+    // the difference restored over the first values gives the second ones
+    CVarUtils::CVarSnapshot difference = CVarUtils::CVarSnapshot::Difference( first, moved );
+    Check( difference.size() == 2, "the difference holds the CVars that differ ("
+           + std::to_string( difference.size() ) + ")" );
+    CVarUtils::RestoreSnapshot( first );
+    CVarUtils::RestoreSnapshot( difference );
+    Check( nInt == 3 && vInts == std::vector<int>( { 1, 2, 3 } ) && sString == "one",
+           "restoring the difference over the first values" );
+    return nErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+/*
+
+    Cross platform "CVars" functionality.
+
+    This Code is covered under the LGPL.  See COPYING file for the license.
+
+ */
+
+// Generates a ~100 MB XML settings file (200k scalar CVars, some of them in
+// namespace elements, and eight vectors of 1.5M numbers) and loads it with
+// CVarUtils::Load, half of the CVars being registered.  Checks the values of
+// the registered CVars, the values kept for the others until they are
+// created, and that the memory used while loading stays bounded by the
+// values kept rather than the file size (the file is streamed by
+// XMLCVarReader).
+
+#include <cvars/CVar.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN_
+#include <sys/resource.h>
+#endif
+
+const size_t NUM_SCALARS = 200000;
+const size_t NUM_VECTORS = 8;
+const size_t VECTOR_SIZE = 1500000;
+const char*  FILE_NAME   = "XMLCVarReaderTest.xml";
+
+////////////////////////////////////////////////////////////////////////////////
+// Peak resident memory in kB, 0 where unknown.
+static long PeakMemoryKB()
+{
+#ifndef _WIN_
+    struct rusage usage;
+    if( getrusage( RUSAGE_SELF, &usage ) == 0 ) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static size_t GenerateFile()
+{
+    std::ofstream sOut( FILE_NAME, std::ios::binary );
+    sOut << "<?xml version=\"1.0\"?>\n<!-- generated by XMLCVarReaderTest -->\n<cvars>\n";
+    char sLine[128];
+    for( size_t ii = 0; ii < NUM_SCALARS; ii++ ) {
+        if( ii % 1000 == 0 ) {
+            if( ii > 0 ) {
+                sOut << "  </group.>\n";
+            }
+            sOut << "  <group.>\n";
+        }
+        snprintf( sLine, sizeof( sLine ), "    <var%zu>  %zu</var%zu>\n", ii, ii * 3, ii );
+        sOut << sLine;
+    }
+    sOut << "  </group.>\n";
+    for( size_t ii = 0; ii < NUM_VECTORS; ii++ ) {
+        sOut << "  <vec" << ii << ">  [";
+        for( size_t jj = 0; jj < VECTOR_SIZE; jj++ ) {
+            snprintf( sLine, sizeof( sLine ), " %zu", ( jj * 7 + ii ) % 100000000 );
+            sOut << sLine;
+        }
+        sOut << " ]</vec" << ii << ">\n";
+    }
+    sOut << "</cvars>\n";
+    return (size_t)sOut.tellp();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static int ExpectedElement( size_t nVec, size_t jj )
+{
+    return (int)( ( jj * 7 + nVec ) % 100000000 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Checks the text kept for an unregistered vector.
+static bool CheckVectorText( size_t nVec, const std::string& sValue )
+{
+    const char* p = sValue.c_str();
+    if( *p++ != '[' ) {
+        return false;
+    }
+    size_t nCount = 0;
+    for( char* pEnd; ; p = pEnd ) {
+        const long n = strtol( p, &pEnd, 10 );
+        if( pEnd == p ) {
+            break;
+        }
+        if( n != ExpectedElement( nVec, nCount ) ) {
+            return false;
+        }
+        nCount++;
+    }
+    return nCount == VECTOR_SIZE && std::string( p ) == " ]";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool CheckVector( size_t nVec, const std::vector<int>& vValue )
+{
+    if( vValue.size() != VECTOR_SIZE ) {
+        return false;
+    }
+    for( size_t jj = 0; jj < vValue.size(); jj++ ) {
+        if( vValue[jj] != ExpectedElement( nVec, jj ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The even scalars and the first half of the vectors are registered.
+int main()
+{
+    std::vector<int*> vScalars;
+    std::vector< std::vector<int>* > vVectors;
+    char sName[64];
+    for( size_t ii = 0; ii < NUM_SCALARS; ii += 2 ) {
+        snprintf( sName, sizeof( sName ), "group.var%zu", ii );
+        vScalars.push_back( &CVarUtils::CreateCVar( sName, -1 ) );
+    }
+    for( size_t ii = 0; ii < NUM_VECTORS / 2; ii++ ) {
+        snprintf( sName, sizeof( sName ), "vec%zu", ii );
+        vVectors.push_back( &CVarUtils::CreateCVar( sName, std::vector<int>() ) );
+    }
+
+    const size_t nFileSize = GenerateFile();
+    const long nMemoryBefore = PeakMemoryKB();
+    CVarUtils::SetStreamType( CVARS_XML_STREAM );
+    const bool bLoaded = CVarUtils::Load( FILE_NAME );
+    const long nMemoryUsed = PeakMemoryKB() - nMemoryBefore;
+    remove( FILE_NAME );
+
+    int nErrors = 0;
+    if( !bLoaded ) {
+        std::cerr << "ERROR: could not load " << FILE_NAME << "." << std::endl;
+        nErrors++;
+    }
+    for( size_t ii = 0; ii < vScalars.size(); ii++ ) {
+        if( *vScalars[ii] != (int)( ii * 2 * 3 ) ) {
+            std::cerr << "ERROR: group.var" << ii * 2 << " = " << *vScalars[ii] << std::endl;
+            nErrors++;
+        }
+    }
+    for( size_t ii = 0; ii < vVectors.size(); ii++ ) {
+        if( !CheckVector( ii, *vVectors[ii] ) ) {
+            std::cerr << "ERROR: unexpected value for vec" << ii << std::endl;
+            nErrors++;
+        }
+    }
+
+    // values kept for the CVars not registered
+    const std::unordered_map< std::string, CVarPendingValue >& mPending =
+        CVarUtils::TrieInstance().GetPendingValues();
+    for( size_t ii = 1; ii < NUM_SCALARS; ii += 2 ) {
+        snprintf( sName, sizeof( sName ), "group.var%zu", ii );
+        std::unordered_map< std::string, CVarPendingValue >::const_iterator it = mPending.find( sName );
+        if( it == mPending.end() || it->second.m_sValue != std::to_string( ii * 3 ) ) {
+            std::cerr << "ERROR: no value kept for " << sName << std::endl;
+            nErrors++;
+        }
+    }
+    for( size_t ii = NUM_VECTORS / 2; ii < NUM_VECTORS; ii++ ) {
+        snprintf( sName, sizeof( sName ), "vec%zu", ii );
+        std::unordered_map< std::string, CVarPendingValue >::const_iterator it = mPending.find( sName );
+        if( it == mPending.end() || !CheckVectorText( ii, it->second.m_sValue ) ) {
+            std::cerr << "ERROR: no value kept for " << sName << std::endl;
+            nErrors++;
+        }
+    }
+    if( mPending.size() != NUM_SCALARS / 2 + NUM_VECTORS / 2 ) {
+        std::cerr << "ERROR: " << mPending.size() << " values kept." << std::endl;
+        nErrors++;
+    }
+
+    // kept: 24 MB of vectors and 52 MB of vector text; a value being
+    // parsed, its copy and string growth account for the rest
+    const long nMemoryLimit = 128 * 1024;
+    std::cout << "Loaded " << nFileSize / ( 1024 * 1024 ) << " MB, peak memory grew by "
+              << nMemoryUsed / 1024 << " MB." << std::endl;
+    if( nMemoryUsed > nMemoryLimit ) {
+        std::cerr << "ERROR: loading used more than " << nMemoryLimit / 1024 << " MB." << std::endl;
+        nErrors++;
+    }
+    return nErrors == 0 ? 0 : 1;
+}